@@ -4,20 +4,34 @@
 #include <string>
 #include <cmath>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <assimp/mesh.h>
 #include <rendersystem/Shader.h>
+#include <rendersystem/ShaderCache.h>
+#include <rendersystem/ShaderQueue.h>
+#include <rendersystem/ShaderVariants.h>
 #include <rendersystem/Camera.h>
 #include <rendersystem/Model.h>
+#include <rendersystem/GeometryPool.h>
 #include <rendersystem/Lights.h>
+#include <rendersystem/LightingSystem.h>
+#include <rendersystem/FrameConstants.h>
+#include <rendersystem/LightClusters.h>
+#include <rendersystem/DeferredRenderer.h>
+#include <rendersystem/GpuTimer.h>
+#include <rendersystem/CascadedShadows.h>
+#include <rendersystem/PointShadows.h>
+#include <rendersystem/ProbeGrid.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <map>
+#include <algorithm>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
@@ -39,6 +53,8 @@ glm::vec3 lightPos(1.5f, 0.5f, 2.0f);
 float near = 0.1f;
 float far = 100.0f;
 bool camRot = false;
+bool printFrameStats = false;
+bool deferredShading = false;
 int main()
 {
     // glfw: initialize and configure
@@ -76,163 +92,365 @@ int main()
         return -1;
     }
 
-    // configure global opengl state
-    // -----------------------------
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    // build and compile our shader zprogram
-    // ------------------------------------
-
-    // build and compile our shader zprogram
-    // ------------------------------------
-    Shader defaultShader(SHADERS_DIR "colors.vert",  SHADERS_DIR "colors.frag");
-    Shader grassShader(SHADERS_DIR "drop.vert", SHADERS_DIR "drop.frag");
-    Shader lightCubeShader(SHADERS_DIR "light_cube.vert", SHADERS_DIR "light_cube.frag");
-    Shader blendedShader(SHADERS_DIR "blend.vert", SHADERS_DIR "blend.frag");
-    auto mainLight = PointLight::DefaultPointLight();
-    auto dirLight = DirectionalLight::DefaultDirectionalLight();
-
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    // ------------------------------------------------------------------
-    auto lightCube = std::make_shared<ControlledMesh>(ControlledMesh::CreateCube(0.2f));
-    lightCube->SetAxis(glm::vec3{ 0, 1, 0 });
-    lightCube->SetColor(glm::vec3{ 1, 1, 1 });
-
-    auto platform = std::make_shared<ControlledMesh>(ControlledMesh::CreateCuboid(10.0f, 1.0f, 10.0f));
-    platform->SetAxis(glm::vec3{ 0, 1, 0 });
-    platform->AddTexture(ASSETS_DIR "cobble.jpg", "texture_diffuse");
-    platform->SetPosition(glm::vec3{ 0, -3, 0 });
-
-    auto sphere = std::make_shared<ControlledMesh>(ControlledMesh::CreateSphere(0.5f));
-    sphere->SetAxis(glm::vec3{ 0, 1, 0 });
-    sphere->SetPosition(glm::vec3{ 0, 0, -3 });
-    sphere->AddTexture(ASSETS_DIR "eye.png", "texture_diffuse", []() {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    });
-
-    auto grass = std::make_shared<ControlledMesh>(ControlledMesh::CreateQuad(1.5f, 1.5f));
-    grass->SetAxis(glm::vec3{ 0, 1, 0 });
-    grass->SetPosition(glm::vec3{ 3.0f, -1.75f, 0 });
-    grass->AddTexture(ASSETS_DIR "grass.png", "texture_diffuse", []() {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    });
-    grass->Rotate(90.0f);
-
-    auto blended_window = std::make_shared<ControlledMesh>(ControlledMesh::CreateQuad(1.5f, 1.5f, false));
-    blended_window->SetPosition(glm::vec3{ -3.0f, -1.75f, 0 });
-    blended_window->AddTexture(ASSETS_DIR "blending_transparent_window.png", "texture_diffuse");
-
-    auto blended_window_2 = std::make_shared<ControlledMesh>(ControlledMesh::CreateQuad(1.5f, 1.5f, false));
-    blended_window_2->SetPosition(glm::vec3{ -3.0f, -1.75f, 3.0f });
-    blended_window_2->AddTexture(ASSETS_DIR "blending_transparent_window.png", "texture_diffuse");
-
-    auto loaded_model = std::make_shared<Model>(MODELS_DIR "backpack/backpack.obj");
-    loaded_model->Rotate(180.0f);
-
-
-    auto lightedShaders = std::vector<std::pair<const Shader, std::vector<std::shared_ptr<Drawable>>>>{
-        std::make_pair(defaultShader,
-            std::vector<std::shared_ptr<Drawable>>{
-                loaded_model,
-                platform,
-                sphere
-            }),
-        std::make_pair(grassShader,
-            std::vector<std::shared_ptr<Drawable>>{
-                grass
-            }),
-        std::make_pair(lightCubeShader,
-            std::vector<std::shared_ptr<Drawable>>{
-                lightCube
-            }),
-        std::make_pair(blendedShader,
-            std::vector<std::shared_ptr<Drawable>>{
-                blended_window,
-                blended_window_2
-            })
-    };
-
-    // render loop
-    // -----------
-    while (!glfwWindowShouldClose(window))
+    // the scene lives in its own scope, so everything it owns releases its GL objects
+    // while the context is still current
     {
-        // per-frame time logic
-        // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        // input
-        // -----
-        processInput(window);
-
-        // render
-        // ------
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        if (camRot) {
-            camera.Rotate((float)glm::radians(0.01f), glm::vec3(0.0f, 1.0f, 0.0f));
+        // configure global opengl state
+        // -----------------------------
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        // build and compile our shader zprogram
+        // ------------------------------------
+
+        // build and compile our shader zprogram
+        // ------------------------------------
+        FrameConstants frameConstants;
+
+        // submit every program up front, the scene is drawn with the fallback until they're ready
+        ShaderQueue shaderQueue((GLADloadproc)glfwGetProcAddress);
+        Shader fallbackShader(SHADERS_DIR "light_cube.vert", SHADERS_DIR "light_cube.frag");
+        ShaderVariants litVariants(SHADERS_DIR "colors.vert", SHADERS_DIR "colors.frag", &shaderQueue);
+        auto grassShader = shaderQueue.Submit(SHADERS_DIR "drop.vert", SHADERS_DIR "drop.frag");
+        auto lightCubeShader = shaderQueue.Submit(SHADERS_DIR "light_cube.vert", SHADERS_DIR "light_cube.frag");
+        auto blendedShader = shaderQueue.Submit(SHADERS_DIR "blend.vert", SHADERS_DIR "blend.frag");
+        LightingSystem lighting;
+        auto mainLight = lighting.AddPointLight(PointLight::DefaultPointLight());
+        lighting.AddDirectionalLight(DirectionalLight::DefaultDirectionalLight());
+
+        // short ranged lights at the platform corners, each only reaches the objects near it
+        glm::vec3 cornerColors[] = { { 1, 0.2f, 0.2f }, { 0.2f, 1, 0.2f }, { 0.2f, 0.2f, 1 }, { 1, 1, 0.2f } };
+        glm::vec3 corners[] = { { -4.5f, -2, -4.5f }, { 4.5f, -2, -4.5f }, { -4.5f, -2, 4.5f }, { 4.5f, -2, 4.5f } };
+        std::vector<int> cornerLights;
+        for (int i = 0; i < 4; i++) {
+            cornerLights.push_back(lighting.AddPointLight(PointLight(corners[i], QuadAttenuation(1.0f, 0.7f, 1.8f),
+                glm::vec3(0.0f), cornerColors[i], cornerColors[i])));
+        }
+
+        // deferred path, toggled with G. both paths time the lit geometry on the GPU
+        LightClusters lightClusters;
+        DeferredRenderer deferred(SCR_WIDTH, SCR_HEIGHT, SHADERS_DIR, &shaderQueue);
+        GpuTimer litTimer;
+
+        // set up vertex data (and buffer(s)) and configure vertex attributes
+        // ------------------------------------------------------------------
+        auto lightCube = std::make_shared<ControlledMesh>(ControlledMesh::CreateCube(0.2f));
+        lightCube->SetAxis(glm::vec3{ 0, 1, 0 });
+        lightCube->SetColor(glm::vec3{ 1, 1, 1 });
+
+        auto platform = std::make_shared<ControlledMesh>(ControlledMesh::CreateCuboid(10.0f, 1.0f, 10.0f));
+        platform->SetAxis(glm::vec3{ 0, 1, 0 });
+        platform->AddTexture(ASSETS_DIR "cobble.jpg", "texture_diffuse");
+        platform->SetPosition(glm::vec3{ 0, -3, 0 });
+
+        auto sphere = std::make_shared<ControlledMesh>(ControlledMesh::CreateSphere(0.5f));
+        sphere->SetAxis(glm::vec3{ 0, 1, 0 });
+        sphere->SetPosition(glm::vec3{ 0, 0, -3 });
+        sphere->AddTexture(ASSETS_DIR "eye.png", "texture_diffuse", []() {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        });
+        sphere->GenerateLods();
+
+        auto grass = std::make_shared<ControlledMesh>(ControlledMesh::CreateQuad(1.5f, 1.5f));
+        grass->SetAxis(glm::vec3{ 0, 1, 0 });
+        grass->SetPosition(glm::vec3{ 3.0f, -1.75f, 0 });
+        grass->AddTexture(ASSETS_DIR "grass.png", "texture_diffuse", []() {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        });
+        grass->Rotate(90.0f);
+
+        auto blended_window = std::make_shared<ControlledMesh>(ControlledMesh::CreateQuad(1.5f, 1.5f, false));
+        blended_window->SetPosition(glm::vec3{ -3.0f, -1.75f, 0 });
+        blended_window->AddTexture(ASSETS_DIR "blending_transparent_window.png", "texture_diffuse");
+
+        auto blended_window_2 = std::make_shared<ControlledMesh>(ControlledMesh::CreateQuad(1.5f, 1.5f, false));
+        blended_window_2->SetPosition(glm::vec3{ -3.0f, -1.75f, 3.0f });
+        blended_window_2->AddTexture(ASSETS_DIR "blending_transparent_window.png", "texture_diffuse");
+
+        // the backpack stays in float vertices: quantized geometry has a layout and decode
+        // uniforms of its own, so it would leave the GeometryPool and lose its batched draws
+        auto loaded_model = std::make_shared<Model>(MODELS_DIR "backpack/backpack.obj");
+        loaded_model->Rotate(180.0f);
+
+        // baked lighting, if rs_lightbake has been run. the lightmaps hold the directional
+        // and corner lights, lightmapped objects only evaluate the orbiting light at runtime
+        platform->LoadLightmap(LIGHTMAPS_DIR "platform.lightmap");
+        loaded_model->LoadLightmaps(LIGHTMAPS_DIR "backpack");
+
+        // the sphere moves, so it gets its indirect light from the baked probe grid instead
+        ProbeGrid probes;
+        ProbeGrid::Load(LIGHTMAPS_DIR "probes.grid", probes);
+
+
+        // the directional light casts shadows. the platform and the backpack never move, so
+        // their shadows are cached; the spinning sphere is redrawn in the cascades it's in
+        CascadedShadows shadows(SHADERS_DIR);
+        shadows.AddCaster(platform, true);
+        shadows.AddCaster(loaded_model, true);
+        shadows.AddCaster(sphere, false);
+
+        // the orbiting light casts cube shadows. its faces are redrawn as it moves, the
+        // corner lights' faces only when the sphere turns inside them
+        PointShadows pointShadows(SHADERS_DIR);
+        pointShadows.AddCaster(platform);
+        pointShadows.AddCaster(loaded_model);
+        pointShadows.AddCaster(sphere);
+
+        auto litObjects = std::vector<std::shared_ptr<Drawable>>{
+            loaded_model,
+            platform,
+            sphere
+        };
+
+        // lit objects are drawn with the cheapest colors variant for their material and the
+        // scene's light set, so no fragment branches on features it doesn't use
+        // and each draw only loops over the point lights whose range reaches it
+        ShaderFeatures lightSet;
+        lightSet.perObjectLights = true;
+        lightSet.directionalLights = 1;
+        lightSet.shadows = true;
+        lightSet.pointShadows = true;
+
+        std::map<uint64_t, std::vector<std::shared_ptr<Drawable>>> litGroups;
+        std::map<uint64_t, ShaderFuture> litPrograms;
+        std::map<uint64_t, ShaderFuture> geometryPrograms;
+        std::map<uint64_t, ShaderFeatures> groupFeatures;
+        for (auto& obj : litObjects) {
+            auto features = lightSet;
+            obj->MaterialFeatures(features);
+            features.probes = !probes.Empty() && obj == sphere;
+            litGroups[features.Key()].push_back(obj);
+            litPrograms[features.Key()] = litVariants.Get(features);
+            groupFeatures[features.Key()] = features;
+
+            // baked lighting isn't in the G-buffer, those objects stay forward shaded
+            if (!features.lightmap && !features.probes) {
+                geometryPrograms[features.Key()] = deferred.GeometryShader(features);
+            }
         }
 
-        // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, near, far);
-        glm::mat4 view = camera.GetViewMatrix();
-
-        // draw default shaded models
-        // set up shaders (camera, lights, etc.)
-        for (auto& [shader, objs] : lightedShaders) {
-            shader.use();
-
-            mainLight.SetShader(shader, 0);
-            dirLight.SetShader(shader, 0);
-
-            shader.setVec3("viewPos", camera.Position);
-            shader.setMat4("view", view);
-            shader.setMat4("projection", projection);
-            shader.setFloat("near", near);
-            shader.setFloat("far", far);
-            shader.setBool("enableVisualiseDepthBuffer", false);
-
-            std::map<float, std::shared_ptr<Drawable>> sorted_nonopaques;
-            for (auto& obj : objs) {
-                if (obj->IsOpaque()) {
-                    obj->Draw(shader);
+        auto lightedShaders = std::vector<std::pair<ShaderFuture, std::vector<std::shared_ptr<Drawable>>>>();
+        std::vector<ShaderFeatures> litFeatures;
+        for (auto& [key, objs] : litGroups) {
+            lightedShaders.push_back(std::make_pair(litPrograms[key], objs));
+            litFeatures.push_back(groupFeatures[key]);
+        }
+
+        lightedShaders.insert(lightedShaders.end(), {
+            std::make_pair(grassShader,
+                std::vector<std::shared_ptr<Drawable>>{
+                    grass
+                }),
+            std::make_pair(lightCubeShader,
+                std::vector<std::shared_ptr<Drawable>>{
+                    lightCube
+                }),
+            std::make_pair(blendedShader,
+                std::vector<std::shared_ptr<Drawable>>{
+                    blended_window,
+                    blended_window_2
+                })
+        });
+
+        // lit objects too small on screen this frame
+        std::unordered_set<const Drawable*> culled;
+
+        // render loop
+        // -----------
+        while (!glfwWindowShouldClose(window))
+        {
+            // per-frame time logic
+            // --------------------
+            float currentFrame = glfwGetTime();
+            deltaTime = currentFrame - lastFrame;
+            lastFrame = currentFrame;
+
+            // input
+            // -----
+            processInput(window);
+            Shader::ResetFrameStats();
+            Mesh::ResetFrameStats();
+
+            // render
+            // ------
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            if (camRot) {
+                camera.Rotate((float)glm::radians(0.01f), glm::vec3(0.0f, 1.0f, 0.0f));
+            }
+
+            // view/projection transformations, shared by every shader through the FrameConstants block
+            frameConstants.Update(camera, (float)SCR_WIDTH / (float)SCR_HEIGHT, near, far);
+
+            int fbWidth, fbHeight;
+            glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+
+            // levels of detail and visible meshlets for this view. the shadow passes draw the
+            // same levels, but every meshlet
+            DetailView detailView(camera.Position, glm::radians(camera.Zoom), (float)fbHeight,
+                frameConstants.Data().viewProjection);
+            culled.clear();
+            for (auto& obj : litObjects) {
+                if (!obj->SelectDetail(detailView)) {
+                    culled.insert(obj.get());
                 }
-                else {
-                    auto dist = glm::length(camera.Position - obj->Position());
-                    sorted_nonopaques[dist] = obj;
+            }
+
+            // lights live in the Lights block, only the ones that moved are re-uploaded
+            lighting.Upload();
+
+            shadows.Update(camera, (float)SCR_WIDTH / (float)SCR_HEIGHT, near, far, lighting.DirectionalLights()[0].GetDirection());
+
+            pointShadows.Update(lighting, camera, fbHeight);
+
+            // finish any programs the driver is done with
+            if (!shaderQueue.Idle()) {
+                shaderQueue.Poll();
+                if (shaderQueue.Idle()) {
+                    ShaderCache::PrintReport();
                 }
             }
 
-            for (auto it = sorted_nonopaques.rbegin(); it != sorted_nonopaques.rend(); ++it) {
-                it->second->Draw(shader);
+            // deferred: opaque lit objects go through the G-buffer and are shaded once per pixel.
+            // the rest (and everything while the deferred programs build) is drawn forward below
+            bool drawDeferred = deferredShading;
+            for (auto& [key, program] : geometryPrograms) {
+                drawDeferred = drawDeferred && program.Ready();
             }
-        }
 
-        // action logic
-        // -----
-        glm::quat rot = glm::angleAxis((float)glm::radians(50.0f * deltaTime), glm::vec3(0.0f, 1.0f, 0.0f));
-        lightPos = rot * glm::vec4(lightPos, 1.0f);
+            litTimer.Begin();
+            if (drawDeferred) {
+                lightClusters.Build(lighting.PointLights(), frameConstants.Data().view,
+                    glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, near, far);
+
+                deferred.Resize(fbWidth, fbHeight);
+                deferred.BeginGeometryPass();
+                for (auto& [key, program] : geometryPrograms) {
+                    const Shader& shader = program.Get();
+                    shader.use();
+                    for (auto& obj : litGroups[key]) {
+                        if (obj->IsOpaque() && !culled.count(obj.get())) {
+                            obj->DrawVisible(shader);
+                        }
+                    }
+                }
+                drawDeferred = deferred.LightingPass(lighting, lightClusters, &shadows, &pointShadows);
+            }
+
+            // draw default shaded models
+            // set up shaders (camera, lights, etc.)
+            // the first litGroups.size() entries are the lit objects
+            for (size_t group = 0; group < lightedShaders.size(); group++) {
+                auto& [program, objs] = lightedShaders[group];
+                bool litGroup = group < litGroups.size();
+                bool bakedGroup = litGroup && litFeatures[group].lightmap;
+                bool probeGroup = litGroup && litFeatures[group].probes;
+                if (group == litGroups.size()) {
+                    litTimer.End();
+                }
+
+                // never stall on a program that is still building: draw with the fallback
+                const Shader& shader = program.GetOr(fallbackShader);
+                shader.use();
+
+                shader.setBool("enableVisualiseDepthBuffer", false);
+                if (litGroup) {
+                    shadows.Bind(shader);
+                    pointShadows.Bind(shader);
+                }
+
+                auto draw = [&](const std::shared_ptr<Drawable>& obj) {
+                    if (litGroup) {
+                        int objectLights[LightingSystem::MAX_OBJECT_LIGHTS];
+                        int count = lighting.SelectPointLights(obj->Bounds(), objectLights);
+                        if (probeGroup) {
+                            probes.Bind(shader, obj->Bounds().center);
+                        }
+                        if (bakedGroup) {
+                            // the corner lights are in the lightmap already
+                            count = (int)(std::remove_if(objectLights, objectLights + count, [&](int light) {
+                                return std::find(cornerLights.begin(), cornerLights.end(), light) != cornerLights.end();
+                            }) - objectLights);
+                        }
+                        shader.setInt("objectLightCount", count);
+                        shader.setIntArray("objectLights", objectLights, count);
+                    }
+                    obj->DrawVisible(shader);
+                };
+
+                std::map<float, std::shared_ptr<Drawable>> sorted_nonopaques;
+                for (auto& obj : objs) {
+                    if (culled.count(obj.get())) continue;
+                    if (obj->IsOpaque()) {
+                        // already shaded by the deferred lighting pass
+                        if (drawDeferred && litGroup && !bakedGroup && !probeGroup) continue;
+                        draw(obj);
+                    }
+                    else {
+                        auto dist = glm::length(camera.Position - obj->Position());
+                        sorted_nonopaques[dist] = obj;
+                    }
+                }
+
+                for (auto it = sorted_nonopaques.rbegin(); it != sorted_nonopaques.rend(); ++it) {
+                    draw(it->second);
+                }
+            }
 
-        sphere->Rotate(100.0f * deltaTime);
-        lightCube->SetPosition(lightPos);
-        mainLight.SetPosition(lightPos);
+            // action logic
+            // -----
+            glm::quat rot = glm::angleAxis((float)glm::radians(50.0f * deltaTime), glm::vec3(0.0f, 1.0f, 0.0f));
+            lightPos = rot * glm::vec4(lightPos, 1.0f);
+
+            sphere->Rotate(100.0f * deltaTime);
+            lightCube->SetPosition(lightPos);
+            lighting.EditPointLight(mainLight)->SetPosition(lightPos);
+
+            if (printFrameStats) {
+                auto& stats = Shader::FrameStats();
+                std::cout << "program binds: " << stats.programBinds << " (" << stats.programBindsElided << " elided), "
+                    << "uniform uploads: " << stats.uniformUploads << " (" << stats.uniformUploadsElided << " elided)" << std::endl;
+                std::cout << (deferredShading ? "deferred" : "forward") << " lit geometry: "
+                    << litTimer.Milliseconds() << " ms GPU" << std::endl;
+                auto& shadowStats = shadows.LastStats();
+                std::cout << "shadow cascades: " << shadowStats.rendered << " rendered, " << shadowStats.skipped << " skipped" << std::endl;
+                for (int i = 0; i < shadows.CascadeCount(); i++) {
+                    auto& cascade = shadowStats.cascades[i];
+                    std::cout << "  cascade " << i << " (to " << cascade.splitFar << "): " << cascade.casters << " casters, "
+                        << (cascade.rendered ? (cascade.staticRebuilt ? "static rebuilt" : "dynamic only") : "skipped")
+                        << ", " << cascade.gpuMilliseconds << " ms GPU" << std::endl;
+                }
+                auto& pointStats = pointShadows.LastStats();
+                std::cout << "point shadows: " << pointStats.lights << " lights, " << pointStats.facesRendered << " faces rendered, "
+                    << pointStats.facesSkipped << " skipped, " << pointStats.reallocated << " reallocated" << std::endl;
+                auto& selection = lighting.LastSelection();
+                std::cout << "per object lights: " << selection.lightsSelected << " of " << selection.lightsConsidered
+                    << " over " << selection.draws << " draws" << std::endl;
+                auto& meshStats = Mesh::FrameStats();
+                std::cout << "triangles: " << meshStats.triangles << " (" << meshStats.fullDetailTriangles
+                    << " at full detail), " << meshStats.culled << " objects culled" << std::endl;
+                meshStats.meshlets.Print("meshlets");
+                printFrameStats = false;
+            }
 
         
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+            // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+            // -------------------------------------------------------------------------------
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
 
+    // the pools meshes were allocated from, now that every mesh is gone
+    GeometryPool::Shutdown();
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
@@ -304,4 +522,6 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     if (action == GLFW_RELEASE) return;
 
     if (key == GLFW_KEY_X) camRot = !camRot;
+    if (key == GLFW_KEY_P) printFrameStats = true;
+    if (key == GLFW_KEY_G) deferredShading = !deferredShading;
 }
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include <resources.h>
+
+#include <iostream>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <rendersystem/Shader.h>
+#include <rendersystem/ShaderCache.h>
+#include <rendersystem/ShaderVariants.h>
+#include <rendersystem/Camera.h>
+#include <rendersystem/Geometry.h>
+#include <rendersystem/InstancedMesh.h>
+#include <rendersystem/GeometryPool.h>
+#include <rendersystem/Lights.h>
+#include <rendersystem/LightingSystem.h>
+#include <rendersystem/FrameConstants.h>
+#include <rendersystem/Parallel.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// a field of cubes drawn as one InstancedMesh, every cube bobbing and spinning each
+// frame. the instances are animated on the Parallel pool and uploaded as one dirty
+// range; P pauses the animation (nothing is uploaded then), X spins the camera.
+// usage: demo_instancing [cube count]
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+void processInput(GLFWwindow* window);
+void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+
+// settings
+const unsigned int SCR_WIDTH = 1280;
+const unsigned int SCR_HEIGHT = 720;
+const float SPACING = 1.5f;
+Camera camera(glm::vec3(0.0f, 40.0f, 60.0f));
+float lastX = 400, lastY = 300;
+float deltaTime = 0.0f;	// Time between current frame and last frame
+float lastFrame = 0.0f; // Time of last frame
+float near = 0.1f;
+float far = 1000.0f;
+bool camRot = false;
+bool paused = false;
+
+int main(int argc, char** argv)
+{
+    int count = argc > 1 ? std::max(1, std::stoi(argv[1])) : 100000;
+
+    // glfw: initialize and configure
+    // ------------------------------
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "demo_instancing", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+    glfwSetKeyCallback(window, key_callback);
+
+    // glad: load all OpenGL function pointers
+    // ---------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    // the scene lives in its own scope, so everything it owns releases its GL objects
+    // while the context is still current
+    {
+        glEnable(GL_DEPTH_TEST);
+        // the cube is wound counter-clockwise, the default front face
+        glEnable(GL_CULL_FACE);
+        camera.ProcessMouseMovement(0.0f, -300.0f); // pitch down 30 degrees
+
+        FrameConstants frameConstants;
+        LightingSystem lighting;
+        lighting.AddDirectionalLight(DirectionalLight::DefaultDirectionalLight());
+        lighting.Upload();
+
+        // the cubes: a square grid around the origin, every cube with its own tint and one of
+        // the demo textures
+        InstancedMesh cubes(Geometry::Cuboid(1.0f, 1.0f, 1.0f));
+        cubes.SetTextures({ ASSETS_DIR "cobble.jpg", ASSETS_DIR "awesome.png", ASSETS_DIR "desolate.png", ASSETS_DIR "insight.png" });
+        cubes.Resize(count);
+
+        int side = (int)std::ceil(std::sqrt((double)count));
+        auto home = [side](int i) {
+            return glm::vec3((i % side - side * 0.5f) * SPACING, 0.0f, (i / side - side * 0.5f) * SPACING);
+        };
+
+        auto animate = [&](float t) {
+            auto* instances = cubes.Data();
+            Parallel::For(0, count, [&](int i) {
+                float phase = (float)(i % 97) * 0.37f + (float)(i / side) * 0.11f;
+                glm::vec3 position = home(i) + glm::vec3(0.0f, std::sin(t * 2.0f + phase) * 0.5f, 0.0f);
+                glm::quat rotation = glm::angleAxis(t + phase, glm::normalize(glm::vec3(std::sin(phase), 1.0f, std::cos(phase))));
+                glm::vec3 tint(0.5f + 0.5f * std::sin(phase), 0.5f + 0.5f * std::sin(phase + 2.1f), 0.5f + 0.5f * std::sin(phase + 4.2f));
+                instances[i] = InstancedMesh::Pack(position, 1.0f, rotation, tint, i % 4);
+            }, 4096);
+            cubes.MarkDirty(0, count);
+        };
+        animate(0.0f);
+
+        ShaderFeatures features;
+        features.pointLights = 0;
+        features.directionalLights = 1;
+        cubes.MaterialFeatures(features);
+        ShaderVariants variants(SHADERS_DIR "colors.vert", SHADERS_DIR "colors.frag");
+        const Shader& shader = variants.Get(features).Get();
+        ShaderCache::PrintReport();
+
+        std::cout << count << " cubes, " << Parallel::ThreadCount() << " animation threads" << std::endl;
+
+        // render loop
+        // -----------
+        int frames = 0;
+        double animateMs = 0.0;
+        float reportTime = (float)glfwGetTime();
+        float animationTime = 0.0f;
+        while (!glfwWindowShouldClose(window))
+        {
+            // per-frame time logic
+            // --------------------
+            float currentFrame = glfwGetTime();
+            deltaTime = currentFrame - lastFrame;
+            lastFrame = currentFrame;
+
+            processInput(window);
+
+            if (camRot) {
+                camera.Rotate((float)glm::radians(0.01f), glm::vec3(0.0f, 1.0f, 0.0f));
+            }
+            frameConstants.Update(camera, (float)SCR_WIDTH / (float)SCR_HEIGHT, near, far);
+
+            if (!paused) {
+                double start = glfwGetTime();
+                animationTime += deltaTime;
+                animate(animationTime);
+                animateMs += (glfwGetTime() - start) * 1000.0;
+            }
+
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            shader.use();
+            shader.setFloat("material.shininess", 32.0f);
+            cubes.Draw(shader);
+
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+
+            // once a second: frame rate, animation cost and what the last upload moved
+            frames++;
+            if (currentFrame - reportTime >= 1.0f) {
+                float seconds = currentFrame - reportTime;
+                auto& upload = cubes.LastUpload();
+                std::cout << frames / seconds << " fps, " << seconds * 1000.0f / frames << " ms/frame, animate "
+                    << animateMs / frames << " ms, upload " << upload.instances << " instances in "
+                    << upload.ranges << " ranges (" << upload.bytes / 1024 << " KiB)" << std::endl;
+                frames = 0;
+                animateMs = 0.0;
+                reportTime = currentFrame;
+            }
+        }
+    }
+
+    // the pools meshes were allocated from, now that every mesh is gone
+    GeometryPool::Shutdown();
+
+    glfwTerminate();
+    return 0;
+}
+
+// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
+// ---------------------------------------------------------------------------------------------------------
+void processInput(GLFWwindow* window)
+{
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, true);
+    // the field is large, move faster than the other demos
+    float dt = deltaTime * 8.0f;
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, dt);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, dt);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, dt);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, dt);
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, dt);
+    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, dt);
+}
+
+bool firstMouse = true;
+
+void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
+    if (firstMouse) // initially set to true
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+        return;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos; // reversed since y-coordinates range from bottom to top
+    lastX = xpos;
+    lastY = ypos;
+
+    const float sensitivity = 0.1f;
+    xoffset *= sensitivity;
+    yoffset *= sensitivity;
+
+    camera.ProcessMouseMovement(xoffset, yoffset, GL_TRUE);
+}
+
+// glfw: whenever the window size changed (by OS or user resize) this callback function executes
+// ---------------------------------------------------------------------------------------------
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+    glViewport(0, 0, width, height);
+}
+
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(yoffset);
+}
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (action == GLFW_RELEASE) return;
+
+    if (key == GLFW_KEY_X) camRot = !camRot;
+    if (key == GLFW_KEY_P) paused = !paused;
+}
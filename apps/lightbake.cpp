@@ -0,0 +1,102 @@
+#include <resources.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <algorithm>
+
+#include <rendersystem/Geometry.h>
+#include <rendersystem/Lightmap.h>
+#include <rendersystem/LightmapBaker.h>
+#include <rendersystem/Lights.h>
+#include <rendersystem/Parallel.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// bakes lightmaps for the static objects of the blending demo (the platform and the
+// backpack) on the CPU. no window or GL context is created, so it runs on machines
+// without a GPU. the scene below has to match the placement in blending_demo.cpp.
+// writes <name>.lightmap files for Mesh::LoadLightmap / Model::LoadLightmaps, a .hdr
+// preview of each, and probes.grid, the irradiance probes over the platform for the
+// moving objects.
+// usage: rs_lightbake [output directory] [texels per unit] [samples per texel] [bounces]
+
+bool write(const Lightmap& lightmap, const std::filesystem::path& dir, const std::string& name)
+{
+    auto path = dir / (name + ".lightmap");
+    if (!lightmap.Save(path.string())) {
+        return false;
+    }
+    lightmap.SaveHDR((dir / (name + ".hdr")).string());
+
+    std::cout << "  " << path.string() << ": " << lightmap.width << "x" << lightmap.height
+        << ", " << lightmap.remap.size() << " vertices" << std::endl;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::filesystem::path outputDir = argc > 1 ? argv[1] : LIGHTMAPS_DIR;
+
+    LightmapBaker::Settings settings;
+    if (argc > 2) settings.texelsPerUnit = std::max(0.5f, std::stof(argv[2]));
+    if (argc > 3) settings.samples = std::max(0, std::stoi(argv[3]));
+    if (argc > 4) settings.bounces = std::max(0, std::stoi(argv[4]));
+
+    std::error_code ec;
+    std::filesystem::create_directories(outputDir, ec);
+    if (ec) {
+        std::cout << "ERROR::LIGHTBAKE::CANNOT_CREATE_DIRECTORY " << outputDir.string() << std::endl;
+        return 1;
+    }
+
+    LightmapBaker baker;
+
+    // the static lights of the demo: the directional light and the platform corner lights
+    baker.AddDirectionalLight(DirectionalLight::DefaultDirectionalLight());
+    glm::vec3 cornerColors[] = { { 1, 0.2f, 0.2f }, { 0.2f, 1, 0.2f }, { 0.2f, 0.2f, 1 }, { 1, 1, 0.2f } };
+    glm::vec3 corners[] = { { -4.5f, -2, -4.5f }, { 4.5f, -2, -4.5f }, { -4.5f, -2, 4.5f }, { 4.5f, -2, 4.5f } };
+    for (int i = 0; i < 4; i++) {
+        baker.AddPointLight(PointLight(corners[i], QuadAttenuation(1.0f, 0.7f, 1.8f),
+            glm::vec3(0.0f), cornerColors[i], cornerColors[i]));
+    }
+
+    auto platformTransform = glm::translate(glm::mat4(1.0f), glm::vec3(0, -3, 0));
+    int platform = baker.AddMesh(Geometry::Cuboid(10.0f, 1.0f, 10.0f), platformTransform, glm::vec3(0.5f, 0.5f, 0.45f));
+
+    auto backpackTransform = glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0, 1, 0));
+    auto backpackMeshes = Geometry::LoadModel(MODELS_DIR "backpack/backpack.obj");
+    std::vector<int> backpack;
+    for (auto& mesh : backpackMeshes) {
+        backpack.push_back(baker.AddMesh(mesh, backpackTransform));
+    }
+
+    std::cout << "baking with " << Parallel::ThreadCount() << " threads: "
+        << settings.texelsPerUnit << " texels per unit, "
+        << settings.samples << " samples, "
+        << settings.bounces << " bounces" << std::endl;
+
+    auto lightmaps = baker.Bake(settings);
+    auto& stats = baker.LastStats();
+    std::cout << stats.triangles << " triangles, " << stats.texels << " texels, "
+        << stats.rays << " rays" << std::endl;
+    std::cout << "  setup " << stats.buildMilliseconds << " ms, trace " << stats.traceMilliseconds << " ms ("
+        << (stats.traceMilliseconds > 0.0 ? stats.rays / stats.traceMilliseconds / 1000.0 : 0.0) << " Mrays/s)" << std::endl;
+
+    bool written = write(lightmaps[platform], outputDir, "platform");
+    for (size_t i = 0; i < backpack.size(); i++) {
+        written = write(lightmaps[backpack[i]], outputDir, "backpack_" + std::to_string(i)) && written;
+    }
+
+    // probes from just above the platform top (y = -2.5) to above the backpack
+    auto probes = baker.BakeProbes(glm::vec3(-5.0f, -2.25f, -5.0f), glm::vec3(5.0f, 2.75f, 5.0f), glm::ivec3(9, 5, 9), settings);
+    std::cout << stats.probes << " probes, " << stats.rays << " rays, trace " << stats.traceMilliseconds << " ms" << std::endl;
+
+    auto probesPath = outputDir / "probes.grid";
+    written = probes.Save(probesPath.string()) && written;
+    std::cout << "  " << probesPath.string() << std::endl;
+
+    return written ? 0 : 1;
+}
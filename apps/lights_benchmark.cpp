@@ -0,0 +1,271 @@
+#include <resources.h>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <random>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <rendersystem/Shader.h>
+#include <rendersystem/ShaderCache.h>
+#include <rendersystem/ShaderVariants.h>
+#include <rendersystem/Camera.h>
+#include <rendersystem/Mesh.h>
+#include <rendersystem/Primitives.h>
+#include <rendersystem/GLHandle.h>
+#include <rendersystem/GeometryPool.h>
+#include <rendersystem/Lights.h>
+#include <rendersystem/LightingSystem.h>
+#include <rendersystem/LightClusters.h>
+#include <rendersystem/LightTree.h>
+#include <rendersystem/FrameConstants.h>
+#include <rendersystem/Parallel.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// renders the same lit scene offscreen with an increasing number of point lights and
+// reports the frame time of the forward path (every light in the Lights block, for every
+// fragment) against the clustered path (LightClusters), with every light in range of a
+// cluster or with a cut of the LightTree, where distant groups of lights are merged.
+// usage: bench_lights [frames per measurement] [light tree error budget]
+
+// settings
+const unsigned int SCR_WIDTH = 1920;
+const unsigned int SCR_HEIGHT = 1080;
+const int LIGHT_COUNTS[] = { 16, 64, 192, 1024, 4096 };
+const int WARMUP_FRAMES = 10;
+float near = 0.1f;
+float far = 100.0f;
+
+// average milliseconds per frame of draw(), waiting for the GPU after every frame
+template <typename F>
+double timeFrames(int frames, F draw) {
+    for (int i = 0; i < WARMUP_FRAMES; i++) {
+        draw();
+    }
+    glFinish();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        draw();
+        glFinish();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / frames;
+}
+
+int main(int argc, char** argv)
+{
+    int frames = argc > 1 ? std::max(1, std::stoi(argv[1])) : 100;
+    float errorBudget = argc > 2 ? std::max(0.0f, std::stof(argv[2])) : 0.02f;
+
+    // glfw: initialize and configure, the window is only there for the context
+    // ------------------------------
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "bench_lights", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    // the scene lives in its own scope, so everything it owns releases its GL objects
+    // while the context is still current
+    {
+        // offscreen target so the window system never throttles the measurement
+        auto FBO = GLFramebuffer::Create();
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO.Get());
+        auto colorRBO = GLRenderbuffer::Create();
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRBO.Get());
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO.Get());
+        auto depthRBO = GLRenderbuffer::Create();
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRBO.Get());
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO.Get());
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ERROR::FRAMEBUFFER::NOT_COMPLETE" << std::endl;
+            return -1;
+        }
+        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        glEnable(GL_DEPTH_TEST);
+
+        // scene: a large textured floor with a grid of spheres, seen from above at an angle
+        // ------------------------------------------------------------------
+        Camera camera(glm::vec3(0.0f, 12.0f, 30.0f));
+        camera.ProcessMouseMovement(0.0f, -50.0f); // pitch down 25 degrees
+        float aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+
+        FrameConstants frameConstants;
+        frameConstants.Update(camera, aspect, near, far);
+
+        std::vector<std::shared_ptr<ControlledMesh>> scene;
+        auto floor = std::make_shared<ControlledMesh>(ControlledMesh::CreateCuboid(60.0f, 1.0f, 60.0f));
+        floor->AddTexture(ASSETS_DIR "cobble.jpg", "texture_diffuse");
+        floor->SetPosition(glm::vec3{ 0, -1, 0 });
+        scene.push_back(floor);
+
+        // every sphere is a copy of one, sharing its buffers and texture. icospheres, as
+        // round as the uv sphere of the same resolution with fewer triangles
+        {
+            auto prototype = ControlledMesh::CreateIcosphere(0.8f);
+            prototype.AddTexture(ASSETS_DIR "cobble.jpg", "texture_diffuse");
+            for (int x = -5; x <= 5; x++) {
+                for (int z = -5; z <= 5; z++) {
+                    auto sphere = std::make_shared<ControlledMesh>(prototype);
+                    sphere->SetPosition(glm::vec3{ x * 5.0f, 0.5f, z * 5.0f });
+                    scene.push_back(sphere);
+                }
+            }
+        }
+
+        ShaderFeatures forwardFeatures;
+        forwardFeatures.directionalLights = 0;
+        scene.front()->MaterialFeatures(forwardFeatures);
+        ShaderFeatures clusteredFeatures = forwardFeatures;
+        clusteredFeatures.clustered = true;
+
+        ShaderVariants variants(SHADERS_DIR "colors.vert", SHADERS_DIR "colors.frag");
+        const Shader& forwardShader = variants.Get(forwardFeatures).Get();
+        const Shader& clusteredShader = variants.Get(clusteredFeatures).Get();
+
+        auto drawScene = [&](const Shader& shader) {
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            shader.use();
+            for (auto& obj : scene) {
+                obj->Draw(shader);
+            }
+        };
+
+        {
+            // the scene's requests, before the uv sphere generated only to compare with
+            auto primitives = Primitives::GetStats();
+            auto& icosphere = *Primitives::Icosphere(0.8f);
+            auto uvSphere = Primitives::Sphere(0.8f);
+            std::cout << "spheres: " << icosphere.Triangles() << " triangles, " << icosphere.vertices.size()
+                << " vertices (uv sphere " << uvSphere->Triangles() << ", " << uvSphere->vertices.size() << "), "
+                << primitives.created << " of " << primitives.requests << " primitives generated" << std::endl;
+        }
+
+        std::cout << "bench_lights: " << SCR_WIDTH << "x" << SCR_HEIGHT << ", " << frames << " frames per run, "
+            << Parallel::ThreadCount() << " culling threads, light tree error budget " << errorBudget << std::endl;
+        std::cout << std::setw(8) << "lights"
+            << std::setw(14) << "forward ms"
+            << std::setw(16) << "clustered ms"
+            << std::setw(10) << "cull ms"
+            << std::setw(14) << "lights/frag"
+            << std::setw(14) << "lightcut ms"
+            << std::setw(10) << "cull ms"
+            << std::setw(14) << "cut/frag" << std::endl;
+
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> spread(-30.0f, 30.0f);
+        std::uniform_real_distribution<float> height(0.0f, 3.0f);
+        std::uniform_real_distribution<float> hue(0.2f, 1.0f);
+
+        for (int count : LIGHT_COUNTS) {
+            // short ranged lights, the way a scene with thousands of them would be lit
+            LightingSystem lighting;
+            for (int i = 0; i < count; i++) {
+                glm::vec3 color(hue(rng), hue(rng), hue(rng));
+                lighting.AddPointLight(PointLight(
+                    glm::vec3(spread(rng), height(rng), spread(rng)),
+                    QuadAttenuation(1.0f, 0.7f, 1.8f),
+                    glm::vec3(0.0f),
+                    color,
+                    color));
+            }
+            lighting.Upload();
+
+            LightClusters clusters;
+            double forwardMs = -1.0;
+            if (count <= LightingSystem::MAX_POINT_LIGHTS) {
+                forwardMs = timeFrames(frames, [&]() {
+                    drawScene(forwardShader);
+                });
+            }
+
+            double cullMs = 0.0;
+            double clusteredMs = timeFrames(frames, [&]() {
+                // the cull runs every frame as it would with a moving camera
+                clusters.Build(lighting.PointLights(), frameConstants.Data().view, glm::radians(camera.Zoom), aspect, near, far);
+                cullMs += clusters.LastStats().cullMilliseconds;
+                clusteredShader.use();
+                clusters.Bind(clusteredShader, lighting, SCR_WIDTH, SCR_HEIGHT);
+                drawScene(clusteredShader);
+            });
+            cullMs /= frames + WARMUP_FRAMES;
+
+            auto& stats = clusters.LastStats();
+            double perCluster = stats.occupiedClusters > 0 ? (double)stats.assignments / stats.occupiedClusters : 0.0;
+
+            // the tree is refit every frame, as the lights of a live scene would move
+            LightTree tree;
+            tree.SetErrorBudget(errorBudget);
+            LightClusters cutClusters;
+            double treeCullMs = 0.0;
+            double treeMs = timeFrames(frames, [&]() {
+                tree.Update(lighting.PointLights());
+                cutClusters.Build(tree, frameConstants.Data().view, glm::radians(camera.Zoom), aspect, near, far);
+                treeCullMs += tree.LastStats().updateMilliseconds + cutClusters.LastStats().cullMilliseconds;
+                clusteredShader.use();
+                cutClusters.Bind(clusteredShader, lighting, SCR_WIDTH, SCR_HEIGHT);
+                drawScene(clusteredShader);
+            });
+            treeCullMs /= frames + WARMUP_FRAMES;
+
+            auto& cutStats = cutClusters.LastStats();
+            double perCut = cutStats.occupiedClusters > 0 ? (double)cutStats.assignments / cutStats.occupiedClusters : 0.0;
+
+            std::cout << std::fixed << std::setprecision(3) << std::setw(8) << count;
+            if (forwardMs < 0.0) {
+                std::cout << std::setw(14) << "n/a";
+            }
+            else {
+                std::cout << std::setw(14) << forwardMs;
+            }
+            std::cout << std::setw(16) << clusteredMs
+                << std::setw(10) << cullMs
+                << std::setw(14) << perCluster
+                << std::setw(14) << treeMs
+                << std::setw(10) << treeCullMs
+                << std::setw(14) << perCut << std::endl;
+        }
+        std::cout << "forward is n/a above " << LightingSystem::MAX_POINT_LIGHTS
+            << " lights, the Lights block can't hold more" << std::endl;
+        ShaderCache::PrintReport();
+    }
+
+    // nothing the scene owned may outlive it (Shutdown() reports pool ranges left)
+    GeometryPool::Shutdown();
+    if (GLObjects::Live() != 0) {
+        std::cout << "WARNING::GL::LEAKED_OBJECTS " << GLObjects::Live() << " handles" << std::endl;
+    }
+
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <resources.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include <rendersystem/Geometry.h>
+#include <rendersystem/Meshlets.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// cuts models into Meshlets the way Model does when loading and reports how many of
+// their triangles the cone and frustum culling rejects, seen from views all around
+// them: one ring of views framing the whole model and one close up, where part of it
+// is off screen. no window or GL context is created.
+// usage: bench_meshlets [model paths...]
+
+// settings
+const int VIEWS = 128;
+const float FOV_Y = 45.0f;
+const float ASPECT = 16.0f / 9.0f;
+const float FAR_DISTANCE = 2.5f;  // in model radii from the center
+const float NEAR_DISTANCE = 1.2f;
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        paths = { MODELS_DIR "backpack/backpack.obj", MODELS_DIR "lego/lego obj.obj" };
+    }
+
+    for (auto& path : paths) {
+        auto meshes = Geometry::LoadModel(path);
+        if (meshes.empty()) {
+            std::cout << "ERROR::MESHLETS_BENCHMARK::NO_MESHES " << path << std::endl;
+            continue;
+        }
+
+        std::vector<Meshlets> meshlets;
+        size_t clusters = 0;
+        size_t triangles = 0;
+        glm::vec3 lo(std::numeric_limits<float>::max());
+        glm::vec3 hi(-std::numeric_limits<float>::max());
+        for (auto& mesh : meshes) {
+            meshlets.push_back(Meshlets::Build(mesh));
+            clusters += meshlets.back().Count();
+            triangles += Geometry::Triangles(mesh).size() / 3;
+            for (auto& v : mesh.vertices) {
+                lo = glm::min(lo, v.Position);
+                hi = glm::max(hi, v.Position);
+            }
+        }
+        glm::vec3 center = (lo + hi) * 0.5f;
+        float radius = glm::length(hi - lo) * 0.5f;
+
+        std::cout << path << ": " << meshes.size() << " meshes, " << triangles << " triangles in " << clusters
+            << " meshlets (" << (clusters > 0 ? (float)triangles / clusters : 0.0f) << " triangles each)" << std::endl;
+
+        std::vector<Meshlets::Range> visible;
+        for (float distance : { FAR_DISTANCE, NEAR_DISTANCE }) {
+            Meshlets::Stats stats;
+            double microseconds = 0.0;
+            for (int view = 0; view < VIEWS; view++) {
+                // a fibonacci spiral over the sphere of directions
+                float y = 1.0f - 2.0f * (view + 0.5f) / VIEWS;
+                float ring = std::sqrt(1.0f - y * y);
+                float phi = view * 2.39996323f;
+                glm::vec3 eye = center + glm::vec3(std::cos(phi) * ring, y, std::sin(phi) * ring) * radius * distance;
+                glm::vec3 up = std::abs(y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+                auto viewProjection = glm::perspective(glm::radians(FOV_Y), ASPECT, radius * 0.01f, radius * 10.0f) *
+                    glm::lookAt(eye, center, up);
+                auto frustum = Meshlets::FrustumPlanes(viewProjection);
+
+                auto start = std::chrono::steady_clock::now();
+                for (auto& m : meshlets) {
+                    m.Cull(eye, frustum, visible, &stats);
+                }
+                auto end = std::chrono::steady_clock::now();
+                microseconds += std::chrono::duration<double, std::micro>(end - start).count();
+            }
+
+            stats.Print(distance == FAR_DISTANCE ? "  whole model in view" : "  close up");
+            std::cout << "    " << microseconds / VIEWS << " us per view" << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -9,9 +9,13 @@
 #include <assimp/mesh.h>
 #include <rendersystem/Mesh.h>
 #include <rendersystem/Shader.h>
+#include <rendersystem/ShaderCache.h>
 #include <rendersystem/Camera.h>
 #include <rendersystem/Model.h>
+#include <rendersystem/GeometryPool.h>
 #include <rendersystem/Lights.h>
+#include <rendersystem/LightingSystem.h>
+#include <rendersystem/FrameConstants.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -74,151 +78,146 @@ int main()
         return -1;
     }
 
-    // configure global opengl state
-    // -----------------------------
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_STENCIL_TEST);
-
-    // build and compile our shader zprogram
-    // ------------------------------------
-
-    // build and compile our shader zprogram
-    // ------------------------------------
-    Shader loadedModelShader(SHADERS_DIR "colors.vert", SHADERS_DIR "colors.frag");
-    Shader defaultShader(SHADERS_DIR "colors.vert", SHADERS_DIR "colors.frag");
-    Shader lightCubeShader(SHADERS_DIR "light_cube.vert", SHADERS_DIR "light_cube.frag");
-    Shader shaderSingleColor(SHADERS_DIR "single_color.vert", SHADERS_DIR "single_color.frag");
-    PointLight mainLight = PointLight::DefaultPointLight();
-    DirectionalLight dirLight = DirectionalLight::DefaultDirectionalLight();
-
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    // ------------------------------------------------------------------
-    auto lightCube = ControlledMesh::CreateCube(0.2f);
-    lightCube.SetAxis(glm::vec3{ 0, 1, 0 });
-    lightCube.SetColor(glm::vec3{ 1, 1, 1 });
-
-    auto platform = ControlledMesh::CreateCuboid(10.0f, 1.0f, 10.0f);
-    platform.SetAxis(glm::vec3{ 0, 1, 0 });
-    platform.AddTexture(ASSETS_DIR "awesome.png", "texture_diffuse");
-    platform.SetPosition(glm::vec3{ 0, -3, 0 });
-
-    auto sphere = ControlledMesh::CreateSphere(0.5f);
-    sphere.SetAxis(glm::vec3{ 0, 1, 0 });
-    sphere.SetPosition(glm::vec3{ 0, 0, -3 });
-    sphere.AddTexture(ASSETS_DIR "eye.png", "texture_diffuse");
-
-    auto sphere_outline(sphere);
-    sphere_outline.SetScale(1.1f);
-
-    // load model
-    Model loaded_model(MODELS_DIR "backpack/backpack.obj");
-    loaded_model.Rotate(180.0f);
-
-    // render loop
-    // -----------
-    while (!glfwWindowShouldClose(window))
+    // the scene lives in its own scope, so everything it owns releases its GL objects
+    // while the context is still current
     {
-        // per-frame time logic
-        // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        // input
-        // -----
-        processInput(window);
-
-        // render
-        // ------
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-        glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-        glStencilMask(0x00);
-
-        if (camRot) {
-            camera.Rotate((float)glm::radians(0.01f), glm::vec3(0.0f, 1.0f, 0.0f));
-        }
-
-        // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, near, far);
-        glm::mat4 view = camera.GetViewMatrix();
-
-        // rotate the light
-        glm::quat rot = glm::angleAxis((float)glm::radians(50.0f * deltaTime),
-            glm::vec3(0.0f, 1.0f, 0.0f));
-        lightPos = rot * glm::vec4(lightPos, 1.0f);
-
-        // also draw the lamp object
-        lightCubeShader.use();
-        lightCubeShader.setMat4("projection", projection);
-        lightCubeShader.setMat4("view", view);
-
-        lightCube.SetPosition(lightPos);
-        lightCube.Draw(lightCubeShader);
-
-        mainLight.SetPosition(lightPos);
-
-        // draw default shaded models
-        defaultShader.use();
-        loadedModelShader.use();
-        // set up the light
-        mainLight.SetShader(defaultShader, 0);
-        mainLight.SetShader(loadedModelShader, 0);
-
-        dirLight.SetShader(defaultShader, 0);
-        dirLight.SetShader(loadedModelShader, 0);
-
-        defaultShader.setVec3("viewPos", camera.Position);
-        defaultShader.setMat4("projection", projection);
-        defaultShader.setMat4("view", view);
-        defaultShader.setFloat("near", near);
-        defaultShader.setFloat("far", far);
-        defaultShader.setBool("enableVisualiseDepthBuffer", false);
-
-        loadedModelShader.setVec3("viewPos", camera.Position);
-        loadedModelShader.setMat4("projection", projection);
-        loadedModelShader.setMat4("view", view);
-        loadedModelShader.setFloat("near", near);
-        loadedModelShader.setFloat("far", far);
-        loadedModelShader.setBool("enableVisualiseDepthBuffer", false);
-
-
-        loaded_model.Draw(loadedModelShader);
-
-        // defaultShader users
-        platform.Draw(defaultShader);
-
-        // stencil
-        glStencilFunc(GL_ALWAYS, 1, 0xFF);
-        glStencilMask(0xFF);
-
-        sphere.Draw(defaultShader);
-
-        // draw the upscaled sphere
-        glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
-        glStencilMask(0x00);
-        glDisable(GL_DEPTH_TEST);
-        shaderSingleColor.use();
-        shaderSingleColor.setMat4("projection", projection);
-        shaderSingleColor.setMat4("view", view);
-        sphere_outline.Draw(shaderSingleColor);
-
-        glStencilMask(0xFF);
-        glStencilFunc(GL_ALWAYS, 1, 0xFF);
+        // configure global opengl state
+        // -----------------------------
         glEnable(GL_DEPTH_TEST);
+        glEnable(GL_STENCIL_TEST);
+
+        // build and compile our shader zprogram
+        // ------------------------------------
+
+        // build and compile our shader zprogram
+        // ------------------------------------
+        // the backpack is quantized (see below), its program decodes the vertices
+        Shader loadedModelShader(SHADERS_DIR "colors.vert", SHADERS_DIR "colors.frag", "#define QUANTIZED\n");
+        Shader defaultShader(SHADERS_DIR "colors.vert", SHADERS_DIR "colors.frag");
+        Shader lightCubeShader(SHADERS_DIR "light_cube.vert", SHADERS_DIR "light_cube.frag");
+        Shader shaderSingleColor(SHADERS_DIR "single_color.vert", SHADERS_DIR "single_color.frag");
+        ShaderCache::PrintReport();
+        FrameConstants frameConstants;
+        LightingSystem lighting;
+        int mainLight = lighting.AddPointLight(PointLight::DefaultPointLight());
+        lighting.AddDirectionalLight(DirectionalLight::DefaultDirectionalLight());
+
+        // set up vertex data (and buffer(s)) and configure vertex attributes
+        // ------------------------------------------------------------------
+        auto lightCube = ControlledMesh::CreateCube(0.2f);
+        lightCube.SetAxis(glm::vec3{ 0, 1, 0 });
+        lightCube.SetColor(glm::vec3{ 1, 1, 1 });
+
+        auto platform = ControlledMesh::CreateCuboid(10.0f, 1.0f, 10.0f);
+        platform.SetAxis(glm::vec3{ 0, 1, 0 });
+        platform.AddTexture(ASSETS_DIR "awesome.png", "texture_diffuse");
+        platform.SetPosition(glm::vec3{ 0, -3, 0 });
+
+        auto sphere = ControlledMesh::CreateSphere(0.5f);
+        sphere.SetAxis(glm::vec3{ 0, 1, 0 });
+        sphere.SetPosition(glm::vec3{ 0, 0, -3 });
+        sphere.AddTexture(ASSETS_DIR "eye.png", "texture_diffuse");
+
+        // the copy shares the sphere's buffers, only its transform is its own
+        auto sphere_outline(sphere);
+        sphere_outline.SetScale(1.1f);
+
+        // load model, in the 16 byte QuantizedVertex layout: half the vertex memory and
+        // fetch of full floats. the load prints the bytes saved and the largest errors.
+        // quantized meshes stay out of the geometry pools, which only costs this demo a
+        // draw call per mesh
+        Model loaded_model(MODELS_DIR "backpack/backpack.obj", VertexEncoding::Quantized);
+        loaded_model.Rotate(180.0f);
+
+        // render loop
+        // -----------
+        while (!glfwWindowShouldClose(window))
+        {
+            // per-frame time logic
+            // --------------------
+            float currentFrame = glfwGetTime();
+            deltaTime = currentFrame - lastFrame;
+            lastFrame = currentFrame;
+
+            // input
+            // -----
+            processInput(window);
+
+            // render
+            // ------
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+            glStencilMask(0x00);
+
+            if (camRot) {
+                camera.Rotate((float)glm::radians(0.01f), glm::vec3(0.0f, 1.0f, 0.0f));
+            }
+
+            // view/projection transformations, shared by every shader through the FrameConstants block
+            frameConstants.Update(camera, (float)SCR_WIDTH / (float)SCR_HEIGHT, near, far);
+
+            // rotate the light
+            glm::quat rot = glm::angleAxis((float)glm::radians(50.0f * deltaTime),
+                glm::vec3(0.0f, 1.0f, 0.0f));
+            lightPos = rot * glm::vec4(lightPos, 1.0f);
+
+            // also draw the lamp object
+            lightCubeShader.use();
+
+            lightCube.SetPosition(lightPos);
+            lightCube.Draw(lightCubeShader);
+
+            // set up the light
+            lighting.EditPointLight(mainLight)->SetPosition(lightPos);
+            lighting.Upload();
+
+            // draw default shaded models
+            loadedModelShader.use();
+            defaultShader.setBool("enableVisualiseDepthBuffer", false);
+
+            loadedModelShader.setBool("enableVisualiseDepthBuffer", false);
+
+
+            loaded_model.Draw(loadedModelShader);
+
+            // defaultShader users
+            defaultShader.use();
+            platform.Draw(defaultShader);
+
+            // stencil
+            glStencilFunc(GL_ALWAYS, 1, 0xFF);
+            glStencilMask(0xFF);
+
+            sphere.Draw(defaultShader);
+
+            // draw the upscaled sphere
+            glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
+            glStencilMask(0x00);
+            glDisable(GL_DEPTH_TEST);
+            shaderSingleColor.use();
+            sphere_outline.Draw(shaderSingleColor);
+
+            glStencilMask(0xFF);
+            glStencilFunc(GL_ALWAYS, 1, 0xFF);
+            glEnable(GL_DEPTH_TEST);
 
-        sphere.Rotate(100.0f * deltaTime);
+            sphere.Rotate(100.0f * deltaTime);
 
         
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+            // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+            // -------------------------------------------------------------------------------
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
 
+    // the pools meshes were allocated from, now that every mesh is gone
+    GeometryPool::Shutdown();
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+
+// a bounding sphere in world space (or model space, before Transformed()).
+// the default sphere is unbounded and intersects everything
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = std::numeric_limits<float>::max();
+
+    BoundingSphere() = default;
+    BoundingSphere(const glm::vec3& center, float radius) : center(center), radius(radius) {}
+
+    bool Unbounded() const {
+        return radius == std::numeric_limits<float>::max();
+    }
+
+    bool Intersects(const glm::vec3& point, float pointRadius) const {
+        if (Unbounded()) return true;
+
+        float reach = radius + pointRadius;
+        glm::vec3 d = point - center;
+        return glm::dot(d, d) <= reach * reach;
+    }
+
+    // the smallest sphere holding both
+    BoundingSphere Merge(const BoundingSphere& other) const {
+        if (Unbounded() || other.Unbounded()) return BoundingSphere();
+
+        glm::vec3 d = other.center - center;
+        float distance = glm::length(d);
+        if (distance + other.radius <= radius) return *this;
+        if (distance + radius <= other.radius) return other;
+
+        float r = (distance + radius + other.radius) * 0.5f;
+        return BoundingSphere(center + d * ((r - radius) / distance), r);
+    }
+
+    // the sphere after an affine transform, grown by the largest axis scale
+    BoundingSphere Transformed(const glm::mat4& m) const {
+        if (Unbounded()) return *this;
+
+        float scale = std::max({
+            glm::length(glm::vec3(m[0])),
+            glm::length(glm::vec3(m[1])),
+            glm::length(glm::vec3(m[2])) });
+        return BoundingSphere(glm::vec3(m * glm::vec4(center, 1.0f)), radius * scale);
+    }
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rendersystem/Camera.h>
+#include <rendersystem/Mesh.h>
+#include <rendersystem/Shader.h>
+#include <rendersystem/GpuTimer.h>
+#include <rendersystem/GLHandle.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// cascaded shadow maps for one directional light, read by the SHADOWS variant of colors.frag.
+// each cascade covers a slice of the camera frustum with a bounding sphere, so its size
+// doesn't change as the camera turns, and the sphere is snapped to a coarse grid in light
+// space so the cascade only moves every few steps of the camera.
+// casters are split in two: static ones are rendered into a cached map that's only
+// redrawn when its cascade moves or a static caster changes, dynamic ones are drawn over
+// a copy of it, and only in the cascades they moved in. untouched cascades are skipped
+class CascadedShadows {
+public:
+    static const int MAX_CASCADES = 4;
+
+    // texture unit the shadow maps are bound to, below the LightClusters units
+    static const int SHADOW_UNIT = 12;
+
+    struct CascadeStats {
+        float splitFar = 0.0f;        // view space depth the cascade ends at
+        unsigned int casters = 0;     // casters overlapping the cascade
+        bool staticRebuilt = false;   // the cached static map was redrawn
+        bool rendered = false;        // the cascade was updated at all this frame
+        double gpuMilliseconds = -1.0; // GPU time of the last update of this cascade (a few frames late)
+    };
+
+    struct Stats {
+        CascadeStats cascades[MAX_CASCADES];
+        unsigned int rendered = 0;
+        unsigned int skipped = 0;
+    };
+
+    // shaderDir is the folder holding the shadow_depth shaders. shadowDistance is how far
+    // from the camera shadows reach, splitLambda blends logarithmic (1) and even (0) splits
+    CascadedShadows(const std::string& shaderDir, int cascades = 4, int resolution = 2048,
+        float shadowDistance = 50.0f, float splitLambda = 0.75f);
+
+    CascadedShadows(const CascadedShadows&) = delete;
+    CascadedShadows& operator=(const CascadedShadows&) = delete;
+
+    // static casters are expected to stay put; moving one anyway invalidates the cached
+    // maps of the cascades it leaves and enters
+    void AddCaster(std::shared_ptr<Drawable> caster, bool isStatic);
+
+    // fits the cascades to the camera and redraws the ones that changed. leaves
+    // framebuffer 0 bound and restores the viewport
+    void Update(Camera& camera, float aspect, float near, float far, const glm::vec3& lightDirection);
+
+    // binds the shadow maps and sets the cascade uniforms on a SHADOWS shader
+    void Bind(const Shader& shader) const;
+
+    // forces every cascade to be redrawn, static maps included
+    void Invalidate();
+
+    const Stats& LastStats() const {
+        return stats;
+    }
+
+    int CascadeCount() const {
+        return cascadeCount;
+    }
+
+private:
+    int cascadeCount;
+    int resolution;
+    float shadowDistance;
+    float splitLambda;
+
+    // depth arrays: the sampled maps and the static only copies they're restored from
+    GLTexture shadowMaps, staticMaps;
+    GLFramebuffer drawFBO, readFBO;
+
+    Shader depthShader;
+
+    struct Cascade {
+        glm::mat4 lightViewProjection = glm::mat4(0.0f);
+        float splitFar = 0.0f;
+        glm::vec2 center;    // light space xy the cascade is centred on
+        float halfSize = 0;  // half the width of the cascade in light space
+        float farDepth = 0;  // light space depth of the far plane
+        bool staticDirty = true;
+        bool dynamicDirty = true;
+        GpuTimer timer;
+    };
+    Cascade cascades[MAX_CASCADES];
+
+    struct Caster {
+        std::shared_ptr<Drawable> drawable;
+        bool isStatic;
+        glm::mat4 transform = glm::mat4(0.0f);
+        unsigned int cascadeMask = 0; // cascades it overlapped last frame
+    };
+    std::vector<Caster> casters;
+
+    glm::mat4 lightView = glm::mat4(1.0f);
+
+    Stats stats;
+
+    // fits cascade i to a slice of the camera frustum
+    void fitCascade(int i, Camera& camera, float aspect, float sliceNear, float sliceFar);
+
+    // cascades the bounds overlap, as a bit mask
+    unsigned int overlappedCascades(const BoundingSphere& bounds) const;
+
+    void renderCasters(int cascade, bool staticCasters);
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rendersystem/Shader.h>
+#include <rendersystem/ShaderQueue.h>
+#include <rendersystem/ShaderVariants.h>
+#include <rendersystem/LightingSystem.h>
+#include <rendersystem/LightClusters.h>
+#include <rendersystem/CascadedShadows.h>
+#include <rendersystem/PointShadows.h>
+#include <rendersystem/GLHandle.h>
+
+#include <string>
+
+// deferred alternative to forward shading with colors.frag. opaque geometry is drawn
+// once into a G-buffer (gbuffer.frag), then one full screen pass (deferred_lighting.frag)
+// shades every pixel exactly once, with the point lights of its LightClusters cluster.
+// G-buffer layout, 20 bytes per pixel:
+//   0: RGBA8   diffuse albedo, a: shininess / 256
+//   1: RGBA8   specular color
+//   2: RG16F   octahedral encoded world space normal
+//   3: RGBA8   material.ambient
+//   depth: DEPTH24_STENCIL8, world position is rebuilt from it
+class DeferredRenderer {
+public:
+    // shaderDir is the folder holding colors.vert, gbuffer.frag and the deferred_lighting shaders
+    DeferredRenderer(int width, int height, const std::string& shaderDir, ShaderQueue* queue = nullptr);
+
+    DeferredRenderer(const DeferredRenderer&) = delete;
+    DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+    // reallocates the G-buffer if the size changed
+    void Resize(int width, int height);
+
+    // program writing the G-buffer for a material. only the material features
+    // (alphaTest, specularMap) matter, the light set is ignored
+    ShaderFuture GeometryShader(ShaderFeatures features);
+
+    // binds and clears the G-buffer. opaque drawables are drawn after this with a GeometryShader()
+    void BeginGeometryPass();
+
+    // shades the G-buffer into targetFBO, then copies the depth buffer across so forward
+    // passes (transparent objects, light gizmos) can be drawn on top. the first directional
+    // light is shadowed by shadows and the point lights by pointShadows, when given; each
+    // combination is a program of its own, built on first use. returns false without
+    // drawing anything while that program is still building
+    bool LightingPass(const LightingSystem& lighting, const LightClusters& clusters,
+        const CascadedShadows* shadows = nullptr, const PointShadows* pointShadows = nullptr, unsigned int targetFBO = 0);
+
+    int Width() const {
+        return width;
+    }
+
+    int Height() const {
+        return height;
+    }
+
+private:
+    int width = 0;
+    int height = 0;
+
+    GLFramebuffer FBO;
+    GLTexture albedo, specular, normal, ambient, depth;
+    GLVertexArray emptyVAO; // the full screen triangle is generated from gl_VertexID
+
+    ShaderVariants geometryVariants;
+    std::string shaderDir;
+    ShaderQueue* queue;
+    ShaderFuture lightingShaders[4]; // by shadows + 2 * point shadows
+
+    const ShaderFuture& lightingShader(bool shadows, bool pointShadows);
+
+    void createTargets();
+};
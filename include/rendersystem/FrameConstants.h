@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rendersystem/Camera.h>
+#include <rendersystem/UniformBlocks.h>
+#include <rendersystem/GLHandle.h>
+
+// std140 layout of the FrameConstants uniform block, see shaders/*.vert
+struct FrameConstantsData {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 cameraPos;  // xyz: camera position in world space
+    glm::vec4 depthRange; // x: near plane, y: far plane
+};
+
+// camera constants shared by every shader through one uniform buffer, uploaded once
+// per frame instead of being set on each program
+class FrameConstants {
+public:
+    FrameConstants();
+
+    FrameConstants(const FrameConstants&) = delete;
+    FrameConstants& operator=(const FrameConstants&) = delete;
+
+    // recomputes the constants from the camera and uploads them if anything changed
+    void Update(Camera& camera, float aspect, float near, float far);
+
+    const FrameConstantsData& Data() const {
+        return data;
+    }
+
+private:
+    GLBuffer UBO;
+    FrameConstantsData data;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <utility>
+
+// the kinds of GL object a GLHandle can own
+enum class GLObject {
+    Buffer,
+    VertexArray,
+    Texture,
+    Framebuffer,
+    Renderbuffer,
+    Query,
+    Program,
+    Count
+};
+
+// how many GL objects handles currently own. once everything that draws has been
+// destroyed Live() has to be back to where it started, anything else is a leak
+namespace GLObjects {
+    long Live();
+    long Live(GLObject kind);
+
+    // bookkeeping for GLHandle
+    void Created(GLObject kind);
+    void Destroyed(GLObject kind);
+}
+
+// move only owner of one GL object name, deleted when the handle is destroyed or
+// assigned over. an empty handle holds 0
+template <GLObject Kind>
+class GLHandle {
+public:
+    GLHandle() = default;
+
+    // takes over a name made elsewhere (e.g. by Utils::TextureFromFile)
+    explicit GLHandle(GLuint id) : id(id) {
+        if (id != 0) GLObjects::Created(Kind);
+    }
+
+    // generates a new object
+    static GLHandle Create() {
+        GLuint id = 0;
+        if constexpr (Kind == GLObject::Buffer) glGenBuffers(1, &id);
+        else if constexpr (Kind == GLObject::VertexArray) glGenVertexArrays(1, &id);
+        else if constexpr (Kind == GLObject::Texture) glGenTextures(1, &id);
+        else if constexpr (Kind == GLObject::Framebuffer) glGenFramebuffers(1, &id);
+        else if constexpr (Kind == GLObject::Renderbuffer) glGenRenderbuffers(1, &id);
+        else if constexpr (Kind == GLObject::Query) glGenQueries(1, &id);
+        else if constexpr (Kind == GLObject::Program) id = glCreateProgram();
+        return GLHandle(id);
+    }
+
+    ~GLHandle() {
+        Reset();
+    }
+
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+
+    GLHandle(GLHandle&& other) noexcept : id(std::exchange(other.id, 0)) {}
+
+    GLHandle& operator=(GLHandle&& other) noexcept {
+        if (this != &other) {
+            Reset();
+            id = std::exchange(other.id, 0);
+        }
+        return *this;
+    }
+
+    GLuint Get() const {
+        return id;
+    }
+
+    explicit operator bool() const {
+        return id != 0;
+    }
+
+    // deletes the object now
+    void Reset() {
+        if (id == 0) return;
+        if constexpr (Kind == GLObject::Buffer) glDeleteBuffers(1, &id);
+        else if constexpr (Kind == GLObject::VertexArray) glDeleteVertexArrays(1, &id);
+        else if constexpr (Kind == GLObject::Texture) glDeleteTextures(1, &id);
+        else if constexpr (Kind == GLObject::Framebuffer) glDeleteFramebuffers(1, &id);
+        else if constexpr (Kind == GLObject::Renderbuffer) glDeleteRenderbuffers(1, &id);
+        else if constexpr (Kind == GLObject::Query) glDeleteQueries(1, &id);
+        else if constexpr (Kind == GLObject::Program) glDeleteProgram(id);
+        GLObjects::Destroyed(Kind);
+        id = 0;
+    }
+
+private:
+    GLuint id = 0;
+};
+
+using GLBuffer = GLHandle<GLObject::Buffer>;
+using GLVertexArray = GLHandle<GLObject::VertexArray>;
+using GLTexture = GLHandle<GLObject::Texture>;
+using GLFramebuffer = GLHandle<GLObject::Framebuffer>;
+using GLRenderbuffer = GLHandle<GLObject::Renderbuffer>;
+using GLQuery = GLHandle<GLObject::Query>;
+using GLProgram = GLHandle<GLObject::Program>;
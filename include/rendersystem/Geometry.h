@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <string>
+#include <vector>
+
+struct aiMesh;
+
+struct Vertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+
+    Vertex(glm::vec3 pos, glm::vec3 norm, glm::vec2 tex) : Position(pos), Normal(norm), TexCoords(tex) {}
+    Vertex() = default;
+};
+
+// vertices and indices of a mesh, without any GL objects. the offline tools work
+// on these directly, Mesh uploads them
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    bool strip = false; // indices are a triangle strip instead of a triangle list
+};
+
+// CPU side mesh generation and loading, usable without a GL context. the generated
+// shapes are wound counter-clockwise seen from outside, GL's default front face
+namespace Geometry {
+    // a vertex of the fixed shapes below, plain arrays so whole meshes can be constexpr
+    struct UnitVertex {
+        float position[3];
+        float normal[3];
+        float texCoords[2];
+    };
+
+    template <size_t V, size_t I>
+    struct UnitMesh {
+        std::array<UnitVertex, V> vertices;
+        std::array<unsigned int, I> indices;
+    };
+
+    namespace detail {
+        // six faces of four corners each. the corners go round clockwise seen from
+        // outside, so the triangles take them in reverse: counter-clockwise, GL's front
+        constexpr UnitMesh<24, 36> unitCube() {
+            constexpr float corners[8][3] = {
+                { -0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, -0.5f }, { -0.5f, 0.5f, -0.5f },
+                { -0.5f, -0.5f, 0.5f }, { 0.5f, -0.5f, 0.5f }, { 0.5f, 0.5f, 0.5f }, { -0.5f, 0.5f, 0.5f } };
+            constexpr int faces[6][4] = {
+                { 0, 1, 2, 3 }, { 4, 0, 3, 7 }, { 7, 3, 2, 6 }, { 6, 2, 1, 5 }, { 5, 1, 0, 4 }, { 5, 4, 7, 6 } };
+            constexpr float normals[6][3] = {
+                { 0, 0, -1 }, { -1, 0, 0 }, { 0, 1, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 0, 1 } };
+            constexpr float texCoords[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+            constexpr unsigned int quad[6] = { 0, 2, 1, 0, 3, 2 };
+
+            UnitMesh<24, 36> mesh{};
+            for (int f = 0; f < 6; f++) {
+                for (int c = 0; c < 4; c++) {
+                    auto& v = mesh.vertices[f * 4 + c];
+                    for (int k = 0; k < 3; k++) {
+                        v.position[k] = corners[faces[f][c]][k];
+                        v.normal[k] = normals[f][k];
+                    }
+                    v.texCoords[0] = texCoords[c][0];
+                    v.texCoords[1] = texCoords[c][1];
+                }
+                for (int i = 0; i < 6; i++) {
+                    mesh.indices[f * 6 + i] = f * 4 + quad[i];
+                }
+            }
+            return mesh;
+        }
+    }
+
+    // a 1x1x1 cube around the origin, flat shaded
+    constexpr UnitMesh<24, 36> UnitCube = detail::unitCube();
+
+    // a 1x1 square around the origin in the xy plane, one face towards -z and one towards +z
+    constexpr UnitMesh<8, 12> UnitQuad = { {{
+        { { -0.5f, -0.5f, 0.0f }, { 0, 0, -1 }, { 0, 0 } },
+        { { 0.5f, -0.5f, 0.0f }, { 0, 0, -1 }, { 1, 0 } },
+        { { 0.5f, 0.5f, 0.0f }, { 0, 0, -1 }, { 1, 1 } },
+        { { -0.5f, 0.5f, 0.0f }, { 0, 0, -1 }, { 0, 1 } },
+        { { -0.5f, -0.5f, 0.0f }, { 0, 0, 1 }, { 0, 0 } },
+        { { 0.5f, -0.5f, 0.0f }, { 0, 0, 1 }, { 1, 0 } },
+        { { 0.5f, 0.5f, 0.0f }, { 0, 0, 1 }, { 1, 1 } },
+        { { -0.5f, 0.5f, 0.0f }, { 0, 0, 1 }, { 0, 1 } } }},
+        {{ 0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7 }} };
+
+    // a latitude/longitude strip sphere. resolution 0 has 20 layers of 40 quads, 1 has
+    // 36 of 72 and anything higher 90 of 180
+    MeshData Sphere(float radius, int resolution = 3);
+
+    // a subdivided icosahedron, as a triangle list with smooth normals and the texture
+    // coordinates of Sphere(). its triangles are all about the same size, so it needs
+    // far fewer vertices than Sphere() to stay as close to round: 20 * 4^subdivisions
+    // triangles
+    MeshData Icosphere(float radius, int subdivisions);
+
+    MeshData Cuboid(float length, float height, float depth);
+    MeshData Quad(float length, float height);
+
+    // positions, normals and texture coordinates of an assimp mesh
+    MeshData FromAssimp(const aiMesh* mesh);
+
+    // every mesh of a model file, in the order Model loads them and optimized the same
+    // way (MeshOptimizer::Optimize). textures are ignored
+    std::vector<MeshData> LoadModel(const std::string& path);
+
+    // the mesh as a triangle list: strips are unrolled and degenerate triangles dropped
+    std::vector<unsigned int> Triangles(const MeshData& mesh);
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <rendersystem/Geometry.h>
+#include <rendersystem/GLHandle.h>
+#include <rendersystem/RangeAllocator.h>
+
+#include <cstdint>
+#include <vector>
+
+// one large vertex buffer and one large index buffer that meshes sub-allocate their
+// geometry from, with a single VAO for the Vertex layout. a mesh draws its range with
+// glDrawElementsBaseVertex, its indices stay relative to its first vertex, so ranges
+// can be moved around freely. the buffers grow when they're full, and are compacted
+// instead when the free space is there but too scattered. a pool stores its indices in
+// one type, GL_UNSIGNED_INT or GL_UNSIGNED_SHORT for meshes of under 65536 vertices
+class GeometryPool {
+public:
+    // where an allocation lives in the buffers, in vertices and indices
+    struct Range {
+        uint32_t baseVertex = 0;
+        uint32_t vertexCount = 0;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+    };
+
+    struct Stats {
+        unsigned int allocations = 0;
+        uint32_t vertexCapacity = 0;
+        uint32_t vertexUsed = 0;
+        uint32_t vertexFreeBlocks = 0;
+        float vertexFragmentation = 0.0f; // see RangeAllocator::Fragmentation
+        uint32_t indexCapacity = 0;
+        uint32_t indexUsed = 0;
+        uint32_t indexFreeBlocks = 0;
+        float indexFragmentation = 0.0f;
+        unsigned int growths = 0;
+        unsigned int defragmentations = 0;
+    };
+
+    // owns a range of a pool and returns it when destroyed
+    class Allocation {
+    public:
+        Allocation() = default;
+        ~Allocation();
+
+        Allocation(const Allocation&) = delete;
+        Allocation& operator=(const Allocation&) = delete;
+        Allocation(Allocation&& other) noexcept;
+        Allocation& operator=(Allocation&& other) noexcept;
+
+        explicit operator bool() const {
+            return pool != nullptr;
+        }
+
+        // current place in the pool, changes when the pool is defragmented
+        const Range& Get() const {
+            return pool->ranges[id];
+        }
+
+        GeometryPool* Pool() const {
+            return pool;
+        }
+
+        void Reset();
+
+    private:
+        friend class GeometryPool;
+        Allocation(GeometryPool* pool, uint32_t id) : pool(pool), id(id) {}
+
+        GeometryPool* pool = nullptr;
+        uint32_t id = 0;
+    };
+
+    // indexCount indices of an allocation from firstIndex, relative to its own first index
+    struct SubRange {
+        const Allocation* allocation = nullptr;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+    };
+
+    // the pools meshes use, one per index type, created on first use. needs a current
+    // GL context
+    static GeometryPool& Shared(GLenum indexType = GL_UNSIGNED_INT);
+
+    // deletes the shared pools. call it once every mesh is gone and before the context is
+    // destroyed; pools that still hold ranges are reported and left alone. pools that are
+    // never shut down are never deleted, so nothing calls into GL after the context's end
+    static void Shutdown();
+
+    GeometryPool(uint32_t vertexCapacity = 1 << 16, uint32_t indexCapacity = 1 << 18, GLenum indexType = GL_UNSIGNED_INT);
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    // copies the geometry into the buffers. an empty allocation if there are no indices,
+    // or if they don't fit the pool's index type
+    Allocation Allocate(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+
+    // draws a range with mode (GL_TRIANGLES, GL_TRIANGLE_STRIP, ...)
+    void Draw(const Allocation& allocation, GLenum mode) const;
+
+    // draws several ranges of this pool with one glMultiDrawElementsBaseVertex
+    void MultiDraw(const std::vector<const Allocation*>& allocations, GLenum mode);
+
+    // the same for parts of allocations, for meshes drawing only some of their triangles
+    void MultiDraw(const std::vector<SubRange>& ranges, GLenum mode);
+
+    // moves every live range to the front of new buffers, leaving one free block in each
+    void Defragment();
+
+    unsigned int VAO() const {
+        return vao.Get();
+    }
+
+    unsigned int VertexBuffer() const {
+        return vbo.Get();
+    }
+
+    unsigned int IndexBuffer() const {
+        return ebo.Get();
+    }
+
+    GLenum IndexType() const {
+        return indexType;
+    }
+
+    // bytes per index
+    size_t IndexSize() const {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+    // changes whenever the buffers are replaced (growing, defragmenting), so VAOs made
+    // elsewhere over VertexBuffer() and IndexBuffer() know to rebind them
+    unsigned int Generation() const {
+        return growths + defragmentations;
+    }
+
+    Stats GetStats() const;
+
+private:
+    RangeAllocator vertexSpace;
+    RangeAllocator indexSpace;
+
+    std::vector<Range> ranges;     // by allocation id
+    std::vector<bool> live;
+    std::vector<uint32_t> freeIds;
+
+    GLVertexArray vao;
+    GLBuffer vbo, ebo;
+    GLenum indexType;
+    std::vector<uint16_t> narrowed; // Allocate() scratch for 16 bit pools
+
+    // MultiDraw() arguments, kept to avoid reallocating every draw
+    std::vector<GLsizei> drawCounts;
+    std::vector<const void*> drawOffsets;
+    std::vector<GLint> drawBaseVertices;
+
+    unsigned int growths = 0;
+    unsigned int defragmentations = 0;
+
+    void free(uint32_t id);
+
+    // makes sure a vertex and an index range of these sizes can be allocated
+    void reserve(uint32_t vertices, uint32_t indices);
+
+    // moves the contents to new, larger buffers at the same offsets
+    void grow(uint32_t vertexCapacity, uint32_t indexCapacity);
+
+    // points the VAO at the current buffers
+    void setupVertexArray();
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <rendersystem/GLHandle.h>
+
+// measures GPU time between Begin() and End() with GL_TIME_ELAPSED queries. results
+// are read back a few frames late so reading them never stalls the pipeline.
+// only one timer can be running at a time (GL doesn't nest elapsed time queries)
+class GpuTimer {
+public:
+    GpuTimer();
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    void Begin();
+    void End();
+
+    // the most recent finished measurement, or -1 if none has finished yet
+    double Milliseconds();
+
+private:
+    static const int QUERY_COUNT = 4;
+
+    GLQuery queries[QUERY_COUNT];
+    int next = 0;        // query the next Begin() uses
+    int outstanding = 0; // queries ended but not read back yet
+    double last = -1.0;
+
+    // reads back finished queries, waiting for the oldest one if block is set
+    void collect(bool block);
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <rendersystem/GLHandle.h>
+#include <rendersystem/Mesh.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// one mesh drawn many times with a single glDrawElementsInstanced. every instance has
+// its own position, uniform scale, rotation, color (material.ambient of a ControlledMesh)
+// and layer of a diffuse texture array, kept in a per instance vertex buffer. changed
+// instances are only marked dirty; Draw() uploads the dirty ranges. must be drawn with
+// the INSTANCED variant of colors.vert/colors.frag (MaterialFeatures sets it)
+class InstancedMesh : public Drawable {
+public:
+    // per instance attributes as the vertex shader reads them (locations 4 to 6)
+    struct InstanceData {
+        glm::vec4 positionScale = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f); // xyz: position, w: scale
+        glm::vec4 rotation = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);      // quaternion x, y, z, w
+        glm::vec4 colorLayer = glm::vec4(0.0f);                      // rgb: color, a: texture layer
+    };
+
+    struct UploadStats {
+        unsigned int instances = 0;
+        unsigned int ranges = 0;
+        unsigned int bytes = 0;
+    };
+
+    InstancedMesh(std::shared_ptr<const MeshGeometry> geometry);
+    InstancedMesh(MeshData data);
+
+    InstancedMesh(const InstancedMesh&) = delete;
+    InstancedMesh& operator=(const InstancedMesh&) = delete;
+
+    static InstanceData Pack(const glm::vec3& position,
+        float scale = 1.0f,
+        const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+        const glm::vec3& color = glm::vec3(0.0f),
+        int layer = 0);
+
+    // appends an instance and returns its index
+    size_t Add(const InstanceData& instance);
+    void Set(size_t index, const InstanceData& instance);
+    void Resize(size_t count);
+
+    size_t Count() const {
+        return instances.size();
+    }
+
+    const InstanceData& Get(size_t index) const {
+        return instances[index];
+    }
+
+    // for writing many instances in place (e.g. from Parallel::For), followed by MarkDirty
+    InstanceData* Data() {
+        return instances.data();
+    }
+
+    // instances [first, first + count) changed and need uploading
+    void MarkDirty(size_t first, size_t count);
+
+    // the layers of material.texture_diffuse_array, see Utils::TextureArrayFromFiles
+    bool SetTextures(const std::vector<std::string>& paths);
+
+    void Draw(const Shader& shader) override;
+
+    bool IsOpaque() override {
+        return true;
+    }
+
+    glm::vec3 Position() override {
+        return Bounds().center;
+    }
+
+    // bounds of every instance, recomputed after changes
+    BoundingSphere Bounds() override;
+
+    void MaterialFeatures(ShaderFeatures& features) override {
+        features.instanced = true;
+        features.quantized = geometry->encoding == VertexEncoding::Quantized;
+    }
+
+    const UploadStats& LastUpload() const {
+        return lastUpload;
+    }
+
+private:
+    // dirty ranges closer than this are uploaded as one
+    static const size_t MERGE_GAP = 256;
+    static const size_t MAX_DIRTY_RANGES = 64;
+
+    std::shared_ptr<const MeshGeometry> geometry;
+    std::vector<InstanceData> instances;
+    std::vector<std::pair<size_t, size_t>> dirty; // [first, last)
+
+    GLVertexArray VAO;
+    GLBuffer instanceVBO;
+    size_t instanceCapacity = 0;
+    unsigned int poolGeneration = 0;
+
+    GLTexture diffuseArray;
+
+    BoundingSphere bounds;
+    bool boundsDirty = true;
+
+    UploadStats lastUpload;
+
+    // (re)binds the geometry buffers and the instance buffer to the VAO
+    void setupVertexArray();
+
+    // uploads the dirty ranges, reallocating the buffer when it's too small
+    void upload();
+};
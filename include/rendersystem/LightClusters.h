@@ -0,0 +1,125 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rendersystem/GLHandle.h>
+#include <rendersystem/Lights.h>
+#include <rendersystem/LightingSystem.h>
+#include <rendersystem/LightTree.h>
+#include <rendersystem/Shader.h>
+
+#include <cstdint>
+#include <vector>
+
+// clustered (froxel) light assignment for the forward+ variant of colors.frag.
+// the view frustum is split into screen tiles and exponentially spaced depth slices;
+// every point light is culled on the CPU against the clusters its range overlaps, and
+// the result is a compact per-cluster light index list read by the shader through
+// texture buffers. the culling is spread across the Parallel pool by depth slice
+class LightClusters {
+public:
+    // texture units the cluster data is bound to, above the material textures
+    static const int LIGHT_DATA_UNIT = 13;
+    static const int RANGES_UNIT = 14;
+    static const int INDICES_UNIT = 15;
+
+    // timings and sizes of the last Build()
+    struct Stats {
+        unsigned int lights = 0;          // lights with a non zero range
+        unsigned int assignments = 0;     // entries in the index list
+        unsigned int occupiedClusters = 0;
+        unsigned int aggregates = 0;      // entries standing for a LightTree node of several lights
+        double cullMilliseconds = 0.0;
+    };
+
+    LightClusters(int tilesX = 16, int tilesY = 9, int slices = 24);
+
+    LightClusters(const LightClusters&) = delete;
+    LightClusters& operator=(const LightClusters&) = delete;
+
+    // assigns the lights to clusters for a camera and uploads the result.
+    // threshold is the luminance cutoff passed to PointLight::Range
+    void Build(const std::vector<PointLight>& lights,
+        const glm::mat4& view,
+        float fovY, float aspect, float near, float far,
+        float threshold = 1.0f / 256.0f);
+
+    // same, but every cluster gets a cut of the tree (LightTree::Cut) instead of every
+    // light in range, so far away groups of lights become one entry. the tree has to be
+    // Update()d first and stay alive until the clusters are drawn with
+    void Build(const LightTree& tree,
+        const glm::mat4& view,
+        float fovY, float aspect, float near, float far,
+        float threshold = 1.0f / 256.0f);
+
+    // binds the cluster and light buffers and sets the grid uniforms on a clustered shader.
+    // after a tree Build() the tree's node buffer is bound instead of the lighting's lights
+    void Bind(const Shader& shader, const LightingSystem& lighting, int viewportWidth, int viewportHeight) const;
+
+    // per cluster (offset, count) into LightIndices(), x fastest then y then slice
+    const std::vector<glm::uvec2>& ClusterRanges() const {
+        return ranges;
+    }
+
+    const std::vector<uint32_t>& LightIndices() const {
+        return indices;
+    }
+
+    const Stats& LastStats() const {
+        return stats;
+    }
+
+    int ClusterCount() const {
+        return tilesX * tilesY * slices;
+    }
+
+private:
+    int tilesX;
+    int tilesY;
+    int slices;
+
+    // projection the cluster bounds were computed for
+    float fovY = 0.0f;
+    float aspect = 0.0f;
+    float near = 0.0f;
+    float far = 0.0f;
+
+    // view space bounds of every cluster, recomputed when the projection changes
+    std::vector<glm::vec3> clusterMin;
+    std::vector<glm::vec3> clusterMax;
+
+    std::vector<glm::uvec2> ranges;
+    std::vector<uint32_t> indices;
+
+    // per slice scratch, kept between builds to avoid reallocating every frame
+    struct SliceScratch {
+        std::vector<glm::uvec2> pairs;   // (tile, light) before sorting
+        std::vector<uint32_t> counts;    // lights per tile
+        std::vector<uint32_t> indices;   // light indices sorted by tile
+        uint32_t aggregates = 0;
+    };
+    std::vector<SliceScratch> scratch;
+
+    GLBuffer rangesTBO;
+    GLTexture rangesTexture;
+    GLBuffer indicesTBO;
+    GLTexture indicesTexture;
+    size_t indicesCapacity = 0;
+
+    // light data the indices of the last Build() address, 0 for the LightingSystem's
+    unsigned int lightDataTexture = 0;
+
+    Stats stats;
+
+    // recomputes the cluster bounds if the projection changed
+    void setProjection(float fovY, float aspect, float near, float far);
+    void computeClusterBounds();
+
+    // concatenates the slice lists into ranges and indices and fills the shared stats
+    void gatherSlices();
+    void upload();
+
+    // depth of the near plane of a slice (view space distance, positive)
+    float sliceDepth(int slice) const;
+};
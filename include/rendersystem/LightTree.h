@@ -0,0 +1,120 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rendersystem/GLHandle.h>
+#include <rendersystem/Lights.h>
+
+#include <cstdint>
+#include <vector>
+
+// a bounding volume hierarchy over the point lights, for lighting far away groups of
+// lights with one representative light each (lightcuts). every interior node stands for
+// all the lights under it: its representative sits at its brightest light and carries
+// the summed color. Cut() picks, for a region of the scene, the set of nodes whose error
+// bound is within a budget relative to the estimated light there, so a distant cluster
+// of hundreds of lights costs one evaluation in the shader.
+// the tree is refit every Update() and only rebuilt when lights were added or removed
+// or the refit boxes have grown too loose
+class LightTree {
+public:
+    // timings and sizes of the last Update()
+    struct Stats {
+        unsigned int lights = 0;
+        unsigned int nodes = 0;
+        bool rebuilt = false;
+        double updateMilliseconds = 0.0;
+    };
+
+    LightTree();
+
+    LightTree(const LightTree&) = delete;
+    LightTree& operator=(const LightTree&) = delete;
+
+    // refits (or rebuilds) the tree for the current lights and uploads the node data
+    void Update(const std::vector<PointLight>& lights);
+
+    // largest error a node may have, relative to the total light estimated for the
+    // region, before it is split. 0 always refines down to single lights
+    void SetErrorBudget(float budget) {
+        errorBudget = budget;
+    }
+
+    float ErrorBudget() const {
+        return errorBudget;
+    }
+
+    // upper limit on the size of a cut, reached before the budget in very bright regions
+    void SetMaxCut(int count) {
+        maxCut = count;
+    }
+
+    int MaxCut() const {
+        return maxCut;
+    }
+
+    // writes the nodes lighting the world space box [lo, hi] to out and returns how
+    // many, at most MaxCut(). nodes whose bound is below threshold (the PointLight::Range
+    // cutoff) are dropped. the indices address NodeTexture()
+    int Cut(const glm::vec3& lo, const glm::vec3& hi, float threshold, uint32_t* out) const;
+
+    // true for the indices Cut() returns that stand for more than one light
+    bool IsAggregate(uint32_t node) const {
+        return node >= lightCount;
+    }
+
+    // texture buffer in the PointLightData layout: the lights in their original order
+    // (so index i is still light i), then one representative per interior node
+    unsigned int NodeTexture() const {
+        return nodeTexture.Get();
+    }
+
+    size_t NodeCount() const {
+        return nodes.size();
+    }
+
+    const Stats& LastStats() const {
+        return stats;
+    }
+
+private:
+    static const uint32_t NONE = 0xffffffffu;
+
+    // nodes [0, lightCount) are the lights, interior nodes come after their children
+    struct Node {
+        glm::vec3 lo, hi;
+        float intensity = 0.0f;   // summed PointLight::Intensity
+        QuadAttenuation falloff;  // the slowest attenuation below the node, for the bound
+        uint32_t left = NONE, right = NONE;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<PointLightData> data;
+    uint32_t lightCount = 0;
+    uint32_t root = NONE;
+
+    // summed surface area of the interior boxes after the last rebuild
+    float builtArea = 0.0f;
+
+    float errorBudget = 0.02f;
+    int maxCut = 64;
+
+    GLBuffer nodeTBO;
+    GLTexture nodeTexture;
+    size_t nodeCapacity = 0;
+
+    Stats stats;
+
+    // top down median split of the lights sorted along their morton order
+    uint32_t build(std::vector<uint32_t>& order, size_t begin, size_t end);
+
+    // recomputes an interior node from its children, returns its surface area
+    float refitNode(uint32_t node);
+
+    // upper bound of the light the node can deliver anywhere in [lo, hi]
+    float bound(uint32_t node, const glm::vec3& lo, const glm::vec3& hi) const;
+
+    // what the representative delivers at the center of [lo, hi]
+    float estimate(uint32_t node, const glm::vec3& lo, const glm::vec3& hi) const;
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rendersystem/GLHandle.h>
+#include <rendersystem/Lights.h>
+#include <rendersystem/UniformBlocks.h>
+#include <rendersystem/Bounds.h>
+
+#include <vector>
+#include <algorithm>
+
+// owns every light in the scene and mirrors them into the std140 Lights uniform block
+// (see shaders/colors.frag). lights are kept in contiguous arrays; only the range of
+// lights edited since the last Upload() is sent to the GPU.
+// every point light is also mirrored into a texture buffer (five RGBA32F texels per
+// light, in PointLightData order) with no capacity limit, for the clustered path
+class LightingSystem {
+public:
+    // capacities of the arrays in the Lights block, must match MAX_*_LIGHTS in the shaders.
+    // they keep the block within the 16 KB GL_MAX_UNIFORM_BLOCK_SIZE every driver allows;
+    // point lights past MAX_POINT_LIGHTS only reach shaders reading the texture buffer
+    static const int MAX_POINT_LIGHTS = 192;
+    static const int MAX_DIRECTIONAL_LIGHTS = 4;
+
+    // most point lights one draw is shaded with by the PER_OBJECT_LIGHTS variant of
+    // colors.frag, must match MAX_OBJECT_LIGHTS there
+    static const int MAX_OBJECT_LIGHTS = 8;
+
+    // std140 layout of the Lights block
+    struct BlockLayout {
+        glm::ivec4 counts; // x: point lights, y: directional lights
+        DirectionalLightData directionalLights[MAX_DIRECTIONAL_LIGHTS];
+        PointLightData pointLights[MAX_POINT_LIGHTS];
+    };
+    static_assert(sizeof(BlockLayout) <= 16384, "the Lights block must fit the minimum GL_MAX_UNIFORM_BLOCK_SIZE");
+
+    // a light picked by index for editing. the light is looked up on every use, so an
+    // edit stays valid while lights are added (and the arrays reallocate), and each use
+    // marks it dirty for the next Upload()
+    class PointLightEdit {
+    public:
+        PointLight* operator->() const;
+
+    private:
+        friend class LightingSystem;
+        PointLightEdit(LightingSystem* system, int index) : system(system), index(index) {}
+
+        LightingSystem* system;
+        int index;
+    };
+
+    class DirectionalLightEdit {
+    public:
+        DirectionalLight* operator->() const;
+
+    private:
+        friend class LightingSystem;
+        DirectionalLightEdit(LightingSystem* system, int index) : system(system), index(index) {}
+
+        LightingSystem* system;
+        int index;
+    };
+
+    // what the last Upload() sent
+    struct UploadStats {
+        unsigned int lights = 0;
+        unsigned int bytes = 0;
+    };
+
+    LightingSystem();
+
+    LightingSystem(const LightingSystem&) = delete;
+    LightingSystem& operator=(const LightingSystem&) = delete;
+
+    // adds a light and returns its index, which stays valid for the lifetime of the
+    // system. returns -1 if there's no room for another directional light
+    int AddPointLight(const PointLight& light);
+    int AddDirectionalLight(const DirectionalLight& light);
+
+    // edits go through the returned handle, e.g. EditPointLight(i)->SetPosition(p), and
+    // are re-uploaded by the next Upload()
+    PointLightEdit EditPointLight(int index);
+    DirectionalLightEdit EditDirectionalLight(int index);
+
+    const std::vector<PointLight>& PointLights() const {
+        return pointLights;
+    }
+
+    const std::vector<DirectionalLight>& DirectionalLights() const {
+        return directionalLights;
+    }
+
+    // sends the lights edited since the last call to the GPU, as one range per array
+    void Upload();
+
+    // samplerBuffer holding every point light
+    unsigned int PointLightTexture() const {
+        return pointLightTexture.Get();
+    }
+
+    const UploadStats& LastUpload() const {
+        return lastUpload;
+    }
+
+    // per draw light selection since the last Upload()
+    struct SelectionStats {
+        unsigned int draws = 0;
+        unsigned int lightsSelected = 0;   // summed over draws
+        unsigned int lightsConsidered = 0; // point lights in the Lights block, summed over draws
+    };
+
+    // luminance cutoff the light ranges are computed with (see PointLight::Range)
+    void SetCullThreshold(float threshold);
+
+    float CullThreshold() const {
+        return cullThreshold;
+    }
+
+    // writes the indices of the point lights whose range reaches bounds into out, at most
+    // MAX_OBJECT_LIGHTS of them, strongest first, and returns how many. only lights in
+    // the Lights block are considered. ranges are refreshed by Upload(), call it first
+    int SelectPointLights(const BoundingSphere& bounds, int* out) const;
+
+    const SelectionStats& LastSelection() const {
+        return selection;
+    }
+
+private:
+    GLBuffer UBO;
+
+    // texture buffer mirror of every point light, allocated from the start so clustered
+    // shaders bound before the first light is added sample a complete buffer texture
+    GLBuffer pointLightTBO;
+    GLTexture pointLightTexture;
+    size_t pointLightCapacity = 0;
+
+    std::vector<PointLight> pointLights;
+    std::vector<DirectionalLight> directionalLights;
+
+    // [first, last) ranges of lights edited since the last upload
+    struct DirtyRange {
+        int first = 0;
+        int last = 0;
+
+        void Add(int index) {
+            if (first == last) {
+                first = index;
+                last = index + 1;
+            }
+            else {
+                first = std::min(first, index);
+                last = std::max(last, index + 1);
+            }
+        }
+
+        bool Empty() const {
+            return first == last;
+        }
+    };
+
+    DirtyRange dirtyPoint;
+    DirtyRange dirtyDirectional;
+    bool countsDirty = true;
+
+    UploadStats lastUpload;
+
+    // what SelectPointLights() needs of every point light, refreshed by Upload()
+    struct CullInfo {
+        glm::vec3 position;
+        float range;
+        glm::vec3 attenuation; // constant, linear, quadratic
+        float intensity;       // PointLight::Intensity
+    };
+    std::vector<CullInfo> cullInfo;
+    float cullThreshold = 1.0f / 256.0f;
+    bool cullInfoDirty = false;
+
+    mutable SelectionStats selection;
+
+    void updateCullInfo(int first, int last);
+
+    // (re)allocates the texture buffer for capacity lights, bound to GL_TEXTURE_BUFFER
+    void allocatePointLightBuffer(size_t capacity);
+};
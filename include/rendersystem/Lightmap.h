@@ -0,0 +1,36 @@
+#pragma once
+
+#include <rendersystem/Geometry.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// baked lighting of one mesh. lightmap charts can't share vertices across their
+// borders, so the lightmap carries its own re-indexed copy of the mesh: every lightmap
+// vertex is a source vertex plus a lightmap uv. the texels hold the light reaching the
+// surface, the runtime multiplies them by the diffuse color
+struct Lightmap {
+    int width = 0;
+    int height = 0;
+
+    std::vector<uint32_t> remap;   // source vertex of every lightmap vertex
+    std::vector<glm::vec2> uvs;    // lightmap uv of every lightmap vertex
+    std::vector<uint32_t> indices; // triangle list over the lightmap vertices
+    std::vector<glm::vec3> texels; // linear rgb, width * height, row 0 at v = 0
+
+    // packs the mesh into non overlapping charts of coplanar-ish triangles projected at
+    // texelsPerUnit (world units, after transform). the density is lowered until the
+    // lightmap fits in maxSize. texels is left empty for the baker to fill
+    static Lightmap Unwrap(const MeshData& mesh, const glm::mat4& transform,
+        float texelsPerUnit, int padding = 2, int maxSize = 2048);
+
+    // binary format read back by Load (the runtime) and written by rs_lightbake
+    bool Save(const std::string& path) const;
+    static bool Load(const std::string& path, Lightmap& out);
+
+    // the texels as a radiance .hdr image, for inspecting a bake
+    bool SaveHDR(const std::string& path) const;
+};
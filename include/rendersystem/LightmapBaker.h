@@ -0,0 +1,109 @@
+#pragma once
+
+#include <rendersystem/Geometry.h>
+#include <rendersystem/Lightmap.h>
+#include <rendersystem/Lights.h>
+#include <rendersystem/ProbeGrid.h>
+#include <rendersystem/TriangleBVH.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// offline lightmap baking on the CPU. static meshes are unwrapped (Lightmap::Unwrap),
+// every covered texel is path traced against a TriangleBVH of the whole scene and the
+// texels are spread over the Parallel pool. the lightmap holds what the colors.frag
+// lights would add before the diffuse color is applied: directional ambient, direct
+// diffuse light with hard shadows, and diffuse interreflection between the meshes.
+// specular and the point light ambient term (which scales material.ambient) aren't baked.
+// the same scene also bakes the irradiance probes dynamic objects are lit with
+class LightmapBaker {
+public:
+    struct Settings {
+        float texelsPerUnit = 8.0f;
+        int samples = 64;     // indirect paths per texel
+        int bounces = 2;      // indirect bounces per path, 0 bakes direct light only
+        int padding = 2;      // texels around each chart, filled by dilation
+        int maxSize = 2048;
+        float bias = 1e-3f;   // ray offset off the surface, world units
+        int probeSamples = 512; // rays per probe
+    };
+
+    struct Stats {
+        unsigned int triangles = 0;
+        unsigned int texels = 0;  // texels covered by a triangle
+        unsigned int probes = 0;
+        uint64_t rays = 0;
+        double buildMilliseconds = 0.0;
+        double traceMilliseconds = 0.0;
+    };
+
+    // adds a static mesh placed with transform. returns its index in Bake()'s result
+    int AddMesh(const MeshData& mesh, const glm::mat4& transform, const glm::vec3& albedo = glm::vec3(0.6f));
+
+    void AddPointLight(const PointLight& light);
+    void AddDirectionalLight(const DirectionalLight& light);
+
+    // unwraps every mesh, builds the BVH and traces one lightmap per mesh on all cores
+    std::vector<Lightmap> Bake(const Settings& settings);
+
+    // projects the light reflected off the scene onto counts probes spread over [lo, hi].
+    // only indirect light is stored: the lights themselves are evaluated at runtime.
+    // probes stuck inside geometry take the average of their neighbours
+    ProbeGrid BakeProbes(const glm::vec3& lo, const glm::vec3& hi, const glm::ivec3& counts, const Settings& settings);
+
+    const Stats& LastStats() const {
+        return stats;
+    }
+
+private:
+    struct Instance {
+        MeshData mesh;
+        glm::mat4 transform;
+        glm::vec3 albedo;
+    };
+
+    // a scene triangle in world space, indexed like the BVH's triangles
+    struct SceneTriangle {
+        glm::vec3 normals[3];
+        glm::vec3 faceNormal;
+        uint32_t instance;
+    };
+
+    // xorshift64*, seeded per texel or probe so a bake doesn't depend on how the pool splits it
+    struct Random {
+        uint64_t state;
+
+        explicit Random(uint64_t seed) : state(seed * 0x9e3779b97f4a7c15ull + 1) {}
+
+        float Next() {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return (float)((state * 0x2545f4914f6cdd1dull) >> 40) / (float)(1 << 24);
+        }
+    };
+
+    std::vector<Instance> instances;
+    std::vector<PointLightData> pointLights;
+    std::vector<DirectionalLightData> directionalLights;
+
+    TriangleBVH bvh;
+    std::vector<SceneTriangle> sceneTriangles;
+    std::vector<std::vector<glm::vec3>> worldPositions; // per instance vertex
+    std::vector<std::vector<glm::vec3>> worldNormals;
+
+    Stats stats;
+
+    // direct diffuse light reaching p (facing n) from every light, shadowed
+    glm::vec3 directLight(const glm::vec3& p, const glm::vec3& n, float bias, uint64_t& rays) const;
+
+    // transforms the instances to world space and builds the BVH over them
+    void buildScene();
+
+    // light coming back along dir from the first surface hit, following up to bounces
+    // diffuse reflections. backfaceHit is set when the ray hit the inside of a mesh
+    glm::vec3 traceRadiance(glm::vec3 origin, glm::vec3 dir, int bounces, float bias,
+        Random& random, uint64_t& rays, bool* backfaceHit = nullptr) const;
+};
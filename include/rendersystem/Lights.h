@@ -17,13 +17,24 @@ struct QuadAttenuation {
 		quadratic(q) {}
 };
 
-class Light {
-	virtual void SetShader(const Shader& s, int pos) const = 0;
+// std140 layout of one entry of the pointLights array in the Lights block
+struct PointLightData {
+	glm::vec4 position;    // xyz: world position
+	glm::vec4 attenuation; // x: constant, y: linear, z: quadratic
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
 };
 
-class PointLight : Light {
-	const std::string struct_name = "pointLights";
+// std140 layout of one entry of the directionalLights array in the Lights block
+struct DirectionalLightData {
+	glm::vec4 direction;
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
+};
 
+class PointLight {
 	glm::vec3 Position;
 	QuadAttenuation Attenuation;
 	glm::vec3 Ambient;
@@ -45,12 +56,26 @@ public:
 
 	void SetPosition(glm::vec3 pos);
 
-	void SetShader(const Shader& shader, int index) const override;
-};
+	glm::vec3 GetPosition() const {
+		return Position;
+	}
+
+	const QuadAttenuation& GetAttenuation() const {
+		return Attenuation;
+	}
+
+	// the brightest ambient, diffuse or specular channel, all three are attenuated
+	float Intensity() const;
 
-class DirectionalLight : Light {
-	const std::string struct_name = "directionalLights";
+	// distance past which the attenuated light is dimmer than threshold (in units of
+	// Intensity()), i.e. where it can be culled
+	float Range(float threshold = 1.0f / 256.0f) const;
 
+	// the light in the layout the shaders read it in
+	PointLightData Pack() const;
+};
+
+class DirectionalLight {
 	glm::vec3 Direction;
 	glm::vec3 Ambient;
 	glm::vec3 Diffuse;
@@ -68,5 +93,10 @@ public:
 
 	void SetDirection(glm::vec3 dir);
 
-	void SetShader(const Shader& shader, int index) const override;
-};
\ No newline at end of file
+	glm::vec3 GetDirection() const {
+		return Direction;
+	}
+
+	// the light in the layout the shaders read it in
+	DirectionalLightData Pack() const;
+};
@@ -4,36 +4,158 @@
 #include <iostream>
 #include <vector>
 #include <rendersystem/Shader.h>
+#include <rendersystem/ShaderVariants.h>
+#include <rendersystem/Bounds.h>
+#include <rendersystem/Geometry.h>
+#include <rendersystem/GeometryPool.h>
+#include <rendersystem/GLHandle.h>
+#include <rendersystem/Lightmap.h>
+#include <rendersystem/Meshlets.h>
+#include <rendersystem/QuantizedVertex.h>
 #include <functional>
+#include <memory>
 
 
-struct Vertex {
-    glm::vec3 Position;
-    glm::vec3 Normal;
-    glm::vec2 TexCoords;
-
-    Vertex(glm::vec3 pos, glm::vec3 norm, glm::vec2 tex) : Position(pos), Normal(norm), TexCoords(tex) {}
-    Vertex() = default;
-};
-
 struct Texture {
     unsigned int id;
     std::string type;
     std::string path;
+    bool alpha = false;
+};
+
+// what choosing a level of detail needs to know about the view. errors and sizes are
+// projected as seen at the closest point of a drawable's bounds
+struct DetailView {
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float projectionScale = 1.0f;  // pixels one unit covers at distance 1
+    float maxPixelError = 1.0f;    // coarser levels are drawn while their error stays below this
+    float minPixelSize = 2.0f;     // drawables whose bounds project smaller are culled
+    float hysteresis = 0.25f;      // coarsen only below (1 - hysteresis) * maxPixelError, so levels don't flicker
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    bool cullMeshlets = false;     // against the frustum of viewProjection and by their cones
+
+    DetailView() = default;
+    // fovY in radians, viewportHeight in pixels
+    DetailView(const glm::vec3& cameraPosition, float fovY, float viewportHeight);
+    // also culls meshlets, see Mesh::GenerateMeshlets
+    DetailView(const glm::vec3& cameraPosition, float fovY, float viewportHeight, const glm::mat4& viewProjection);
+
+    // pixels one unit covers at the point of bounds closest to the camera. the largest
+    // float from inside (or for unbounded drawables), which keeps them at full detail
+    float PixelsPerUnit(const BoundingSphere& bounds) const;
+};
+
+// triangles Mesh, Model and InstancedMesh submitted since Mesh::ResetFrameStats(), shadow
+// passes left out (see Mesh::UncountedDraws)
+struct MeshFrameStats {
+    size_t triangles = 0;
+    size_t fullDetailTriangles = 0; // what drawing every level 0 would have cost, culled ones included
+    unsigned int culled = 0;        // SelectDetail() calls that returned false
+    Meshlets::Stats meshlets;       // meshlet culling in those calls
 };
 
 class Drawable {
 public:
+    virtual ~Drawable() = default;
+
     virtual void Draw(const Shader& shader) = 0;
     virtual bool IsOpaque() = 0;
     virtual glm::vec3 Position() = 0;
+
+    // world space bounds, used to cull lights per draw. unbounded unless overridden
+    virtual BoundingSphere Bounds() {
+        return BoundingSphere();
+    }
+
+    // the model matrix Draw() uses
+    virtual glm::mat4 Transform() {
+        return glm::mat4(1.0f);
+    }
+
+    // adds the material features this drawable needs to the shader variant it's drawn with
+    virtual void MaterialFeatures(ShaderFeatures& /*features*/) {}
+
+    // picks the level of detail the next Draw() uses. false if the drawable is too small
+    // on screen to draw at all
+    virtual bool SelectDetail(const DetailView& /*view*/) {
+        return true;
+    }
+
+    // draws what the last SelectDetail() found visible from its view. the passes of that
+    // view use this, other views (shadow maps) draw everything with Draw()
+    virtual void DrawVisible(const Shader& shader) {
+        Draw(shader);
+    }
+};
+
+// the immutable part of a mesh: the vertices and indices, their bounds and where they
+// were uploaded. every copy of a Mesh points at the same one. geometry in the Vertex
+// layout is a range of a shared GeometryPool, lightmapped geometry has an extra
+// attribute and quantized geometry a layout of its own, both keep their own buffers.
+// the CPU copy of the vertices is always in full floats
+struct MeshGeometry {
+    MeshGeometry(std::vector<Vertex> vertices,
+        std::vector<unsigned int> indices,
+        unsigned int drawMode = GL_TRIANGLES,
+        std::vector<glm::vec2> lightmapUVs = {},
+        VertexEncoding encoding = VertexEncoding::Float);
+
+    MeshGeometry(const MeshGeometry&) = delete;
+    MeshGeometry& operator=(const MeshGeometry&) = delete;
+
+    std::vector<Vertex>       vertices;
+    std::vector<unsigned int> indices;
+    unsigned int drawMode;
+
+    // per vertex lightmap coordinates, empty without a lightmap
+    std::vector<glm::vec2>    lightmapUVs;
+
+    // bounds of the vertices in model space
+    BoundingSphere localBounds;
+
+    VertexEncoding encoding;
+
+    // GL_UNSIGNED_SHORT on the GPU for meshes of under 65536 vertices, GL_UNSIGNED_INT
+    // otherwise. the CPU copy is always 32 bit
+    unsigned int indexType;
+
+    // quantized positions decode as positionOrigin + positionExtent * unorm, identity
+    // for float geometry
+    glm::vec3 positionOrigin = glm::vec3(0.0f);
+    glm::vec3 positionExtent = glm::vec3(1.0f);
+    QuantizationReport quantization;
+
+    GeometryPool::Allocation allocation;
+
+    // only with lightmap uvs or quantized vertices
+    GLVertexArray VAO;
+    GLBuffer VBO, EBO;
+    GLBuffer lightmapVBO;
+
+    // triangles one draw of the indices makes
+    size_t Triangles() const {
+        return drawMode == GL_TRIANGLE_STRIP ? (indices.size() < 3 ? 0 : indices.size() - 2) : indices.size() / 3;
+    }
+
+    // sets the position decode uniforms of shaders that read quantized positions
+    // (positionOrigin, positionExtent). every draw sets them, shaders keep them otherwise
+    void BindDecode(const Shader& shader) const;
+
+    // points attributes 0 to 2 at the bound GL_ARRAY_BUFFER, laid out as encoding says
+    static void SetupAttributes(VertexEncoding encoding);
 };
 
+// a MeshGeometry with a set of textures. copies share the geometry (and the textures the
+// mesh created itself), only the texture list and, for ControlledMesh, the transform and
+// color are per copy, so drawing one primitive many times costs one set of buffers.
+// the data is moved in, pass temporaries or std::move to avoid a copy
 class Mesh : public Drawable {
 public:
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures,
+        VertexEncoding encoding = VertexEncoding::Float);
     Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices);
-    Mesh(const Mesh& other);
+    Mesh(MeshData data, VertexEncoding encoding = VertexEncoding::Float);
+    Mesh(std::shared_ptr<const MeshGeometry> geometry, std::vector<Texture> textures = {});
 
     void Draw(const Shader& shader) override;
     bool IsOpaque() {
@@ -44,34 +166,137 @@ public:
         return glm::vec3(0, 0, 0);
     }
 
-protected:
-    bool textures_dirty = true;
+    BoundingSphere Bounds() override {
+        return geometry->localBounds;
+    }
 
-    // mesh data
-    std::vector<Vertex>       vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture>      textures;
-    unsigned int DrawMode = GL_TRIANGLES;
+    // bounds of the vertices in model space
+    const BoundingSphere& LocalBounds() const {
+        return geometry->localBounds;
+    }
 
-    //  render data
-    unsigned int VAO, VBO, EBO;
-    bool opaque_ = true;
+    const std::shared_ptr<const MeshGeometry>& SharedGeometry() const {
+        return geometry;
+    }
+
+    const std::vector<Texture>& Textures() const {
+        return textures;
+    }
+
+    // binds the textures to units 0.. and points the material samplers at them
+    void BindTextures(const Shader& shader) const;
+
+    void MaterialFeatures(ShaderFeatures& features) override;
+
+    // simplifies the geometry into coarser levels (MeshOptimizer::BuildLods) in the same
+    // encoding. copies made afterwards share them
+    void GenerateLods(size_t minTriangles = 64, int maxLevels = 6);
+
+    // levels of detail, 1 without GenerateLods()
+    size_t LodCount() const {
+        return lods.empty() ? 1 : lods.size();
+    }
+
+    size_t LodLevel() const {
+        return lod;
+    }
+
+    // what Draw() draws: the level SelectDetail() last picked
+    const MeshGeometry& DrawnGeometry() const {
+        return lods.empty() ? *geometry : *lods[lod].geometry;
+    }
+
+    bool SelectDetail(const DetailView& view) override;
+
+    // picks the level for a mesh where one model space unit covers pixelsPerUnit pixels:
+    // the coarsest whose projected error is under view.maxPixelError. finer levels are
+    // taken at once, coarser ones only once they're below the hysteresis margin
+    void SelectLod(float pixelsPerUnit, const DetailView& view);
+
+    // cuts the geometry into Meshlets, culled by SelectDetail() with views that ask for it
+    // and left out by DrawVisible(). the geometry is replaced by a copy with its triangles
+    // in meshlet order, call it before GenerateLods(). copies made afterwards share both
+    void GenerateMeshlets();
+
+    // culls the meshlets for the view, with transform the model matrix. false if none
+    // are left. only level 0 has meshlets, other levels stay whole
+    bool CullMeshlets(const DetailView& view, const glm::mat4& transform);
+
+    // the index ranges of DrawnGeometry() DrawVisible() draws, nullptr for all of it
+    const std::vector<Meshlets::Range>* VisibleRanges() const {
+        return meshletsCulled && lod == 0 ? &visible : nullptr;
+    }
 
-    // sets vao vbo ebo from vertices and indices
-    void setupMesh();
+    void DrawVisible(const Shader& shader) override;
+
+    static const MeshFrameStats& FrameStats();
+    static void ResetFrameStats();
+    // for drawables that draw mesh geometry themselves
+    static void CountTriangles(size_t drawn, size_t fullDetail);
+    static void CountCulled(size_t fullDetail);
+
+    // draws made while one of these lives aren't counted, FrameStats() is the main view's.
+    // for passes that draw the scene again from elsewhere (shadow maps)
+    class UncountedDraws {
+    public:
+        UncountedDraws();
+        ~UncountedDraws();
+
+        UncountedDraws(const UncountedDraws&) = delete;
+        UncountedDraws& operator=(const UncountedDraws&) = delete;
+
+    private:
+        bool counting;
+    };
+
+    // switches the mesh to baked lighting: the geometry is replaced by the lightmap's
+    // re-indexed copy (with the lightmap uvs as attribute 3) and the texels become the
+    // texture_lightmap texture. the lightmap must have been baked from this mesh.
+    // other copies keep the unbaked geometry. levels of detail are dropped, the
+    // lightmap only covers the full mesh
+    bool SetLightmap(const Lightmap& lightmap);
+
+    // loads a lightmap written by rs_lightbake and applies it
+    bool LoadLightmap(const std::string& path);
+
+protected:
+    // a level of detail and its error in model units
+    struct Lod {
+        std::shared_ptr<const MeshGeometry> geometry;
+        float error = 0.0f;
+    };
+
+    std::shared_ptr<const MeshGeometry> geometry;
+    std::vector<Lod> lods;  // empty, or geometry and coarser levels, errors increasing
+    size_t lod = 0;
+    std::shared_ptr<const Meshlets> meshlets; // of geometry
+    std::vector<Meshlets::Range> visible;
+    bool meshletsCulled = false;              // visible is CullMeshlets()' result
+    std::vector<Texture> textures;
+    std::vector<std::shared_ptr<GLTexture>> ownedTextures; // the ones in textures the mesh created
+    bool opaque_ = true;
 };
 
 // a mesh that can be positioned, rotated and scaled
 class ControlledMesh : public Mesh {
 public:
-    ControlledMesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, bool opaque=true) : Mesh(vertices, indices) {
+    ControlledMesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, bool opaque=true) : Mesh(std::move(vertices), std::move(indices)) {
+        opaque_ = opaque;
+    }
+    ControlledMesh(MeshData data, bool opaque=true) : Mesh(std::move(data)) {
+        opaque_ = opaque;
+    }
+    ControlledMesh(std::shared_ptr<const MeshGeometry> geometry, bool opaque=true) : Mesh(std::move(geometry)) {
         opaque_ = opaque;
     }
-    ControlledMesh(const ControlledMesh& other);
     
     void Draw(const Shader& shader) override;
+    void DrawVisible(const Shader& shader) override;
 
+    // the Create functions share their geometry with every other mesh of the same shape
+    // and size (Primitives)
     static ControlledMesh CreateSphere(float radius, int resolution=3, bool opaque=true);
+    static ControlledMesh CreateIcosphere(float radius, int resolution=3, bool opaque=true);
     static ControlledMesh CreateCuboid(float length, float height, float depth, bool opaque=true);
     static ControlledMesh CreateCube(float size, bool opaque=true);
     static ControlledMesh CreateQuad(float length, float height, bool opaque=true);
@@ -92,7 +317,20 @@ public:
         return position;
     }
 
+    BoundingSphere Bounds() override {
+        return geometry->localBounds.Transformed(modelMatrix());
+    }
+
+    glm::mat4 Transform() override {
+        return modelMatrix();
+    }
+
 private:
+    glm::mat4 modelMatrix() const;
+
+    // the model matrix and color uniforms
+    void bindTransform(const Shader& shader) const;
+
     // transformation data
     glm::vec3 axis = glm::vec3(0, 1, 0);
     float angle = 0;
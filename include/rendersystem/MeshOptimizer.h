@@ -0,0 +1,91 @@
+#pragma once
+
+#include <rendersystem/Geometry.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// load/bake time reordering of triangle list meshes for the GPU: duplicate vertices are
+// welded, triangles ordered for the post-transform vertex cache (Tipsify) and then, in
+// clusters, outside in to cut overdraw, and vertices renumbered in order of first use
+// so fetches walk the vertex buffer forwards. apart from triangles that welding makes
+// degenerate nothing is lost, only reordered and deduplicated. usable without a GL
+// context. meshes of under 65536 vertices afterwards get 16 bit indices on the GPU,
+// see MeshGeometry::indexType. also builds the level of detail chains Mesh draws
+namespace MeshOptimizer {
+    // post-transform cache the ordering targets and ACMR is measured with
+    const unsigned int CACHE_SIZE = 16;
+
+    // before and after counts, summed over the meshes of a model with Merge
+    struct Stats {
+        size_t meshes = 0;
+        size_t trianglesBefore = 0;
+        size_t trianglesAfter = 0;    // less the ones welding made degenerate
+        size_t verticesBefore = 0;
+        size_t verticesAfter = 0;
+        size_t cacheMissesBefore = 0; // FIFO of CACHE_SIZE
+        size_t cacheMissesAfter = 0;
+        size_t shadedBefore = 0;      // fragments passing the depth test, see Overdraw
+        size_t shadedAfter = 0;
+        size_t covered = 0;           // pixels covered, the same before and after
+        double milliseconds = 0.0;    // optimizing only, without the measurements
+
+        // average cache miss ratio: vertex shader runs per triangle
+        float ACMRBefore() const;
+        float ACMRAfter() const;
+        // fragments shaded per pixel covered
+        float OverdrawBefore() const;
+        float OverdrawAfter() const;
+
+        void Merge(const Stats& other);
+        void Print(const std::string& name) const;
+    };
+
+    // runs every step below on a triangle list mesh, strips are left alone. with stats
+    // the mesh is measured before and after (which costs more than optimizing)
+    void Optimize(MeshData& mesh, Stats* stats = nullptr);
+
+    // merges bitwise identical vertices and drops triangles that become degenerate
+    void WeldVertices(MeshData& mesh);
+
+    // Tipsify (Sander et al. 2007): fans around vertices still in the cache, returns
+    // the triangle offsets where the walk had to jump, which bound the clusters
+    // OptimizeOverdraw sorts
+    std::vector<uint32_t> OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+    // sorts clusters of triangles (at least minCluster, cut at the given boundaries)
+    // so the ones facing out from the mesh's center come first and occlude the rest
+    void OptimizeOverdraw(MeshData& mesh, const std::vector<uint32_t>& boundaries, size_t minCluster = 64);
+
+    // renumbers the vertices in the order the indices first use them, unused ones go
+    void OptimizeVertexFetch(MeshData& mesh);
+
+    // quadric error metric simplification (Garland and Heckbert) by half edge collapses:
+    // vertices are only ever moved onto a neighbour, so the result indexes the mesh's own
+    // vertices. vertices on open borders and attribute seams (a position shared by
+    // differing vertices) stay put, which can stop short of targetTriangles. error gets
+    // the largest RMS distance of a collapsed vertex to its planes, in model units
+    std::vector<unsigned int> Simplify(const MeshData& mesh, size_t targetTriangles, float* error = nullptr);
+
+    // one level of detail: a simplified, optimized and compacted copy of a mesh and its
+    // error in model units
+    struct Lod {
+        MeshData mesh;
+        float error = 0.0f;
+    };
+
+    // the full mesh (error 0) and successively halved simplifications of it, until
+    // minTriangles, maxLevels or simplification stops making progress. strips are
+    // unrolled into triangle lists first
+    std::vector<Lod> BuildLods(const MeshData& mesh, size_t minTriangles = 64, int maxLevels = 6);
+
+    // vertex shader invocations of a FIFO post-transform cache of cacheSize
+    size_t CacheMisses(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE);
+
+    // software rasterizes the mesh orthographically from the six axis directions, back
+    // faces culled, and counts fragments passing the depth test in submission order
+    // (shaded) and pixels finally covered
+    void Overdraw(const MeshData& mesh, size_t& shaded, size_t& covered, int resolution = 256);
+}
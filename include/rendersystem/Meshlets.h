@@ -0,0 +1,85 @@
+#pragma once
+
+#include <rendersystem/Geometry.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// a triangle list mesh cut into meshlets of at most MAX_VERTICES distinct vertices and
+// MAX_TRIANGLES triangles. Build() reorders the mesh's triangles so every meshlet is a
+// range of the index buffer; the vertices stay where they are. each meshlet has a
+// bounding sphere and a cone around its triangles' normals, and Cull() rejects the ones
+// facing away from the camera or outside the frustum and returns the index ranges left,
+// neighbours merged, for one multi-draw. the bounds are stored as a structure of arrays
+// and tested four meshlets at a time with SSE where the compiler targets it. no GL
+// context needed
+class Meshlets {
+public:
+    static const uint32_t MAX_VERTICES = 64;
+    static const uint32_t MAX_TRIANGLES = 124;
+
+    // indices [firstIndex, firstIndex + indexCount) of the mesh
+    struct Range {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+    };
+
+    // meshlets and triangles Cull() saw and rejected, summed over calls
+    struct Stats {
+        size_t meshlets = 0;
+        size_t triangles = 0;
+        size_t backfacing = 0;        // meshlets whose cone faces away
+        size_t outside = 0;           // meshlets outside the frustum (backfacing or not)
+        size_t trianglesRejected = 0;
+
+        // share of the triangles that were never submitted
+        float RejectionRate() const;
+
+        void Merge(const Stats& other);
+        void Print(const std::string& name) const;
+    };
+
+    Meshlets() = default;
+
+    // grows meshlets from the first triangle not in one yet, adding the neighbour that
+    // brings the fewest new vertices and bends the normal cone least, and reorders the
+    // mesh's triangles to match. strips get no meshlets and are left alone
+    static Meshlets Build(MeshData& mesh, uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+
+    size_t Count() const {
+        return ranges.size();
+    }
+
+    bool Empty() const {
+        return ranges.empty();
+    }
+
+    // index range of meshlet i
+    const Range& Get(size_t i) const {
+        return ranges[i];
+    }
+
+    // the frustum planes of a (model) view projection matrix, normalized, inside where
+    // dot(plane, vec4(p, 1)) >= 0. from a model view projection they're in model space
+    static std::array<glm::vec4, 6> FrustumPlanes(const glm::mat4& viewProjection);
+
+    // fills visible with the ranges of the meshlets that may show from cameraPosition
+    // within the frustum, both in the meshes' space. false if none do
+    bool Cull(const glm::vec3& cameraPosition, const std::array<glm::vec4, 6>& frustum,
+        std::vector<Range>& visible, Stats* stats = nullptr) const;
+
+private:
+    std::vector<Range> ranges;
+
+    // per meshlet, padded to a multiple of 4 with meshlets that are never rejected
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::vector<float> axisX, axisY, axisZ, cutoff;
+
+    // the sphere and cone of a meshlet
+    void addBounds(const MeshData& mesh, const Range& range);
+};
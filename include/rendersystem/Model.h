@@ -10,18 +10,26 @@
 
 #include <rendersystem/Shader.h>
 #include <rendersystem/Mesh.h>
+#include <rendersystem/MeshOptimizer.h>
 
 class Model : public Drawable
 {
 public:
-    Model(std::string path)
+    // with VertexEncoding::Quantized every mesh is uploaded as QuantizedVertex, see
+    // ShaderFeatures::quantized. the savings and errors are printed after loading
+    Model(std::string path, VertexEncoding encoding = VertexEncoding::Float) : encoding(encoding)
     {
         loadModel(path);
     }
     void Draw(const Shader& shader) override;
+    void DrawVisible(const Shader& shader) override;
 
     void Rotate(float angle);
 
+    // loads the lightmaps rs_lightbake wrote for every mesh (prefix_<mesh>.lightmap).
+    // returns false if any mesh has none
+    bool LoadLightmaps(const std::string& prefix);
+
     bool IsOpaque() {
         return opaque_;
     }
@@ -30,11 +38,44 @@ public:
         return position;
     }
 
+    BoundingSphere Bounds() override {
+        return localBounds.Transformed(modelMatrix());
+    }
+
+    glm::mat4 Transform() override {
+        return modelMatrix();
+    }
+
+    void MaterialFeatures(ShaderFeatures& features) override;
+
+    // every mesh gets meshlets when loaded, and levels of detail on the first call, so
+    // the ones LoadLightmaps() would drop are never built. levels are picked for the whole
+    // model from its bounds, each mesh by its own errors
+    bool SelectDetail(const DetailView& view) override;
+
+    // draw calls one Draw() issues, meshes sharing textures go out in one call (one per
+    // pool their current levels of detail are in)
+    size_t DrawCalls() const {
+        return batches.size();
+    }
+
 private:
+    // meshes drawn together with GeometryPool::MultiDraw: same textures, same draw mode
+    // and geometry in a pool. a batch of one is drawn with Mesh::Draw
+    struct Batch {
+        std::vector<size_t> meshes;
+    };
+
     // model data
     std::vector<Mesh> meshes;
     std::string directory;
     std::vector<Texture> textures_loaded;
+    std::vector<GLTexture> ownedTextures; // textures_loaded, deleted with the model
+    std::vector<Batch> batches;
+    // draw() scratch: the batch's index ranges, then the ones in one pool
+    std::vector<GeometryPool::SubRange> pending, samePool;
+    VertexEncoding encoding;
+    MeshOptimizer::Stats optimization; // of every mesh with $RS_MESH_STATS set, see MeshOptimizer::Optimize
 
     glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
     glm::vec3 axis = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -42,8 +83,18 @@ private:
     float scale = 1.0f;
 
     bool opaque_ = true;
+    bool lodsGenerated = false;
+
+    // union of the mesh bounds, in model space
+    BoundingSphere localBounds;
+
+    glm::mat4 modelMatrix() const;
 
+    // with visibleOnly only the meshlets SelectDetail() left
+    void draw(const Shader& shader, bool visibleOnly);
     void loadModel(std::string path);
+    void generateLods();
+    void buildBatches();
     void processNode(aiNode* node, const aiScene* scene);
     Mesh processMesh(aiMesh* mesh, const aiScene* scene);
     std::vector<Texture> loadMaterialTextures(
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <functional>
+
+// a persistent pool of worker threads for data-parallel loops (light culling, baking).
+// the pool is created on first use with one thread per hardware thread
+namespace Parallel {
+    // number of threads that run a For(), including the calling thread
+    unsigned int ThreadCount();
+
+    // runs fn(i) for every i in [begin, end) across the pool and returns once all of
+    // them are done. indices are handed out in chunks of `grain`. calls made from
+    // inside fn run serially on the calling thread
+    void For(int begin, int end, const std::function<void(int)>& fn, int grain = 1);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <rendersystem/GLHandle.h>
+#include <rendersystem/Camera.h>
+#include <rendersystem/LightingSystem.h>
+#include <rendersystem/Mesh.h>
+#include <rendersystem/Shader.h>
+#include <rendersystem/ShadowAtlas.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// omnidirectional shadows for the point lights covering the most of the screen, read by
+// the POINT_SHADOWS variant of colors.frag.
+// every shadowed light gets one square tile of a ShadowAtlas, sized from its screen
+// coverage, at the same place in each of the six layers of a depth array (one layer per
+// cube face). all six faces are drawn in one layered pass (point_shadow.geom), and a
+// face is only redrawn when its light or a caster inside its frustum moved
+class PointShadows {
+public:
+    // size of the uniform arrays in colors.frag
+    static const int MAX_SHADOWED_LIGHTS = 4;
+
+    // texture unit the atlas is bound to, below CascadedShadows
+    static const int SHADOW_UNIT = 11;
+
+    struct Stats {
+        unsigned int lights = 0;        // lights with a shadow this frame
+        unsigned int facesRendered = 0;
+        unsigned int facesSkipped = 0;  // faces whose cached depth was still valid
+        unsigned int reallocated = 0;   // lights that got a new tile (every face redrawn)
+    };
+
+    // shaderDir is the folder holding the point_shadow shaders. tiles are between minTile
+    // and maxTile texels wide
+    PointShadows(const std::string& shaderDir, int atlasSize = 4096, int minTile = 128, int maxTile = 1024);
+
+    PointShadows(const PointShadows&) = delete;
+    PointShadows& operator=(const PointShadows&) = delete;
+
+    void AddCaster(std::shared_ptr<Drawable> caster);
+
+    // picks the lights to shadow, sizes their tiles and redraws the faces that changed.
+    // leaves framebuffer 0 bound and restores the viewport
+    void Update(const LightingSystem& lighting, Camera& camera, int viewportHeight);
+
+    // binds the atlas and sets the shadowed light uniforms on a POINT_SHADOWS shader
+    void Bind(const Shader& shader) const;
+
+    const Stats& LastStats() const {
+        return stats;
+    }
+
+private:
+    ShadowAtlas atlas;
+    int minTile;
+    int maxTile;
+
+    GLTexture depthArray;
+    GLFramebuffer FBO;
+
+    Shader depthShader;
+
+    struct Slot {
+        int light = -1;           // index in LightingSystem::PointLights(), -1 if unused
+        ShadowAtlas::Tile tile;
+        glm::vec3 position = glm::vec3(0.0f);
+        float range = 0.0f;
+        unsigned int dirtyFaces = 0; // bit per cube face
+    };
+    Slot slots[MAX_SHADOWED_LIGHTS];
+
+    struct Caster {
+        std::shared_ptr<Drawable> drawable;
+        glm::mat4 transform = glm::mat4(0.0f);
+        BoundingSphere bounds;
+    };
+    std::vector<Caster> casters;
+
+    Stats stats;
+
+    // tile width a light wants, 0 if it isn't worth a shadow
+    int desiredTile(const glm::vec3& position, float range, Camera& camera, int viewportHeight) const;
+
+    void assignSlots(const LightingSystem& lighting, Camera& camera, int viewportHeight);
+
+    void render(Slot& slot);
+};
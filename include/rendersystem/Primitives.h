@@ -0,0 +1,29 @@
+#pragma once
+
+#include <rendersystem/Mesh.h>
+
+#include <memory>
+
+// generated shapes uploaded once and shared. a request for a shape of the same kind,
+// dimensions and resolution as one still alive returns the same geometry instead of
+// generating and uploading it again; the geometry goes when the last mesh using it
+// does. requires a current GL context
+namespace Primitives {
+    struct Stats {
+        unsigned int requests = 0;  // calls to the functions below
+        unsigned int created = 0;   // geometries generated and uploaded for them
+    };
+
+    // Geometry::Sphere
+    std::shared_ptr<const MeshGeometry> Sphere(float radius, int resolution = 3);
+
+    // Geometry::Icosphere, as close to round as Sphere() at the same resolution with
+    // fewer triangles
+    std::shared_ptr<const MeshGeometry> Icosphere(float radius, int resolution = 3);
+
+    std::shared_ptr<const MeshGeometry> Cuboid(float length, float height, float depth);
+    std::shared_ptr<const MeshGeometry> Quad(float length, float height);
+
+    const Stats& GetStats();
+    void ResetStats();
+}
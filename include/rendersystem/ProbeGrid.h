@@ -0,0 +1,77 @@
+#pragma once
+
+#include <rendersystem/Shader.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// irradiance at a point as L2 spherical harmonics: nine rgb coefficients, already
+// convolved with the cosine lobe and divided by pi, so evaluating them for a normal
+// gives the light the shader multiplies by the diffuse color (like a lightmap texel)
+struct SH9 {
+    glm::vec3 c[9] = {};
+
+    // the real SH basis for a unit direction, in the order of c
+    static void Basis(const glm::vec3& dir, float out[9]);
+
+    glm::vec3 Evaluate(const glm::vec3& normal) const;
+};
+
+// a regular grid of SH irradiance probes over a box, baked by LightmapBaker::BakeProbes.
+// dynamic objects read it per draw: the probes around the object's center are blended
+// trilinearly on the CPU and the result is uploaded to the PROBE_LIGHTING variant of
+// colors.frag, so the indirect light costs nine uniforms per object
+class ProbeGrid {
+public:
+    ProbeGrid() = default;
+    ProbeGrid(const glm::vec3& lo, const glm::vec3& hi, const glm::ivec3& counts);
+
+    glm::vec3 Lo() const {
+        return lo;
+    }
+
+    glm::vec3 Hi() const {
+        return hi;
+    }
+
+    glm::ivec3 Counts() const {
+        return counts;
+    }
+
+    bool Empty() const {
+        return probes.empty();
+    }
+
+    // probes are stored x fastest, then y, then z
+    int Index(int x, int y, int z) const {
+        return (z * counts.y + y) * counts.x + x;
+    }
+
+    glm::vec3 ProbePosition(int x, int y, int z) const;
+
+    SH9& Probe(int index) {
+        return probes[index];
+    }
+
+    size_t ProbeCount() const {
+        return probes.size();
+    }
+
+    // trilinear blend of the probes around position, clamped to the grid
+    SH9 Sample(const glm::vec3& position) const;
+
+    // samples the grid at position and sets shIrradiance on a PROBE_LIGHTING shader
+    void Bind(const Shader& shader, const glm::vec3& position) const;
+
+    // binary format written by rs_lightbake
+    bool Save(const std::string& path) const;
+    static bool Load(const std::string& path, ProbeGrid& out);
+
+private:
+    glm::vec3 lo = glm::vec3(0.0f);
+    glm::vec3 hi = glm::vec3(0.0f);
+    glm::ivec3 counts = glm::ivec3(0);
+    std::vector<SH9> probes;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <rendersystem/Geometry.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// how a mesh's vertices are stored on the GPU
+enum class VertexEncoding {
+    Float,     // Vertex, 32 bytes
+    Quantized, // QuantizedVertex, 16 bytes, decoded by the QUANTIZED shader variant
+};
+
+// a Vertex in half the space: the position as 16 bit unorms within the mesh's box, the
+// normal octahedral encoded in two 16 bit snorms and the texcoords as half floats
+struct QuantizedVertex {
+    uint16_t Position[3];
+    uint16_t padding = 0; // keeps the normal 4 byte aligned
+    int16_t Normal[2];
+    uint16_t TexCoords[2];
+};
+
+static_assert(sizeof(QuantizedVertex) == 16, "QuantizedVertex must stay 16 bytes");
+
+// what quantizing cost: the bytes saved and the largest error of any vertex, measured by
+// decoding every vertex the way the shader does
+struct QuantizationReport {
+    size_t vertices = 0;
+    size_t floatBytes = 0;
+    size_t quantizedBytes = 0;
+    float maxPositionError = 0.0f;  // model space units
+    float maxRelativeError = 0.0f;  // position error over the size of the mesh's box
+    float maxNormalError = 0.0f;    // degrees
+    float maxTexCoordError = 0.0f;
+
+    void Merge(const QuantizationReport& other);
+    void Print(const std::string& name) const;
+};
+
+// the vertices of one mesh, quantized. positions decode as origin + extent * unorm
+struct QuantizedMesh {
+    std::vector<QuantizedVertex> vertices;
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 extent = glm::vec3(1.0f);
+    QuantizationReport report;
+};
+
+// CPU side encoding and decoding, usable without a GL context
+namespace Quantization {
+    QuantizedMesh Encode(const std::vector<Vertex>& vertices);
+
+    // the inverse of Encode, as colors.vert decodes it
+    Vertex Decode(const QuantizedVertex& vertex, const glm::vec3& origin, const glm::vec3& extent);
+
+    // unit vector to and from the octahedron unfolded onto [-1, 1]^2
+    glm::vec2 OctahedralEncode(const glm::vec3& normal);
+    glm::vec3 OctahedralDecode(const glm::vec2& encoded);
+}
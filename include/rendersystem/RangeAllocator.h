@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// hands out ranges of a linear space of capacity units (vertices, indices, ...).
+// the free space is kept as a list of blocks indexed both by offset (to merge a freed
+// range with its neighbours) and by size (best fit allocation), so both are O(log n)
+class RangeAllocator {
+public:
+    static const uint32_t NONE = 0xffffffffu;
+
+    explicit RangeAllocator(uint32_t capacity = 0);
+
+    // offset of a free range of size units, or NONE if no free block is big enough
+    uint32_t Allocate(uint32_t size);
+
+    // returns a range Allocate() handed out
+    void Free(uint32_t offset, uint32_t size);
+
+    // adds [Capacity(), capacity) as free space
+    void Grow(uint32_t capacity);
+
+    // forgets every range: [0, used) is taken, the rest of capacity is free (after compaction)
+    void Reset(uint32_t capacity, uint32_t used);
+
+    uint32_t Capacity() const {
+        return capacity;
+    }
+
+    uint32_t Used() const {
+        return used;
+    }
+
+    uint32_t FreeBlocks() const {
+        return (uint32_t)byOffset.size();
+    }
+
+    uint32_t LargestFree() const;
+
+    // 1 - largest free block / free space: 0 when the free space is in one piece,
+    // close to 1 when it's scattered over many small holes
+    float Fragmentation() const;
+
+private:
+    uint32_t capacity = 0;
+    uint32_t used = 0;
+
+    std::map<uint32_t, uint32_t> byOffset;    // offset -> size
+    std::multimap<uint32_t, uint32_t> bySize; // size -> offset
+
+    void insertFree(uint32_t offset, uint32_t size);
+    void eraseFree(std::map<uint32_t, uint32_t>::iterator block);
+};
@@ -2,32 +2,180 @@
 
 #include <glad/glad.h> // include glad to get all the required OpenGL headers
 
+#include "GLHandle.h"
+
 #include "glm/glm.hpp"
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <chrono>
+
+// an active uniform of a linked program, as reported by glGetActiveUniform
+struct UniformInfo {
+    std::string name;
+    GLint location;
+    GLenum type;
+    GLint size;
+};
 
+// a uniform resolved once up front so hot loops don't pay for a name lookup.
+// T is the C++ type the value is passed as (int, float, glm::vec3, ...)
+template <typename T>
+struct Uniform {
+    int slot = -1; // index into the owning shader's uniform table, -1 if inactive
+
+    bool valid() const { return slot >= 0; }
+};
+
+// GL calls issued and skipped by Shader since the last Shader::ResetFrameStats()
+struct ShaderFrameStats {
+    unsigned int programBinds = 0;
+    unsigned int programBindsElided = 0;
+    unsigned int uniformUploads = 0;
+    unsigned int uniformUploadsElided = 0;
+};
+
+enum class BuildStatus {
+    Pending,
+    Ready,
+    Failed
+};
 
 class Shader
 {
 public:
-    // the program ID
-    unsigned int ID;
+    // the program ID, owned by program below
+    unsigned int ID = 0;
 
-    // constructor reads and builds the shader
-    Shader(const char* vertexPath, const char* fragmentPath);
-    // use/activate the shader
+    // constructor reads and builds the shader, waiting for the driver to finish.
+    // defines (a block of #define lines) is injected into every stage after #version.
+    // geometryPath optionally adds a geometry stage
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "", const char* geometryPath = nullptr);
+
+    // the program is deleted with the last copy of the Shader
+    ~Shader();
+    Shader(const Shader&) = default;
+    Shader& operator=(const Shader&) = default;
+    Shader(Shader&&) = default;
+    Shader& operator=(Shader&&) = default;
+
+    // reads the sources and submits the build without waiting for it. the program
+    // can't be used until Poll() returns true (see ShaderQueue)
+    static std::shared_ptr<Shader> BuildAsync(const char* vertexPath, const char* fragmentPath, const std::string& defines = "", const char* geometryPath = nullptr);
+
+    // finishes a pending build once the driver is done with it. without
+    // GL_KHR_parallel_shader_compile there is no way to ask, so this only
+    // finishes when allowBlocking is set. returns whether the build is over
+    bool Poll(bool allowBlocking = false);
+
+    BuildStatus Status() const {
+        return status;
+    }
+
+    bool IsReady() const {
+        return status == BuildStatus::Ready;
+    }
+
+    // whether the driver can report build completion (GL_KHR_parallel_shader_compile)
+    static bool ParallelCompileSupported();
+    // use/activate the shader. skipped if it's already the bound program
     void use() const;
 
-    // utility uniform functions
+    // resolve a uniform handle. the type is checked against what the program declares
+    template <typename T>
+    Uniform<T> uniform(const std::string& name) const;
+
+    // fast path uniform functions taking pre-resolved handles
+    void set(Uniform<bool> u, bool value) const;
+    void set(Uniform<int> u, int value) const;
+    void set(Uniform<float> u, float value) const;
+    void set(Uniform<glm::vec3> u, const glm::vec3& value) const;
+    void set(Uniform<glm::mat4> u, const glm::mat4& value) const;
+    // the first count elements of an int array uniform, as one upload
+    void set(Uniform<int> u, const int* values, int count) const;
+
+    // utility uniform functions (slow path, looked up in the uniform table by name).
+    // every setter compares against a shadow copy of the program's uniforms and skips
+    // the GL call when the value hasn't changed. the program doesn't need to be bound
+    // first. copies of a Shader share the program but not the shadow, so keep one
+    // Shader object per program
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
+    void setIntArray(const std::string& name, const int* values, int count) const;
     void setFloat(const std::string& name, float value) const;
     void setMat4(const std::string& name, glm::mat4 value) const;
     void setVec3(const std::string& name, glm::vec3 value) const;
     void setVec3(const std::string& name, float x, float y, float z) const {
         return setVec3(name, glm::vec3(x, y, z));
     }
+
+    // every active uniform of the program, in slot order
+    const std::vector<UniformInfo>& ActiveUniforms() const {
+        return uniforms;
+    }
+
+    // slot of the named uniform in ActiveUniforms(), or -1 if it isn't active
+    int FindUniform(const std::string& name) const;
+
+    static const ShaderFrameStats& FrameStats();
+    static void ResetFrameStats();
+
+    // forget which program is bound, for code that calls glUseProgram directly
+    static void InvalidateBoundProgram();
+
+private:
+    BuildStatus status = BuildStatus::Pending;
+
+    // shared so copies of a Shader keep using the same program
+    std::shared_ptr<GLProgram> program;
+
+    // in-flight build state, only meaningful while status is Pending
+    struct PendingBuild {
+        unsigned int vertex = 0;
+        unsigned int fragment = 0;
+        unsigned int geometry = 0;
+        uint64_t key = 0;
+        bool cached = false;
+        std::chrono::steady_clock::time_point start;
+    } pending;
+
+    // uniform table, filled once after linking
+    std::vector<UniformInfo> uniforms;
+    std::unordered_map<std::string, int> uniformSlots;
+
+    // last value written to each uniform slot, large enough for a mat4
+    struct UniformShadow {
+        bool valid = false;
+        float data[16];
+    };
+    mutable std::vector<UniformShadow> shadow;
+
+    Shader() = default;
+
+    // reads the sources and either loads a cached binary or submits compile and link
+    void beginBuild(const char* vertexPath, const char* fragmentPath, const std::string& defines, const char* geometryPath);
+
+    // submits the stages for compilation and the program for linking, without waiting.
+    // an empty geometryCode means no geometry stage
+    void compileAndLink(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode);
+
+    // checks the results of a submitted build, caches the binary and reflects uniforms
+    void finishBuild();
+
+    // enumerates the active uniforms of the linked program into the uniform table
+    void reflectUniforms();
+
+    // records value in the shadow copy. returns false if the upload can be skipped
+    bool shadowChanged(int slot, const void* value, size_t bytes) const;
+
+    void uploadInt(int slot, int value) const;
+    void uploadIntArray(int slot, const int* values, int count) const;
+    void uploadFloat(int slot, float value) const;
+    void uploadVec3(int slot, const glm::vec3& value) const;
+    void uploadMat4(int slot, const glm::mat4& value) const;
 };
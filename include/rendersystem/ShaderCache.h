@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+
+// on-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+// entries are keyed on a hash of the shader sources and the driver/renderer strings,
+// so a driver update or a source edit simply misses and the program is rebuilt.
+namespace ShaderCache {
+    struct Stats {
+        unsigned int hits = 0;      // programs loaded from a cached binary
+        unsigned int misses = 0;    // programs compiled from source
+        unsigned int rejected = 0;  // cached binaries the driver refused (counted as misses too)
+        unsigned int stored = 0;    // binaries written back to the cache
+        double loadSeconds = 0.0;   // time spent building programs that hit
+        double compileSeconds = 0.0; // time spent building programs that missed
+    };
+
+    // directory the binaries are kept in. defaults to $RS_SHADER_CACHE_DIR, or a
+    // folder in the system temp directory. an empty directory disables the cache
+    void SetDirectory(const std::string& dir);
+    const std::string& Directory();
+
+    // whether the cache can be used: it needs a directory and a driver that
+    // supports at least one program binary format. requires a current GL context
+    bool Enabled();
+
+    // hash of the sources and the current driver, used as the cache key
+    uint64_t Key(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode = "");
+
+    // loads the binary stored for key into program. returns false (and leaves the
+    // program unlinked) if there is no entry or the driver rejects it
+    bool Load(unsigned int program, uint64_t key);
+
+    // writes the binary of a successfully linked program to the cache
+    void Store(unsigned int program, uint64_t key);
+
+    // time accounting for program builds, called by Shader
+    void RecordBuildTime(bool hit, double seconds);
+
+    const Stats& GetStats();
+    void ResetStats();
+
+    // prints hit/miss counts and the time spent building programs
+    void PrintReport(std::ostream& os = std::cout);
+}
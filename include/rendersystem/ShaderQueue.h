@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <rendersystem/Shader.h>
+
+#include <memory>
+#include <vector>
+
+// a program submitted to a ShaderQueue that may still be building
+class ShaderFuture {
+public:
+    ShaderFuture() = default;
+    explicit ShaderFuture(std::shared_ptr<Shader> shader) : shader(shader) {}
+
+    // false for a default constructed future, nothing was submitted
+    bool Valid() const {
+        return shader != nullptr;
+    }
+
+    bool Ready() const {
+        return shader && shader->IsReady();
+    }
+
+    bool Failed() const {
+        return shader && shader->Status() == BuildStatus::Failed;
+    }
+
+    // the program once it's ready. check Ready() first
+    Shader& Get() const {
+        return *shader;
+    }
+
+    // the program if it's ready, otherwise the fallback
+    const Shader& GetOr(const Shader& fallback) const {
+        return Ready() ? *shader : fallback;
+    }
+
+private:
+    std::shared_ptr<Shader> shader;
+};
+
+// submits every program up front and finishes them as the driver completes them, so
+// startup and frames never stall on a single compile. with GL_KHR_parallel_shader_compile
+// the driver compiles on its own threads and Poll() never blocks; without it, Poll()
+// finishes at most a few programs per call so the cost is spread over several frames
+class ShaderQueue {
+public:
+    // loader is used to resolve glMaxShaderCompilerThreadsKHR, which isn't part of
+    // the generated glad loader. pass nullptr to keep the driver's default thread count
+    explicit ShaderQueue(GLADloadproc loader = nullptr);
+
+    ShaderFuture Submit(const char* vertexPath, const char* fragmentPath, const std::string& defines = "");
+
+    // finishes programs the driver has completed. maxBlocking limits how many programs
+    // may be waited on when completion can't be queried
+    void Poll(int maxBlocking = 1);
+
+    // waits for every submitted program
+    void Finish();
+
+    size_t Pending() const {
+        return pending.size();
+    }
+
+    bool Idle() const {
+        return pending.empty();
+    }
+
+private:
+    std::vector<std::shared_ptr<Shader>> pending;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <rendersystem/Shader.h>
+#include <rendersystem/ShaderQueue.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// compile-time features of a shader variant. each one becomes a #define in the source,
+// so a variant only pays for what its material and light set actually use
+struct ShaderFeatures {
+    int pointLights = -1;        // exact number of point lights evaluated (NR_POINT_LIGHTS), -1 reads the count at runtime
+    int directionalLights = -1;  // exact number of directional lights (NR_DIRECTIONAL_LIGHTS), -1 reads the count at runtime
+    bool alphaTest = false;      // discard fragments with a low diffuse alpha (ALPHA_TEST)
+    bool specularMap = false;    // sample material.texture_specular1 (SPECULAR_MAP)
+    bool visualiseDepth = false; // debug: output linearised depth (VISUALISE_DEPTH)
+    bool clustered = false;      // point lights come from LightClusters instead of the Lights block (CLUSTERED_LIGHTING)
+    bool perObjectLights = false; // only the point lights listed in objectLights[] (PER_OBJECT_LIGHTS), see LightingSystem::SelectPointLights
+    bool shadows = false;        // the first directional light is shadowed by CascadedShadows (SHADOWS)
+    bool pointShadows = false;   // point lights picked by PointShadows cast shadows (POINT_SHADOWS)
+    bool lightmap = false;       // directional lights come from material.texture_lightmap (LIGHTMAP), point lights are still evaluated
+    bool probes = false;         // indirect light from a ProbeGrid (PROBE_LIGHTING), see ProbeGrid::Bind
+    bool instanced = false;      // transform, color and diffuse layer per instance (INSTANCED), see InstancedMesh
+    bool quantized = false;      // vertices in the QuantizedVertex layout, decoded in the vertex shader (QUANTIZED)
+
+    // packs the features into a key identifying the variant
+    uint64_t Key() const;
+
+    // the #define block injected after #version
+    std::string Defines() const;
+};
+
+// every variant of one vertex/fragment source pair, built on first use and cached by key
+class ShaderVariants {
+public:
+    // with a queue, variants are built asynchronously and Get() may return a future
+    // that isn't ready yet. without one they are built (blocking) on first use
+    ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, ShaderQueue* queue = nullptr);
+
+    ShaderFuture Get(const ShaderFeatures& features);
+
+    size_t Count() const {
+        return variants.size();
+    }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    ShaderQueue* queue;
+
+    std::unordered_map<uint64_t, ShaderFuture> variants;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+// hands out square, power of two tiles of a shadow map atlas. free space is kept as a
+// quadtree: a tile is split in four to serve smaller requests and merged back once all
+// four quarters are free again
+class ShadowAtlas {
+public:
+    struct Tile {
+        int x = 0;
+        int y = 0;
+        int size = 0; // 0 for no tile
+
+        bool Valid() const {
+            return size > 0;
+        }
+    };
+
+    ShadowAtlas(int size, int minTile);
+
+    // a tile of at least size texels (rounded up to a power of two, clamped to the
+    // atlas), or an invalid tile if there's no room
+    Tile Allocate(int size);
+    void Free(const Tile& tile);
+
+    // texels not handed out
+    long long FreeArea() const;
+
+    int Size() const {
+        return size;
+    }
+
+private:
+    int size;
+    int minTile;
+
+    // free tiles of each level, level 0 is the whole atlas
+    std::vector<std::vector<Tile>> freeTiles;
+
+    int levelOf(int tileSize) const;
+    bool takeFree(int level, int x, int y);
+};
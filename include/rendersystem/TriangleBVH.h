@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// bounding volume hierarchy over a triangle soup for CPU ray casts (the lightmap baker,
+// probe baking). built once with binned SAH splits into a flat node array; queries
+// are const and can run from any number of threads
+class TriangleBVH {
+public:
+    struct Hit {
+        float t = 0.0f;
+        uint32_t triangle = 0; // index into the triangles passed to Build()
+        float u = 0.0f;        // barycentrics of the second and third vertex
+        float v = 0.0f;
+    };
+
+    // positions holds three vertices per triangle
+    void Build(const std::vector<glm::vec3>& positions);
+
+    // closest hit along origin + t * dir for t in (0, tMax)
+    bool Intersect(const glm::vec3& origin, const glm::vec3& dir, float tMax, Hit& hit) const;
+
+    // whether anything is hit in (0, tMax), stopping at the first hit found
+    bool Occluded(const glm::vec3& origin, const glm::vec3& dir, float tMax) const;
+
+    size_t TriangleCount() const {
+        return triangles.size();
+    }
+
+    size_t NodeCount() const {
+        return nodes.size();
+    }
+
+private:
+    // a leaf when count > 0 (first triangle at leftOrFirst), else the left child is at
+    // leftOrFirst and the right one follows it
+    struct Node {
+        glm::vec3 lo;
+        uint32_t leftOrFirst;
+        glm::vec3 hi;
+        uint32_t count;
+    };
+
+    // precomputed for the Moller-Trumbore test
+    struct Triangle {
+        glm::vec3 v0;
+        glm::vec3 e1;
+        glm::vec3 e2;
+        uint32_t id;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Triangle> triangles;
+
+    template <bool AnyHit>
+    bool traverse(const glm::vec3& origin, const glm::vec3& dir, float tMax, Hit& hit) const;
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+
+// fixed binding points of the uniform blocks shared between shaders. Shader binds
+// every active block it finds with one of these names after linking
+namespace UniformBlocks {
+    const GLuint FRAME_CONSTANTS = 0;
+    const GLuint LIGHTS = 1;
+
+    // binding point for the named block, or GL_INVALID_INDEX if it isn't a shared block
+    GLuint Binding(const std::string& blockName);
+}
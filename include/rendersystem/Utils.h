@@ -2,8 +2,18 @@
 
 #include <iostream>
 #include <functional>
+#include <string>
+#include <vector>
 
 namespace Utils {
+    // loads an image into a new GL texture. channels, if given, receives the number
+    // of channels in the image (4 means it has an alpha channel)
     unsigned int TextureFromFile(const std::string& path,
-        std::function<void(void)> textureSettingsCallback = []() {});
+        std::function<void(void)> textureSettingsCallback = []() {},
+        int* channels = nullptr);
+
+    // loads images into the layers of a new GL_TEXTURE_2D_ARRAY, in order. every layer
+    // is RGBA at the size of the first image, others are point sampled to that size.
+    // returns 0 if the first image can't be loaded
+    unsigned int TextureArrayFromFiles(const std::vector<std::string>& paths);
 }
\ No newline at end of file
@@ -5,17 +5,24 @@ layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+layout (std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPos;
+    vec4 depthRange;
+};
 
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * worldPos;
 
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    FragPos = worldPos.xyz;
     Normal = vec3(model * vec4(aNormal, 0.0));
     TexCoords = aTexCoords;
 }
\ No newline at end of file
@@ -3,76 +3,271 @@ out vec4 FragColor;
 in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
+#ifdef LIGHTMAP
+in vec2 LightmapUV;
+#endif
+#ifdef INSTANCED
+in vec3 InstanceColor;       // takes the place of material.ambient
+flat in float InstanceLayer; // layer of material.texture_diffuse_array
+#endif
+
+// ShaderVariants injects the feature defines (see ShaderVariants.h). without them, as a
+// plain Shader, the program falls back to the generic build below: light counts read
+// from the Lights block, alpha test and specular map on, depth debug as a uniform
+#ifndef SHADER_VARIANT
+#define ALPHA_TEST
+#define SPECULAR_MAP
+#define RUNTIME_VISUALISE_DEPTH
+#endif
 
 uniform vec3 lightColor;
 uniform vec3 lightPos;
-uniform vec3 viewPos;
+
+// camera constants, filled once per frame by FrameConstants
+layout (std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPos;
+    vec4 depthRange;
+};
 
 struct Material {
     vec3 ambient;
+#ifdef INSTANCED
+    sampler2DArray texture_diffuse_array; // one layer per instance, see InstancedMesh
+#else
     sampler2D texture_diffuse1;
+#endif
     sampler2D texture_specular1;
+#ifdef LIGHTMAP
+    sampler2D texture_lightmap; // baked by rs_lightbake, see LightmapBaker
+#endif
     float shininess;
 };
 
 struct PointLight {
-    bool activated;
-
-    vec3 position;
+    vec4 position;
+    vec4 attenuation; // x: constant, y: linear, z: quadratic
 
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
 };
 
 struct DirectionalLight {
-    bool activated;
+    vec4 direction;
 
-    vec3 direction;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
 
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+// every light in the scene, uploaded by LightingSystem. the capacities must match
+// LightingSystem::MAX_POINT_LIGHTS and MAX_DIRECTIONAL_LIGHTS
+#define MAX_POINT_LIGHTS 192
+#define MAX_DIRECTIONAL_LIGHTS 4
+layout (std140) uniform Lights {
+    ivec4 lightCounts; // x: point lights, y: directional lights
+    DirectionalLight directionalLights[MAX_DIRECTIONAL_LIGHTS];
+    PointLight pointLights[MAX_POINT_LIGHTS];
 };
 
-#define NR_POINT_LIGHTS_MAX 4
-uniform PointLight pointLights[NR_POINT_LIGHTS_MAX];
+// a variant compiled for an exact light set gets a constant loop bound
+#ifdef NR_POINT_LIGHTS
+#define POINT_LIGHT_COUNT NR_POINT_LIGHTS
+#else
+#define POINT_LIGHT_COUNT lightCounts.x
+#endif
+
+#ifdef NR_DIRECTIONAL_LIGHTS
+#define DIRECTIONAL_LIGHT_COUNT NR_DIRECTIONAL_LIGHTS
+#else
+#define DIRECTIONAL_LIGHT_COUNT lightCounts.y
+#endif
+
+#ifdef PER_OBJECT_LIGHTS
+// the point lights that reach this draw, picked on the CPU from the light ranges.
+// must match LightingSystem::MAX_OBJECT_LIGHTS
+#define MAX_OBJECT_LIGHTS 8
+uniform int objectLightCount;
+uniform int objectLights[MAX_OBJECT_LIGHTS];
+#endif
+
+#ifdef CLUSTERED_LIGHTING
+// forward+ path: every point light lives in a texture buffer (five texels per light,
+// see LightingSystem::PointLightTexture) and LightClusters lists the ones touching
+// each cluster. the texture units are fixed by LightClusters
+uniform samplerBuffer pointLightData;
+uniform usamplerBuffer clusterRanges;       // (offset, count) per cluster
+uniform usamplerBuffer clusterLightIndices;
+uniform vec3 clusterGrid;                   // tiles x, tiles y, depth slices
+uniform vec3 clusterParams;                 // tile width, tile height (pixels), slice scale
+uniform float clusterDepthBias;
+
+PointLight FetchPointLight(int index) {
+    int base = index * 5;
+    PointLight light;
+    light.position = texelFetch(pointLightData, base);
+    light.attenuation = texelFetch(pointLightData, base + 1);
+    light.ambient = texelFetch(pointLightData, base + 2);
+    light.diffuse = texelFetch(pointLightData, base + 3);
+    light.specular = texelFetch(pointLightData, base + 4);
+    return light;
+}
 
-#define NR_DIRECTIONAL_LIGHTS_MAX 2
-uniform DirectionalLight directionalLights[NR_DIRECTIONAL_LIGHTS_MAX];
+int ClusterIndex(vec3 fragPos) {
+    // slice = log(depth) * scale + bias, matching LightClusters::sliceDepth
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int slice = int(clamp(floor(log(depth) * clusterParams.z + clusterDepthBias), 0.0, clusterGrid.z - 1.0));
+    ivec2 tile = ivec2(clamp(floor(gl_FragCoord.xy / clusterParams.xy), vec2(0.0), clusterGrid.xy - 1.0));
+    return (slice * int(clusterGrid.y) + tile.y) * int(clusterGrid.x) + tile.x;
+}
+#endif
+
+#ifdef SHADOWS
+// cascaded shadow maps of the first directional light, bound by CascadedShadows::Bind
+#define MAX_CASCADES 4
+uniform sampler2DArrayShadow shadowMaps;
+uniform mat4 cascadeMatrices[MAX_CASCADES];
+uniform vec3 cascadeSplits; // view depth the first three cascades end at
+uniform float shadowDistance; // and the last one
+uniform int cascadeCount;
+
+float ShadowFactor(vec3 fragPos, vec3 normal, vec3 lightDir) {
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    if (depth > shadowDistance) return 1.0;
+
+    int cascade = 0;
+    while (cascade < cascadeCount - 1 && cascade < 3 && depth > cascadeSplits[cascade]) cascade++;
+
+    vec4 lightSpace = cascadeMatrices[cascade] * vec4(fragPos, 1.0);
+    vec3 coord = lightSpace.xyz * 0.5 + 0.5;
+    if (coord.z > 1.0) return 1.0;
+
+    // slope scaled bias against acne on surfaces grazing the light
+    float bias = max(0.004 * (1.0 - dot(normal, lightDir)), 0.0005);
+
+    // 3x3 PCF on top of the hardware comparison
+    vec2 texel = 1.0 / vec2(textureSize(shadowMaps, 0).xy);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            lit += texture(shadowMaps, vec4(coord.xy + vec2(x, y) * texel, float(cascade), coord.z - bias));
+        }
+    }
+    return lit / 9.0;
+}
+#endif
+
+#ifdef POINT_SHADOWS
+// cube shadow maps of the lights PointShadows picked, one atlas tile per light at the
+// same place in each face layer. must match PointShadows::MAX_SHADOWED_LIGHTS
+#define MAX_SHADOWED_POINT_LIGHTS 4
+uniform sampler2DArrayShadow pointShadowAtlas;
+uniform int pointShadowLights[MAX_SHADOWED_POINT_LIGHTS]; // light index, -1 for an empty slot
+uniform vec3 pointShadowTiles[MAX_SHADOWED_POINT_LIGHTS]; // tile x, y and size, in atlas units
+uniform float pointShadowFar[MAX_SHADOWED_POINT_LIGHTS];
+
+// up vectors of the faces, in layer order +X, -X, +Y, -Y, +Z, -Z (see PointShadows.cpp)
+const vec3 FACE_UPS[6] = vec3[](
+    vec3(0, -1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1), vec3(0, -1, 0), vec3(0, -1, 0));
+#endif
+
+// 1 when the light reaches fragPos, 0 when a caster is in the way
+float PointShadow(int lightIndex, vec3 lightPos, vec3 fragPos) {
+#ifdef POINT_SHADOWS
+    int slot = -1;
+    for (int i = 0; i < MAX_SHADOWED_POINT_LIGHTS; i++) {
+        if (pointShadowLights[i] == lightIndex) slot = i;
+    }
+    if (slot < 0) return 1.0;
+
+    // the face is picked by the major axis, like a cube map lookup
+    vec3 p = fragPos - lightPos;
+    vec3 a = abs(p);
+    int face;
+    vec3 dir;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = p.x >= 0.0 ? 0 : 1;
+        dir = vec3(sign(p.x), 0.0, 0.0);
+    }
+    else if (a.y >= a.z) {
+        face = p.y >= 0.0 ? 2 : 3;
+        dir = vec3(0.0, sign(p.y), 0.0);
+    }
+    else {
+        face = p.z >= 0.0 ? 4 : 5;
+        dir = vec3(0.0, 0.0, sign(p.z));
+    }
+
+    // project onto the face the way glm::lookAt and a 90 degree perspective do
+    vec3 s = normalize(cross(dir, FACE_UPS[face]));
+    vec3 u = cross(s, dir);
+    vec2 uv = vec2(dot(s, p), dot(u, p)) / dot(dir, p) * 0.5 + 0.5;
+
+    // stay half a texel inside the tile so filtering doesn't read the neighbours
+    vec3 tile = pointShadowTiles[slot];
+    float halfTexel = 0.5 / float(textureSize(pointShadowAtlas, 0).x);
+    vec2 atlasUV = tile.xy + clamp(uv * tile.z, vec2(halfTexel), vec2(tile.z - halfTexel));
+
+    float depth = length(p) / pointShadowFar[slot];
+    if (depth >= 1.0) return 1.0;
+    return texture(pointShadowAtlas, vec4(atlasUV, float(face), depth - 0.005));
+#else
+    return 1.0;
+#endif
+}
+
+#ifdef PROBE_LIGHTING
+// indirect light at this object, blended from the ProbeGrid on the CPU. L2 spherical
+// harmonics already convolved for irradiance, in the basis order of SH9::Basis
+uniform vec3 shIrradiance[9];
+
+vec3 ProbeIrradiance(vec3 n) {
+    vec3 result = shIrradiance[0] * 0.282095
+        + shIrradiance[1] * (0.488603 * n.y)
+        + shIrradiance[2] * (0.488603 * n.z)
+        + shIrradiance[3] * (0.488603 * n.x)
+        + shIrradiance[4] * (1.092548 * n.x * n.y)
+        + shIrradiance[5] * (1.092548 * n.y * n.z)
+        + shIrradiance[6] * (0.315392 * (3.0 * n.z * n.z - 1.0))
+        + shIrradiance[7] * (1.092548 * n.x * n.z)
+        + shIrradiance[8] * (0.546274 * (n.x * n.x - n.y * n.y));
+    return max(result, vec3(0.0));
+}
+#endif
 
 uniform Material material;
 
-uniform float near = 0.1;
-uniform float far = 100.0;
+#ifdef RUNTIME_VISUALISE_DEPTH
 uniform bool enableVisualiseDepthBuffer = false;
+#endif
+
+vec4 CalcPointLight(int index, PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec4 diffColor, vec4 specColor) {
+    float shadow = PointShadow(index, light.position.xyz, fragPos);
+
+    // the attenuation (depends on distance from the light) scales every term, so past
+    // the light's range (PointLight::Range) it adds too little to see and can be culled
+    float d = length(fragPos - light.position.xyz);
+    float attenuation = 1.0 / (light.attenuation.x + light.attenuation.y*d + light.attenuation.z * d * d);
 
-vec4 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
     // calculate the ambient color. material.ambient specifies the absorption of RGB,
     // so multiplying it by lightColor gives the ambient color.
-    vec4 ambient = vec4(material.ambient * light.ambient, 1.0);
+#ifdef INSTANCED
+    vec4 ambient = vec4(attenuation * InstanceColor * light.ambient.rgb, 1.0);
+#else
+    vec4 ambient = vec4(attenuation * material.ambient * light.ambient.rgb, 1.0);
+#endif
 
     // compute the diffuse color.
     //   1. calculate the orientation of the surface relative to the *light*
-    vec3 lightDir = normalize(light.position - fragPos);
+    vec3 lightDir = normalize(light.position.xyz - fragPos);
     vec3 norm = normalize(normal);
     float diff = max(dot(norm, lightDir), 0.0);
 
-    //   2. calculate the attenuation (depends on distance from the light)
-    float d = length(fragPos - light.position);
-    float attenuation = 1.0 / (light.constant + light.linear*d + light.quadratic * d * d);
-
-    //  3. compute the overall diffuse color (light color attenuated * orientation attenuation * base diffuse color)
-    vec4 diffColor = texture(material.texture_diffuse1, TexCoords);
-    vec4 specColor = texture(material.texture_specular1, TexCoords);
-    if (diffColor.a < 0.1) discard;
-    if (specColor.a < 0.1) discard;
-
-    vec4 diffuse = attenuation * vec4(light.diffuse, 1.0) * diff * diffColor;
+    //  2. compute the overall diffuse color (light color attenuated * orientation attenuation * base diffuse color)
+    vec4 diffuse = attenuation * vec4(light.diffuse.rgb, 1.0) * diff * diffColor * shadow;
 
     // compute the specular color.
     //   1. reflect the light direction about the surface normal (i.e. how reflections work in real life)
@@ -84,57 +279,106 @@ vec4 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
     float spec = pow(specFactor, material.shininess);
 
     //   4. compute the overall specular color (the spec intensity * the base specular color) * lightColor
-    vec4 specular = specColor * spec * vec4(light.specular, 1.0);  
+    vec4 specular = attenuation * specColor * spec * vec4(light.specular.rgb, 1.0) * shadow;
 
     // combine the ambient, diffuse and specular colors
     return ambient + diffuse + specular;
 }
 
-vec4 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir) {
-    vec3 lightDir = normalize(-light.direction);
+// shadow scales the diffuse and specular terms, 1 is fully lit
+vec4 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec4 diffColor, vec4 specColor, float shadow) {
+    vec3 lightDir = normalize(-light.direction.xyz);
 
     float diff = max(dot(normal, lightDir), 0.0);
 
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
 
-    vec4 diffColor = texture(material.texture_diffuse1, TexCoords);
-    vec4 specColor = texture(material.texture_specular1, TexCoords);
-
-    if (diffColor.a < 0.1) discard;
-    if (specColor.a < 0.1) discard;
-
-    vec4 ambient = vec4(light.ambient, 1.0) * diffColor;
-    vec4 diffuse =  vec4(light.diffuse, 1.0) * diff * diffColor;
-    vec4 specular =  vec4(light.specular, 1.0) * spec * specColor;
+    vec4 ambient = vec4(light.ambient.rgb, 1.0) * diffColor;
+    vec4 diffuse =  vec4(light.diffuse.rgb, 1.0) * diff * diffColor * shadow;
+    vec4 specular =  vec4(light.specular.rgb, 1.0) * spec * specColor * shadow;
 
     return (ambient + diffuse + specular);
 }
 
 float LinearizeDepth(float depth) {
+    float near = depthRange.x;
+    float far = depthRange.y;
     float z = 2.0 * depth - 1.0;
     return (2.0 * near * far) / (far + near - z * (far - near));
 }
 
 void main() {
+#ifdef VISUALISE_DEPTH
+    FragColor = vec4(vec3(LinearizeDepth(gl_FragCoord.z) / depthRange.y), 1.0);
+    return;
+#endif
+
+    // the material textures are the same for every light, sample them once
+#ifdef INSTANCED
+    vec4 diffColor = texture(material.texture_diffuse_array, vec3(TexCoords, InstanceLayer));
+#else
+    vec4 diffColor = texture(material.texture_diffuse1, TexCoords);
+#endif
+#ifdef SPECULAR_MAP
+    vec4 specColor = texture(material.texture_specular1, TexCoords);
+#else
+    // without a specular map the unbound sampler used to read unit 0, the diffuse map
+    vec4 specColor = diffColor;
+#endif
+
+#ifdef ALPHA_TEST
+    if (diffColor.a < 0.1) discard;
+#ifdef SPECULAR_MAP
+    if (specColor.a < 0.1) discard;
+#endif
+#endif
+
     // apply any textures we need in addition to the phong lighting
     // info required for point lights
     //   1. calculate the orientation of the surface relative to the *camera*
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(cameraPos.xyz - FragPos);
     FragColor = vec4(0.0);
-    for (int i = 0; i < NR_POINT_LIGHTS_MAX; i++) {
-        if (pointLights[i].activated) {
-            FragColor += CalcPointLight(pointLights[i], Normal, FragPos, viewDir);
-        }
+#ifdef CLUSTERED_LIGHTING
+    uvec2 range = texelFetch(clusterRanges, ClusterIndex(FragPos)).xy;
+    for (uint i = 0u; i < range.y; i++) {
+        int index = int(texelFetch(clusterLightIndices, int(range.x + i)).x);
+        FragColor += CalcPointLight(index, FetchPointLight(index), Normal, FragPos, viewDir, diffColor, specColor);
     }
-
-    for (int i = 0; i < NR_DIRECTIONAL_LIGHTS_MAX; i++) {
-        if (directionalLights[i].activated) {
-            FragColor += CalcDirectionalLight(directionalLights[i], Normal, viewDir);
+#elif defined(PER_OBJECT_LIGHTS)
+    for (int i = 0; i < objectLightCount; i++) {
+        FragColor += CalcPointLight(objectLights[i], pointLights[objectLights[i]], Normal, FragPos, viewDir, diffColor, specColor);
+    }
+#else
+    for (int i = 0; i < POINT_LIGHT_COUNT; i++) {
+        FragColor += CalcPointLight(i, pointLights[i], Normal, FragPos, viewDir, diffColor, specColor);
+    }
+#endif
+
+#ifdef LIGHTMAP
+    // the directional lights (and any static point lights) are baked with their shadows
+    // and bounce light, only the diffuse color is applied here
+    FragColor += vec4(texture(material.texture_lightmap, LightmapUV).rgb, 1.0) * diffColor;
+#else
+    for (int i = 0; i < DIRECTIONAL_LIGHT_COUNT; i++) {
+        float shadow = 1.0;
+#ifdef SHADOWS
+        if (i == 0) {
+            vec3 norm = normalize(Normal);
+            shadow = ShadowFactor(FragPos, norm, normalize(-directionalLights[0].direction.xyz));
         }
+#endif
+        FragColor += CalcDirectionalLight(directionalLights[i], Normal, viewDir, diffColor, specColor, shadow);
     }
+#endif
 
+#ifdef PROBE_LIGHTING
+    FragColor += vec4(ProbeIrradiance(normalize(Normal)), 0.0) * diffColor;
+#endif
+
+#ifdef RUNTIME_VISUALISE_DEPTH
     if (enableVisualiseDepthBuffer) {
-        FragColor = vec4(vec3(LinearizeDepth(gl_FragCoord.z) / far), 1.0);
+        FragColor = vec4(vec3(LinearizeDepth(gl_FragCoord.z) / depthRange.y), 1.0);
     }
-}
\ No newline at end of file
+#endif
+}
@@ -1,22 +1,81 @@
 #version 330 core
+#ifdef QUANTIZED
+// see QuantizedVertex, texcoords are half floats and need no decoding
+layout (location = 0) in vec3 aPos;    // unorm within the mesh's box
+layout (location = 1) in vec2 aNormal; // octahedral, snorm
+uniform vec3 positionOrigin;
+uniform vec3 positionExtent;
+
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#else
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+#endif
 layout (location = 2) in vec2 aTexCoords;
+#ifdef LIGHTMAP
+layout (location = 3) in vec2 aLightmapUV;
+out vec2 LightmapUV;
+#endif
+#ifdef INSTANCED
+// per instance, see InstancedMesh::InstanceData
+layout (location = 4) in vec4 aInstancePosition; // xyz: position, w: uniform scale
+layout (location = 5) in vec4 aInstanceRotation; // unit quaternion (x, y, z, w)
+layout (location = 6) in vec4 aInstanceColor;    // rgb: color, a: diffuse texture layer
+out vec3 InstanceColor;
+flat out float InstanceLayer;
+
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+#endif
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// camera constants, filled once per frame by FrameConstants
+layout (std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPos;
+    vec4 depthRange;
+};
 
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
 
 void main() {
-    // compute the position using the projection, view, and model(world) matrices (no viemodel matrix: for learning purposes)
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifdef QUANTIZED
+    vec3 position = positionOrigin + positionExtent * aPos;
+    vec3 normal = octahedralDecode(aNormal);
+#else
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+#endif
+
+    // compute the position using the model(world) matrix and the precomputed view-projection matrix
+#ifdef INSTANCED
+    vec4 worldPos = vec4(rotate(aInstanceRotation, position * aInstancePosition.w) + aInstancePosition.xyz, 1.0);
+    vec3 worldNormal = rotate(aInstanceRotation, normal);
+    InstanceColor = aInstanceColor.rgb;
+    InstanceLayer = aInstanceColor.a;
+#else
+    vec4 worldPos = model * vec4(position, 1.0);
+    vec3 worldNormal = vec3(model * vec4(normal, 0.0));
+#endif
+    gl_Position = viewProjection * worldPos;
 
     // forward the normal, fragpos in world space to the fragment shader
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = vec3(model * vec4(aNormal, 0.0));
+    FragPos = worldPos.xyz;
+    Normal = worldNormal;
     TexCoords = aTexCoords;
+#ifdef LIGHTMAP
+    LightmapUV = aLightmapUV;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,239 @@
+#version 330 core
+// lighting pass of DeferredRenderer: shades every G-buffer pixel once with the
+// directional lights and the point lights of its cluster. SHADOWS and POINT_SHADOWS
+// sample the same shadow maps as the colors.frag variants
+out vec4 FragColor;
+in vec2 TexCoords;
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gAmbient;
+uniform sampler2D gDepth;
+
+// camera constants, filled once per frame by FrameConstants
+layout (std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPos;
+    vec4 depthRange;
+};
+
+struct PointLight {
+    vec4 position;
+    vec4 attenuation; // x: constant, y: linear, z: quadratic
+
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+struct DirectionalLight {
+    vec4 direction;
+
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+};
+
+// must match LightingSystem, see colors.frag
+#define MAX_POINT_LIGHTS 192
+#define MAX_DIRECTIONAL_LIGHTS 4
+layout (std140) uniform Lights {
+    ivec4 lightCounts; // x: point lights, y: directional lights
+    DirectionalLight directionalLights[MAX_DIRECTIONAL_LIGHTS];
+    PointLight pointLights[MAX_POINT_LIGHTS];
+};
+
+// cluster data, bound by LightClusters::Bind (same as the CLUSTERED_LIGHTING colors.frag)
+uniform samplerBuffer pointLightData;
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterLightIndices;
+uniform vec3 clusterGrid;
+uniform vec3 clusterParams;
+uniform float clusterDepthBias;
+
+PointLight FetchPointLight(int index) {
+    int base = index * 5;
+    PointLight light;
+    light.position = texelFetch(pointLightData, base);
+    light.attenuation = texelFetch(pointLightData, base + 1);
+    light.ambient = texelFetch(pointLightData, base + 2);
+    light.diffuse = texelFetch(pointLightData, base + 3);
+    light.specular = texelFetch(pointLightData, base + 4);
+    return light;
+}
+
+vec3 DecodeNormal(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+#ifdef SHADOWS
+// cascaded shadow maps of the first directional light, bound by CascadedShadows::Bind
+#define MAX_CASCADES 4
+uniform sampler2DArrayShadow shadowMaps;
+uniform mat4 cascadeMatrices[MAX_CASCADES];
+uniform vec3 cascadeSplits; // view depth the first three cascades end at
+uniform float shadowDistance; // and the last one
+uniform int cascadeCount;
+
+float ShadowFactor(vec3 fragPos, vec3 normal, vec3 lightDir) {
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    if (depth > shadowDistance) return 1.0;
+
+    int cascade = 0;
+    while (cascade < cascadeCount - 1 && cascade < 3 && depth > cascadeSplits[cascade]) cascade++;
+
+    vec4 lightSpace = cascadeMatrices[cascade] * vec4(fragPos, 1.0);
+    vec3 coord = lightSpace.xyz * 0.5 + 0.5;
+    if (coord.z > 1.0) return 1.0;
+
+    // slope scaled bias against acne on surfaces grazing the light
+    float bias = max(0.004 * (1.0 - dot(normal, lightDir)), 0.0005);
+
+    // 3x3 PCF on top of the hardware comparison
+    vec2 texel = 1.0 / vec2(textureSize(shadowMaps, 0).xy);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            lit += texture(shadowMaps, vec4(coord.xy + vec2(x, y) * texel, float(cascade), coord.z - bias));
+        }
+    }
+    return lit / 9.0;
+}
+#endif
+
+#ifdef POINT_SHADOWS
+// cube shadow maps of the lights PointShadows picked, one atlas tile per light at the
+// same place in each face layer. must match PointShadows::MAX_SHADOWED_LIGHTS
+#define MAX_SHADOWED_POINT_LIGHTS 4
+uniform sampler2DArrayShadow pointShadowAtlas;
+uniform int pointShadowLights[MAX_SHADOWED_POINT_LIGHTS]; // light index, -1 for an empty slot
+uniform vec3 pointShadowTiles[MAX_SHADOWED_POINT_LIGHTS]; // tile x, y and size, in atlas units
+uniform float pointShadowFar[MAX_SHADOWED_POINT_LIGHTS];
+
+// up vectors of the faces, in layer order +X, -X, +Y, -Y, +Z, -Z (see PointShadows.cpp)
+const vec3 FACE_UPS[6] = vec3[](
+    vec3(0, -1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1), vec3(0, -1, 0), vec3(0, -1, 0));
+#endif
+
+// 1 when the light reaches fragPos, 0 when a caster is in the way
+float PointShadow(int lightIndex, vec3 lightPos, vec3 fragPos) {
+#ifdef POINT_SHADOWS
+    int slot = -1;
+    for (int i = 0; i < MAX_SHADOWED_POINT_LIGHTS; i++) {
+        if (pointShadowLights[i] == lightIndex) slot = i;
+    }
+    if (slot < 0) return 1.0;
+
+    // the face is picked by the major axis, like a cube map lookup
+    vec3 p = fragPos - lightPos;
+    vec3 a = abs(p);
+    int face;
+    vec3 dir;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = p.x >= 0.0 ? 0 : 1;
+        dir = vec3(sign(p.x), 0.0, 0.0);
+    }
+    else if (a.y >= a.z) {
+        face = p.y >= 0.0 ? 2 : 3;
+        dir = vec3(0.0, sign(p.y), 0.0);
+    }
+    else {
+        face = p.z >= 0.0 ? 4 : 5;
+        dir = vec3(0.0, 0.0, sign(p.z));
+    }
+
+    // project onto the face the way glm::lookAt and a 90 degree perspective do
+    vec3 s = normalize(cross(dir, FACE_UPS[face]));
+    vec3 u = cross(s, dir);
+    vec2 uv = vec2(dot(s, p), dot(u, p)) / dot(dir, p) * 0.5 + 0.5;
+
+    // stay half a texel inside the tile so filtering doesn't read the neighbours
+    vec3 tile = pointShadowTiles[slot];
+    float halfTexel = 0.5 / float(textureSize(pointShadowAtlas, 0).x);
+    vec2 atlasUV = tile.xy + clamp(uv * tile.z, vec2(halfTexel), vec2(tile.z - halfTexel));
+
+    float depth = length(p) / pointShadowFar[slot];
+    if (depth >= 1.0) return 1.0;
+    return texture(pointShadowAtlas, vec4(atlasUV, float(face), depth - 0.005));
+#else
+    return 1.0;
+#endif
+}
+
+// like colors.frag, shadow scales the diffuse and specular terms
+vec3 CalcPointLight(int index, PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 ambient, vec3 diffColor, vec3 specColor, float shininess) {
+    float shadow = PointShadow(index, light.position.xyz, fragPos);
+    vec3 lightDir = normalize(light.position.xyz - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    float d = length(fragPos - light.position.xyz);
+    float attenuation = 1.0 / (light.attenuation.x + light.attenuation.y * d + light.attenuation.z * d * d);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+
+    // every term is attenuated, past the light's range it's too dim to matter
+    return attenuation * (ambient * light.ambient.rgb + (light.diffuse.rgb * diff * diffColor + specColor * spec * light.specular.rgb) * shadow);
+}
+
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 diffColor, vec3 specColor, float shininess, float shadow) {
+    vec3 lightDir = normalize(-light.direction.xyz);
+    float diff = max(dot(normal, lightDir), 0.0);
+
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+
+    return light.ambient.rgb * diffColor + (light.diffuse.rgb * diff * diffColor + light.specular.rgb * spec * specColor) * shadow;
+}
+
+void main() {
+    float depth = texture(gDepth, TexCoords).r;
+    if (depth == 1.0) discard; // background
+
+    // rebuild the view space position from depth, then move it to world space
+    float near = depthRange.x;
+    float far = depthRange.y;
+    float viewDepth = (2.0 * near * far) / (far + near - (2.0 * depth - 1.0) * (far - near));
+    vec2 ndc = TexCoords * 2.0 - 1.0;
+    vec3 viewPos = vec3(ndc.x * viewDepth / projection[0][0], ndc.y * viewDepth / projection[1][1], -viewDepth);
+    vec3 fragPos = cameraPos.xyz + transpose(mat3(view)) * viewPos;
+
+    vec4 albedo = texture(gAlbedo, TexCoords);
+    vec3 diffColor = albedo.rgb;
+    float shininess = albedo.a * 256.0;
+    vec3 specColor = texture(gSpecular, TexCoords).rgb;
+    vec3 normal = DecodeNormal(texture(gNormal, TexCoords).xy);
+    vec3 ambient = texture(gAmbient, TexCoords).rgb;
+
+    vec3 viewDir = normalize(cameraPos.xyz - fragPos);
+    vec3 color = vec3(0.0);
+
+    int slice = int(clamp(floor(log(viewDepth) * clusterParams.z + clusterDepthBias), 0.0, clusterGrid.z - 1.0));
+    ivec2 tile = ivec2(clamp(floor(gl_FragCoord.xy / clusterParams.xy), vec2(0.0), clusterGrid.xy - 1.0));
+    int cluster = (slice * int(clusterGrid.y) + tile.y) * int(clusterGrid.x) + tile.x;
+
+    uvec2 range = texelFetch(clusterRanges, cluster).xy;
+    for (uint i = 0u; i < range.y; i++) {
+        int index = int(texelFetch(clusterLightIndices, int(range.x + i)).x);
+        color += CalcPointLight(index, FetchPointLight(index), normal, fragPos, viewDir, ambient, diffColor, specColor, shininess);
+    }
+
+    for (int i = 0; i < lightCounts.y; i++) {
+        float shadow = 1.0;
+#ifdef SHADOWS
+        if (i == 0) {
+            shadow = ShadowFactor(fragPos, normal, normalize(-directionalLights[0].direction.xyz));
+        }
+#endif
+        color += CalcDirectionalLight(directionalLights[i], normal, viewDir, diffColor, specColor, shininess, shadow);
+    }
+
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,54 @@
+#version 330 core
+// geometry pass of DeferredRenderer: writes the surface, no lighting
+layout (location = 0) out vec4 gAlbedo;   // rgb: diffuse, a: shininess / 256
+layout (location = 1) out vec4 gSpecular; // rgb: specular color
+layout (location = 2) out vec2 gNormal;   // octahedral encoded world space normal
+layout (location = 3) out vec4 gAmbient;  // rgb: material.ambient
+
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+
+// same material features as colors.frag, see ShaderVariants.h
+#ifndef SHADER_VARIANT
+#define ALPHA_TEST
+#define SPECULAR_MAP
+#endif
+
+struct Material {
+    vec3 ambient;
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+    float shininess;
+};
+
+uniform Material material;
+
+vec2 EncodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return n.xy;
+}
+
+void main() {
+    vec4 diffColor = texture(material.texture_diffuse1, TexCoords);
+#ifdef SPECULAR_MAP
+    vec4 specColor = texture(material.texture_specular1, TexCoords);
+#else
+    vec4 specColor = diffColor;
+#endif
+
+#ifdef ALPHA_TEST
+    if (diffColor.a < 0.1) discard;
+#ifdef SPECULAR_MAP
+    if (specColor.a < 0.1) discard;
+#endif
+#endif
+
+    gAlbedo = vec4(diffColor.rgb, material.shininess / 256.0);
+    gSpecular = vec4(specColor.rgb, 1.0);
+    gNormal = EncodeNormal(normalize(Normal));
+    gAmbient = vec4(material.ambient, 1.0);
+}
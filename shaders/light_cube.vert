@@ -2,9 +2,20 @@
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// position decode (see MeshGeometry::BindDecode), identity for float geometry. this is
+// the fallback every program draws with while it builds, quantized meshes included
+uniform vec3 positionOrigin = vec3(0.0);
+uniform vec3 positionExtent = vec3(1.0);
+
+layout (std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPos;
+    vec4 depthRange;
+};
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * model * vec4(positionOrigin + positionExtent * aPos, 1.0);
 }
\ No newline at end of file
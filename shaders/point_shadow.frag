@@ -0,0 +1,10 @@
+#version 330 core
+in vec3 FragPos;
+
+uniform vec3 lightPosition;
+uniform float farPlane;
+
+void main() {
+    // linear distance to the light, so a 16 bit map keeps its precision across the range
+    gl_FragDepth = length(FragPos - lightPosition) / farPlane;
+}
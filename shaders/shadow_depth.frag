@@ -0,0 +1,5 @@
+#version 330 core
+// depth is all the shadow maps need
+
+void main() {
+}
@@ -0,0 +1,14 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+// depth only pass of CascadedShadows
+uniform mat4 model;
+// quantized meshes store positions within their box, Mesh::Draw sets the decode. the
+// defaults leave float positions as they are
+uniform vec3 positionOrigin = vec3(0.0);
+uniform vec3 positionExtent = vec3(1.0);
+uniform mat4 lightViewProjection;
+
+void main() {
+    gl_Position = lightViewProjection * model * vec4(positionOrigin + positionExtent * aPos, 1.0);
+}
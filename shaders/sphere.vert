@@ -4,8 +4,14 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+layout (std140) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPos;
+    vec4 depthRange;
+};
 
 out vec3 Normal;
 out vec2 TexCoords;
@@ -13,8 +19,9 @@ out vec3 FragPos;
 
 void main()
 {
-    gl_Position = projection  * view * model * vec4(aPos, 1.0);
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * worldPos;
     Normal = normalize(aPos); // for a sphere, the position is the normal
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    FragPos = worldPos.xyz;
     TexCoords = aTexCoords;
 }
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include <rendersystem/CascadedShadows.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    GLTexture createDepthArray(int resolution, int layers, bool compare) {
+        auto texture = GLTexture::Create();
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture.Get());
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, layers, 0,
+            GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, compare ? GL_LINEAR : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        if (compare) {
+            // hardware depth comparison, sampled through sampler2DArrayShadow
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return texture;
+    }
+}
+
+CascadedShadows::CascadedShadows(const std::string& shaderDir, int cascades, int resolution,
+    float shadowDistance, float splitLambda) :
+    cascadeCount(std::clamp(cascades, 1, MAX_CASCADES)),
+    resolution(resolution),
+    shadowDistance(shadowDistance),
+    splitLambda(splitLambda),
+    depthShader((shaderDir + "shadow_depth.vert").c_str(), (shaderDir + "shadow_depth.frag").c_str())
+{
+    shadowMaps = createDepthArray(resolution, cascadeCount, true);
+    staticMaps = createDepthArray(resolution, cascadeCount, false);
+
+    // depth only targets, the layer is attached when drawing
+    drawFBO = GLFramebuffer::Create();
+    readFBO = GLFramebuffer::Create();
+    for (unsigned int fbo : { drawFBO.Get(), readFBO.Get() }) {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void CascadedShadows::AddCaster(std::shared_ptr<Drawable> caster, bool isStatic) {
+    Caster entry;
+    entry.drawable = caster;
+    entry.isStatic = isStatic;
+    casters.push_back(entry);
+}
+
+void CascadedShadows::Invalidate() {
+    for (int i = 0; i < cascadeCount; i++) {
+        cascades[i].staticDirty = true;
+        cascades[i].dynamicDirty = true;
+    }
+}
+
+void CascadedShadows::fitCascade(int i, Camera& camera, float aspect, float sliceNear, float sliceFar) {
+    auto& cascade = cascades[i];
+
+    // bounding sphere of the frustum slice. it only depends on the projection, so the
+    // cascade keeps its size however the camera turns
+    float tanY = std::tan(glm::radians(camera.Zoom) * 0.5f);
+    float tanX = tanY * aspect;
+    glm::vec3 corners[8];
+    int c = 0;
+    for (float d : { sliceNear, sliceFar }) {
+        for (float sx : { -1.0f, 1.0f }) {
+            for (float sy : { -1.0f, 1.0f }) {
+                corners[c++] = camera.Position + camera.Front * d + camera.Right * (sx * d * tanX) + camera.Up * (sy * d * tanY);
+            }
+        }
+    }
+
+    glm::vec3 center(0.0f);
+    for (auto& corner : corners) center += corner / 8.0f;
+    float radius = 0.0f;
+    for (auto& corner : corners) radius = std::max(radius, glm::length(corner - center));
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    // the sphere is snapped to a grid a quarter of its radius wide (a whole number of
+    // texels), and the cascade is made wide enough to hold it wherever it snaps to.
+    // small camera moves then leave the cascade, and its cached static map, untouched
+    float halfSize = radius * 1.25f;
+    float texel = 2.0f * halfSize / resolution;
+    float step = std::max(1.0f, std::round(radius * 0.25f / texel)) * texel;
+
+    glm::vec3 lightSpace = glm::vec3(lightView * glm::vec4(center, 1.0f));
+    glm::vec2 snapped = glm::floor(glm::vec2(lightSpace) / step + 0.5f) * step;
+
+    // the depth range only covers the sphere, casters in front of it are clamped onto
+    // the near plane (GL_DEPTH_CLAMP) and still cast
+    float nearDepth = -lightSpace.z - radius;
+    float farDepth = -lightSpace.z + radius;
+    nearDepth = std::floor(nearDepth / step) * step;
+    farDepth = std::ceil(farDepth / step) * step;
+
+    glm::mat4 projection = glm::ortho(
+        snapped.x - halfSize, snapped.x + halfSize,
+        snapped.y - halfSize, snapped.y + halfSize,
+        nearDepth, farDepth);
+    glm::mat4 lightViewProjection = projection * lightView;
+
+    if (std::memcmp(&lightViewProjection, &cascade.lightViewProjection, sizeof(glm::mat4)) != 0) {
+        cascade.lightViewProjection = lightViewProjection;
+        cascade.staticDirty = true;
+    }
+    cascade.splitFar = sliceFar;
+    cascade.center = snapped;
+    cascade.halfSize = halfSize;
+    cascade.farDepth = farDepth;
+}
+
+unsigned int CascadedShadows::overlappedCascades(const BoundingSphere& bounds) const {
+    if (bounds.Unbounded()) return (1u << cascadeCount) - 1;
+
+    glm::vec3 p = glm::vec3(lightView * glm::vec4(bounds.center, 1.0f));
+    unsigned int mask = 0;
+    for (int i = 0; i < cascadeCount; i++) {
+        auto& cascade = cascades[i];
+        float reach = cascade.halfSize + bounds.radius;
+        bool inside = std::abs(p.x - cascade.center.x) <= reach &&
+            std::abs(p.y - cascade.center.y) <= reach &&
+            -p.z - bounds.radius <= cascade.farDepth; // anything nearer the light still casts
+        if (inside) mask |= 1u << i;
+    }
+    return mask;
+}
+
+void CascadedShadows::Update(Camera& camera, float aspect, float near, float far, const glm::vec3& lightDirection) {
+    stats = Stats();
+
+    // a fixed light space basis, so only translations of the cascades change their matrices
+    glm::vec3 dir = glm::normalize(lightDirection);
+    glm::vec3 up = std::abs(dir.y) > 0.99f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+    glm::mat4 nextLightView = glm::lookAt(glm::vec3(0.0f), dir, up);
+    if (nextLightView != lightView) {
+        lightView = nextLightView;
+        Invalidate();
+    }
+
+    // practical split scheme: a blend of logarithmic and uniform split depths
+    float distance = std::min(far, shadowDistance);
+    float sliceNear = near;
+    for (int i = 0; i < cascadeCount; i++) {
+        float t = (float)(i + 1) / cascadeCount;
+        float logSplit = near * std::pow(distance / near, t);
+        float uniformSplit = near + (distance - near) * t;
+        float sliceFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+
+        fitCascade(i, camera, aspect, sliceNear, sliceFar);
+        sliceNear = sliceFar;
+    }
+
+    // find what moved and which cascades it touched, before and after the move
+    for (auto& caster : casters) {
+        glm::mat4 transform = caster.drawable->Transform();
+        unsigned int mask = overlappedCascades(caster.drawable->Bounds());
+
+        bool moved = std::memcmp(&transform, &caster.transform, sizeof(glm::mat4)) != 0;
+        unsigned int touched = moved ? (mask | caster.cascadeMask) : 0;
+        for (int i = 0; i < cascadeCount; i++) {
+            if (!(touched & (1u << i))) continue;
+            if (caster.isStatic) cascades[i].staticDirty = true;
+            else cascades[i].dynamicDirty = true;
+        }
+
+        for (int i = 0; i < cascadeCount; i++) {
+            if (mask & (1u << i)) stats.cascades[i].casters++;
+        }
+
+        caster.transform = transform;
+        caster.cascadeMask = mask;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glViewport(0, 0, resolution, resolution);
+
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+
+    for (int i = 0; i < cascadeCount; i++) {
+        auto& cascade = cascades[i];
+        auto& cascadeStats = stats.cascades[i];
+        cascadeStats.splitFar = cascade.splitFar;
+
+        if (!cascade.staticDirty && !cascade.dynamicDirty) {
+            cascadeStats.gpuMilliseconds = cascade.timer.Milliseconds();
+            stats.skipped++;
+            continue;
+        }
+
+        cascade.timer.Begin();
+
+        if (cascade.staticDirty) {
+            glBindFramebuffer(GL_FRAMEBUFFER, drawFBO.Get());
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, staticMaps.Get(), 0, i);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            renderCasters(i, true);
+            cascadeStats.staticRebuilt = true;
+        }
+
+        // restore the static casters, then draw the dynamic ones on top
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO.Get());
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, staticMaps.Get(), 0, i);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO.Get());
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMaps.Get(), 0, i);
+        glBlitFramebuffer(0, 0, resolution, resolution, 0, 0, resolution, resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, drawFBO.Get());
+        renderCasters(i, false);
+
+        cascade.timer.End();
+        cascadeStats.gpuMilliseconds = cascade.timer.Milliseconds();
+        cascadeStats.rendered = true;
+        stats.rendered++;
+
+        cascade.staticDirty = false;
+        cascade.dynamicDirty = false;
+    }
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void CascadedShadows::renderCasters(int cascade, bool staticCasters) {
+    depthShader.use();
+    depthShader.setMat4("lightViewProjection", cascades[cascade].lightViewProjection);
+
+    Mesh::UncountedDraws uncounted;
+    for (auto& caster : casters) {
+        if (caster.isStatic != staticCasters || !(caster.cascadeMask & (1u << cascade))) continue;
+        caster.drawable->Draw(depthShader);
+    }
+}
+
+void CascadedShadows::Bind(const Shader& shader) const {
+    glActiveTexture(GL_TEXTURE0 + SHADOW_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMaps.Get());
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.setInt("shadowMaps", SHADOW_UNIT);
+    shader.setInt("cascadeCount", cascadeCount);
+
+    glm::vec3 splits(0.0f);
+    float lastSplit = 0.0f;
+    for (int i = 0; i < cascadeCount; i++) {
+        shader.setMat4("cascadeMatrices[" + std::to_string(i) + "]", cascades[i].lightViewProjection);
+        if (i < 3) splits[i] = cascades[i].splitFar;
+        lastSplit = cascades[i].splitFar;
+    }
+
+    // the first three split depths, the last one is where shadows end
+    shader.setVec3("cascadeSplits", splits);
+    shader.setFloat("shadowDistance", lastSplit);
+}
@@ -0,0 +1,159 @@
+#include <rendersystem/DeferredRenderer.h>
+
+#include <iostream>
+#include <memory>
+
+namespace {
+    const int ALBEDO_UNIT = 0;
+    const int SPECULAR_UNIT = 1;
+    const int NORMAL_UNIT = 2;
+    const int AMBIENT_UNIT = 3;
+    const int DEPTH_UNIT = 4;
+
+    GLTexture createTarget(GLenum internalFormat, GLenum format, GLenum type, int width, int height) {
+        auto texture = GLTexture::Create();
+        glBindTexture(GL_TEXTURE_2D, texture.Get());
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+}
+
+DeferredRenderer::DeferredRenderer(int width, int height, const std::string& shaderDir, ShaderQueue* queue) :
+    width(width),
+    height(height),
+    geometryVariants(shaderDir + "colors.vert", shaderDir + "gbuffer.frag", queue),
+    shaderDir(shaderDir),
+    queue(queue)
+{
+    // the unshadowed program starts building right away, the shadowed ones on first use
+    lightingShader(false, false);
+
+    emptyVAO = GLVertexArray::Create();
+    createTargets();
+}
+
+void DeferredRenderer::Resize(int width, int height) {
+    if (width == this->width && height == this->height) return;
+
+    this->width = width;
+    this->height = height;
+    createTargets();
+}
+
+ShaderFuture DeferredRenderer::GeometryShader(ShaderFeatures features) {
+    // the G-buffer pass doesn't light anything, so every light set shares one variant
+    features.pointLights = -1;
+    features.directionalLights = -1;
+    features.clustered = false;
+    features.visualiseDepth = false;
+    return geometryVariants.Get(features);
+}
+
+void DeferredRenderer::BeginGeometryPass() {
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO.Get());
+    glViewport(0, 0, width, height);
+
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+const ShaderFuture& DeferredRenderer::lightingShader(bool shadows, bool pointShadows) {
+    auto& program = lightingShaders[(shadows ? 1 : 0) + (pointShadows ? 2 : 0)];
+    if (program.Valid()) return program;
+
+    std::string defines;
+    if (shadows) defines += "#define SHADOWS\n";
+    if (pointShadows) defines += "#define POINT_SHADOWS\n";
+
+    auto vertexPath = shaderDir + "deferred_lighting.vert";
+    auto fragmentPath = shaderDir + "deferred_lighting.frag";
+    if (queue != nullptr) {
+        program = queue->Submit(vertexPath.c_str(), fragmentPath.c_str(), defines);
+    }
+    else {
+        program = ShaderFuture(std::make_shared<Shader>(vertexPath.c_str(), fragmentPath.c_str(), defines));
+    }
+    return program;
+}
+
+bool DeferredRenderer::LightingPass(const LightingSystem& lighting, const LightClusters& clusters,
+    const CascadedShadows* shadows, const PointShadows* pointShadows, unsigned int targetFBO) {
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    auto& program = lightingShader(shadows != nullptr, pointShadows != nullptr);
+    if (!program.Ready()) {
+        return false;
+    }
+
+    const Shader& shader = program.Get();
+    shader.use();
+
+    unsigned int targets[] = { albedo.Get(), specular.Get(), normal.Get(), ambient.Get(), depth.Get() };
+    int units[] = { ALBEDO_UNIT, SPECULAR_UNIT, NORMAL_UNIT, AMBIENT_UNIT, DEPTH_UNIT };
+    for (int i = 0; i < 5; i++) {
+        glActiveTexture(GL_TEXTURE0 + units[i]);
+        glBindTexture(GL_TEXTURE_2D, targets[i]);
+    }
+    shader.setInt("gAlbedo", ALBEDO_UNIT);
+    shader.setInt("gSpecular", SPECULAR_UNIT);
+    shader.setInt("gNormal", NORMAL_UNIT);
+    shader.setInt("gAmbient", AMBIENT_UNIT);
+    shader.setInt("gDepth", DEPTH_UNIT);
+
+    clusters.Bind(shader, lighting, width, height);
+    if (shadows != nullptr) shadows->Bind(shader);
+    if (pointShadows != nullptr) pointShadows->Bind(shader);
+
+    // every pixel is shaded once: no depth test, the background is discarded in the shader
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    glBindVertexArray(emptyVAO.Get());
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    if (depthTest) glEnable(GL_DEPTH_TEST);
+    if (blend) glEnable(GL_BLEND);
+
+    // forward passes drawn afterwards test against the scene's depth
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO.Get());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFBO);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+
+    glActiveTexture(GL_TEXTURE0);
+    return true;
+}
+
+void DeferredRenderer::createTargets() {
+    // assigning over the old targets (after a resize) deletes them
+    FBO = GLFramebuffer::Create();
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO.Get());
+
+    albedo = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+    specular = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+    normal = createTarget(GL_RG16F, GL_RG, GL_FLOAT, width, height);
+    ambient = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+    depth = createTarget(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, width, height);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedo.Get(), 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, specular.Get(), 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, normal.Get(), 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, ambient.Get(), 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth.Get(), 0);
+
+    unsigned int attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
+    glDrawBuffers(4, attachments);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::DEFERRED_RENDERER::GBUFFER_NOT_COMPLETE" << std::endl;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
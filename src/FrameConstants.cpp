@@ -0,0 +1,33 @@
+#include <rendersystem/FrameConstants.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+
+FrameConstants::FrameConstants() : data() {
+    UBO = GLBuffer::Create();
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO.Get());
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstantsData), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, UniformBlocks::FRAME_CONSTANTS, UBO.Get());
+}
+
+void FrameConstants::Update(Camera& camera, float aspect, float near, float far) {
+    FrameConstantsData next;
+    next.view = camera.GetViewMatrix();
+    next.projection = glm::perspective(glm::radians(camera.Zoom), aspect, near, far);
+    next.viewProjection = next.projection * next.view;
+    next.cameraPos = glm::vec4(camera.Position, 1.0f);
+    next.depthRange = glm::vec4(near, far, 0.0f, 0.0f);
+
+    // a still camera doesn't need a new upload
+    if (std::memcmp(&next, &data, sizeof(data)) == 0) {
+        return;
+    }
+
+    data = next;
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO.Get());
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstantsData), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
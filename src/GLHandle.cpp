@@ -0,0 +1,27 @@
+#include <rendersystem/GLHandle.h>
+
+#include <atomic>
+
+namespace {
+    std::atomic<long> live[(int)GLObject::Count];
+}
+
+long GLObjects::Live() {
+    long total = 0;
+    for (auto& count : live) {
+        total += count.load();
+    }
+    return total;
+}
+
+long GLObjects::Live(GLObject kind) {
+    return live[(int)kind].load();
+}
+
+void GLObjects::Created(GLObject kind) {
+    live[(int)kind]++;
+}
+
+void GLObjects::Destroyed(GLObject kind) {
+    live[(int)kind]--;
+}
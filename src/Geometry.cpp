@@ -0,0 +1,310 @@
+#include <rendersystem/Geometry.h>
+#include <rendersystem/MeshOptimizer.h>
+
+#include <assimp/scene.h>
+#include <assimp/mesh.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <unordered_map>
+
+namespace Geometry {
+    MeshData Sphere(float radius, int resolution) {
+        int divsPhi = 10;
+        int divsTheta = 20;
+
+        if (resolution >= 0) {
+            switch (resolution) {
+            case 0:
+                divsPhi = 20;
+                divsTheta = 40;
+                break;
+            case 1:
+                divsPhi = 36;
+                divsTheta = 72;
+                break;
+            default:
+                divsPhi = 90;
+                divsTheta = 180;
+                break;
+            }
+        }
+
+        // sin and cos of every layer and every step around it, once instead of per vertex
+        std::vector<float> sinPhi(divsPhi + 1), cosPhi(divsPhi + 1);
+        for (int l = 0; l <= divsPhi; l++) {
+            float phi = glm::radians(l * (180.0f / divsPhi));
+            sinPhi[l] = std::sin(phi);
+            cosPhi[l] = std::cos(phi);
+        }
+        std::vector<float> sinTheta(divsTheta + 1), cosTheta(divsTheta + 1);
+        for (int t = 0; t <= divsTheta; t++) {
+            float theta = glm::radians(t * (360.0f / divsTheta));
+            sinTheta[t] = std::sin(theta);
+            cosTheta[t] = std::cos(theta);
+        }
+
+        MeshData mesh;
+        mesh.strip = true;
+        mesh.vertices.reserve((size_t)(divsPhi + 1) * (divsTheta + 1));
+        mesh.indices.reserve((size_t)divsPhi * divsTheta * 4);
+
+        float rho = radius;
+        for (int l = 0; l <= divsPhi; l++) { // layer (starting at 0 at the bottom and 180/d at the top)
+            // round sin(phi)
+            for (int t = 0; t <= divsTheta; t++) {
+                auto dir = glm::vec3(sinPhi[l] * cosTheta[t], sinPhi[l] * sinTheta[t], cosPhi[l]);
+                auto pos = rho * dir;
+
+                // the texture wraps around y, not the layers' axis, so it has no table
+                auto d = -dir;
+                auto u = 0.5 + std::atan2(d.x, d.z) / (2 * 3.14159);
+                auto v = 0.5 - std::asin(d.y) / 3.14159;
+                mesh.vertices.emplace_back(pos, pos, glm::vec2(u, v));
+
+                if (l == 0 || t == divsTheta) continue;
+
+                // using triangle strip, so draw them in 'N', counter-clockwise from outside
+                unsigned int base = l * (divsTheta + 1);
+                mesh.indices.insert(mesh.indices.end(), {
+                    base + t - divsTheta,
+                    base + t,
+                    base + t - divsTheta + 1,
+                    base + t + 1
+                });
+            }
+        }
+
+        return mesh;
+    }
+
+    MeshData Icosphere(float radius, int subdivisions) {
+        // the icosahedron: three golden rectangles
+        const float g = (1.0f + std::sqrt(5.0f)) * 0.5f;
+        std::vector<glm::vec3> directions = {
+            { -1, g, 0 }, { 1, g, 0 }, { -1, -g, 0 }, { 1, -g, 0 },
+            { 0, -1, g }, { 0, 1, g }, { 0, -1, -g }, { 0, 1, -g },
+            { g, 0, -1 }, { g, 0, 1 }, { -g, 0, -1 }, { -g, 0, 1 } };
+        std::vector<unsigned int> faces = {
+            0, 11, 5,  0, 5, 1,  0, 1, 7,  0, 7, 10,  0, 10, 11,
+            1, 5, 9,  5, 11, 4,  11, 10, 2,  10, 7, 6,  7, 1, 8,
+            3, 9, 4,  3, 4, 2,  3, 2, 6,  3, 6, 8,  3, 8, 9,
+            4, 9, 5,  2, 4, 11,  6, 2, 10,  8, 6, 7,  9, 8, 1 };
+        for (auto& d : directions) {
+            d = glm::normalize(d);
+        }
+
+        // every subdivision splits each triangle in four, the midpoints pushed out onto
+        // the sphere. an edge's midpoint is shared by the triangles on both sides
+        subdivisions = std::max(subdivisions, 0);
+        size_t finalVertices = 10 * ((size_t)1 << (2 * subdivisions)) + 2;
+        directions.reserve(finalVertices);
+        std::unordered_map<uint64_t, unsigned int> midpoints;
+        std::vector<unsigned int> split;
+        for (int s = 0; s < subdivisions; s++) {
+            midpoints.clear();
+            midpoints.reserve(faces.size() / 2 * 3);
+            auto midpoint = [&](unsigned int a, unsigned int b) {
+                uint64_t key = (uint64_t)std::min(a, b) << 32 | std::max(a, b);
+                auto found = midpoints.find(key);
+                if (found != midpoints.end()) return found->second;
+                directions.push_back(glm::normalize(directions[a] + directions[b]));
+                auto index = (unsigned int)directions.size() - 1;
+                midpoints.emplace(key, index);
+                return index;
+            };
+
+            split.clear();
+            split.reserve(faces.size() * 4);
+            for (size_t i = 0; i < faces.size(); i += 3) {
+                unsigned int a = faces[i], b = faces[i + 1], c = faces[i + 2];
+                unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+                split.insert(split.end(), { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca });
+            }
+            faces.swap(split);
+        }
+
+        // the same texture mapping as Sphere()
+        auto texCoords = [](const glm::vec3& dir) {
+            auto d = -dir;
+            return glm::vec2(0.5f + std::atan2(d.x, d.z) / (2.0f * 3.14159f), 0.5f - std::asin(d.y) / 3.14159f);
+        };
+
+        MeshData mesh;
+        mesh.vertices.reserve(finalVertices + finalVertices / 16);
+        mesh.indices.reserve(faces.size());
+        for (auto& d : directions) {
+            mesh.vertices.emplace_back(d * radius, d, texCoords(d));
+        }
+
+        // triangles across the texture's seam get copies of the vertices on its low side
+        // a whole turn on. u is undefined at the poles (the midpoints of the two edges
+        // along x), so they get a copy per triangle with the u of the other two corners
+        std::unordered_map<unsigned int, unsigned int> wrapped;
+        for (size_t i = 0; i < faces.size(); i += 3) {
+            unsigned int corners[3] = { faces[i], faces[i + 1], faces[i + 2] };
+            bool pole[3];
+            float lo = 1.0f, hi = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                auto& d = directions[corners[k]];
+                pole[k] = std::abs(d.x) < 1e-6f && std::abs(d.z) < 1e-6f;
+                if (pole[k]) continue;
+                lo = std::min(lo, mesh.vertices[corners[k]].TexCoords.x);
+                hi = std::max(hi, mesh.vertices[corners[k]].TexCoords.x);
+            }
+
+            if (hi - lo > 0.5f) {
+                for (int k = 0; k < 3; k++) {
+                    if (pole[k] || mesh.vertices[corners[k]].TexCoords.x >= 0.5f) continue;
+                    auto found = wrapped.find(corners[k]);
+                    if (found == wrapped.end()) {
+                        Vertex copy = mesh.vertices[corners[k]];
+                        copy.TexCoords.x += 1.0f;
+                        mesh.vertices.push_back(copy);
+                        found = wrapped.emplace(corners[k], (unsigned int)mesh.vertices.size() - 1).first;
+                    }
+                    corners[k] = found->second;
+                }
+            }
+
+            for (int k = 0; k < 3; k++) {
+                if (!pole[k]) continue;
+                float u = 0.0f;
+                for (int j = 0; j < 3; j++) {
+                    if (j != k) u += mesh.vertices[corners[j]].TexCoords.x * 0.5f;
+                }
+                Vertex copy = mesh.vertices[corners[k]];
+                copy.TexCoords.x = u;
+                mesh.vertices.push_back(copy);
+                corners[k] = (unsigned int)mesh.vertices.size() - 1;
+            }
+
+            mesh.indices.insert(mesh.indices.end(), { corners[0], corners[1], corners[2] });
+        }
+
+        return mesh;
+    }
+
+    MeshData Cuboid(float length, float height, float depth) {
+        // the unit cube, scaled. scaling along the axes leaves the face normals alone
+        MeshData mesh;
+        glm::vec3 size(length, height, depth);
+        mesh.vertices.reserve(UnitCube.vertices.size());
+        for (auto& v : UnitCube.vertices) {
+            mesh.vertices.emplace_back(glm::vec3(v.position[0], v.position[1], v.position[2]) * size,
+                glm::vec3(v.normal[0], v.normal[1], v.normal[2]),
+                glm::vec2(v.texCoords[0], v.texCoords[1]));
+        }
+        mesh.indices.assign(UnitCube.indices.begin(), UnitCube.indices.end());
+        return mesh;
+    }
+
+    MeshData Quad(float length, float height) {
+        MeshData mesh;
+        glm::vec3 size(length, height, 1.0f);
+        mesh.vertices.reserve(UnitQuad.vertices.size());
+        for (auto& v : UnitQuad.vertices) {
+            mesh.vertices.emplace_back(glm::vec3(v.position[0], v.position[1], v.position[2]) * size,
+                glm::vec3(v.normal[0], v.normal[1], v.normal[2]),
+                glm::vec2(v.texCoords[0], v.texCoords[1]));
+        }
+        mesh.indices.assign(UnitQuad.indices.begin(), UnitQuad.indices.end());
+        return mesh;
+    }
+
+    MeshData FromAssimp(const aiMesh* mesh) {
+        MeshData data;
+        if (!mesh->HasNormals() || !mesh->HasPositions() || !mesh->HasTextureCoords(0)) {
+            std::cout << "Cannot Load Model, missing one of normals/positions/texturecoords" << std::endl;
+            return data;
+        }
+
+        auto aiVec3ToGlm = [](const aiVector3t<float>& in) {
+            return glm::vec3(in.x, in.y, in.z);
+        };
+
+        // get vertices
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+            Vertex v;
+
+            v.Position = aiVec3ToGlm(mesh->mVertices[i]);
+            v.Normal = aiVec3ToGlm(mesh->mNormals[i]);
+            v.TexCoords.x = mesh->mTextureCoords[0][i].x;
+            v.TexCoords.y = mesh->mTextureCoords[0][i].y;
+
+            data.vertices.push_back(v);
+        }
+
+        // set indices (note: guaranteed triangles due to aiProcess_Triangulate)
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+        {
+            const aiFace& face = mesh->mFaces[i];
+            for (unsigned int j = 0; j < face.mNumIndices; j++)
+            {
+                data.indices.push_back(face.mIndices[j]);
+            }
+        }
+
+        return data;
+    }
+
+    std::vector<MeshData> LoadModel(const std::string& path) {
+        std::vector<MeshData> meshes;
+
+        Assimp::Importer importer;
+        const auto scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+            std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+            return meshes;
+        }
+
+        // same traversal as Model::processNode, so mesh i here is mesh i there
+        std::function<void(const aiNode*)> processNode = [&](const aiNode* node) {
+            for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+                meshes.push_back(FromAssimp(scene->mMeshes[node->mMeshes[i]]));
+                MeshOptimizer::Optimize(meshes.back());
+            }
+            for (unsigned int i = 0; i < node->mNumChildren; i++) {
+                processNode(node->mChildren[i]);
+            }
+        };
+        processNode(scene->mRootNode);
+
+        return meshes;
+    }
+
+    std::vector<unsigned int> Triangles(const MeshData& mesh) {
+        std::vector<unsigned int> triangles;
+        if (!mesh.strip) {
+            triangles.reserve(mesh.indices.size());
+        }
+
+        auto push = [&](unsigned int a, unsigned int b, unsigned int c) {
+            if (a == b || b == c || a == c) return;
+            if (mesh.vertices[a].Position == mesh.vertices[b].Position ||
+                mesh.vertices[b].Position == mesh.vertices[c].Position ||
+                mesh.vertices[a].Position == mesh.vertices[c].Position) return;
+            triangles.insert(triangles.end(), { a, b, c });
+        };
+
+        if (mesh.strip) {
+            // every other strip triangle is wound the other way round
+            for (size_t i = 2; i < mesh.indices.size(); i++) {
+                if (i % 2 == 0) push(mesh.indices[i - 2], mesh.indices[i - 1], mesh.indices[i]);
+                else push(mesh.indices[i - 1], mesh.indices[i - 2], mesh.indices[i]);
+            }
+        }
+        else {
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                push(mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]);
+            }
+        }
+
+        return triangles;
+    }
+}
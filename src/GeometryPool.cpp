@@ -0,0 +1,320 @@
+#include <rendersystem/GeometryPool.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+GeometryPool::Allocation::~Allocation() {
+    Reset();
+}
+
+GeometryPool::Allocation::Allocation(Allocation&& other) noexcept :
+    pool(std::exchange(other.pool, nullptr)),
+    id(other.id) {}
+
+GeometryPool::Allocation& GeometryPool::Allocation::operator=(Allocation&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        pool = std::exchange(other.pool, nullptr);
+        id = other.id;
+    }
+    return *this;
+}
+
+void GeometryPool::Allocation::Reset() {
+    if (pool != nullptr) {
+        pool->free(id);
+        pool = nullptr;
+    }
+}
+
+namespace {
+    // owned by Shared() and Shutdown(), not by static destruction, which would run
+    // after the context is gone
+    GeometryPool* sharedPool = nullptr;
+    GeometryPool* sharedNarrowPool = nullptr;
+}
+
+GeometryPool& GeometryPool::Shared(GLenum indexType) {
+    if (indexType == GL_UNSIGNED_SHORT) {
+        if (sharedNarrowPool == nullptr) {
+            sharedNarrowPool = new GeometryPool(1 << 16, 1 << 18, GL_UNSIGNED_SHORT);
+        }
+        return *sharedNarrowPool;
+    }
+    if (sharedPool == nullptr) {
+        sharedPool = new GeometryPool();
+    }
+    return *sharedPool;
+}
+
+void GeometryPool::Shutdown() {
+    for (auto pool : { &sharedPool, &sharedNarrowPool }) {
+        if (*pool == nullptr) continue;
+
+        auto allocations = (*pool)->GetStats().allocations;
+        if (allocations != 0) {
+            std::cout << "ERROR::GEOMETRY_POOL::SHUTDOWN_WITH_LIVE_RANGES " << allocations << std::endl;
+            continue;
+        }
+        delete *pool;
+        *pool = nullptr;
+    }
+}
+
+GeometryPool::GeometryPool(uint32_t vertexCapacity, uint32_t indexCapacity, GLenum indexType) :
+    vertexSpace(vertexCapacity),
+    indexSpace(indexCapacity),
+    indexType(indexType)
+{
+    vao = GLVertexArray::Create();
+    vbo = GLBuffer::Create();
+    ebo = GLBuffer::Create();
+
+    // uploads go through the copy targets so the element binding of whatever VAO is
+    // bound doesn't change
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo.Get());
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)vertexCapacity * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo.Get());
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(indexCapacity * IndexSize()), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    setupVertexArray();
+}
+
+void GeometryPool::setupVertexArray() {
+    glBindVertexArray(vao.Get());
+    glBindBuffer(GL_ARRAY_BUFFER, vbo.Get());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo.Get());
+
+    // the Vertex layout, as Mesh used to set up per mesh
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void GeometryPool::reserve(uint32_t vertices, uint32_t indices) {
+    if (vertexSpace.LargestFree() >= vertices && indexSpace.LargestFree() >= indices) return;
+
+    // enough room in total, only scattered: compacting is cheaper than growing for good
+    bool fits = vertexSpace.Capacity() - vertexSpace.Used() >= vertices &&
+        indexSpace.Capacity() - indexSpace.Used() >= indices;
+    if (fits) {
+        Defragment();
+        return;
+    }
+
+    uint32_t vertexCapacity = vertexSpace.Capacity();
+    if (vertexSpace.LargestFree() < vertices) {
+        vertexCapacity = std::max(vertexCapacity * 2, vertexSpace.Used() + vertices);
+    }
+    uint32_t indexCapacity = indexSpace.Capacity();
+    if (indexSpace.LargestFree() < indices) {
+        indexCapacity = std::max(indexCapacity * 2, indexSpace.Used() + indices);
+    }
+    grow(vertexCapacity, indexCapacity);
+
+    // growing only adds space at the end, which may still not be enough past a used tail
+    if (vertexSpace.LargestFree() < vertices || indexSpace.LargestFree() < indices) {
+        Defragment();
+    }
+}
+
+void GeometryPool::grow(uint32_t vertexCapacity, uint32_t indexCapacity) {
+    auto copy = [](GLBuffer& buffer, GLsizeiptr oldBytes, GLsizeiptr newBytes) {
+        auto bigger = GLBuffer::Create();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, bigger.Get());
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer.Get());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+        buffer = std::move(bigger);
+    };
+
+    if (vertexCapacity > vertexSpace.Capacity()) {
+        copy(vbo, (GLsizeiptr)vertexSpace.Capacity() * sizeof(Vertex), (GLsizeiptr)vertexCapacity * sizeof(Vertex));
+        vertexSpace.Grow(vertexCapacity);
+    }
+    if (indexCapacity > indexSpace.Capacity()) {
+        copy(ebo, (GLsizeiptr)(indexSpace.Capacity() * IndexSize()), (GLsizeiptr)(indexCapacity * IndexSize()));
+        indexSpace.Grow(indexCapacity);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    setupVertexArray();
+    growths++;
+}
+
+void GeometryPool::Defragment() {
+    auto packedVbo = GLBuffer::Create();
+    auto packedEbo = GLBuffer::Create();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, packedVbo.Get());
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)vertexSpace.Capacity() * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+
+    // ranges keep their order, so neighbours in memory stay neighbours
+    std::vector<uint32_t> order;
+    for (uint32_t id = 0; id < ranges.size(); id++) {
+        if (live[id]) order.push_back(id);
+    }
+
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return ranges[a].baseVertex < ranges[b].baseVertex;
+    });
+    glBindBuffer(GL_COPY_READ_BUFFER, vbo.Get());
+    uint32_t vertexEnd = 0;
+    for (auto id : order) {
+        auto& range = ranges[id];
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            (GLintptr)range.baseVertex * sizeof(Vertex), (GLintptr)vertexEnd * sizeof(Vertex),
+            (GLsizeiptr)range.vertexCount * sizeof(Vertex));
+        range.baseVertex = vertexEnd;
+        vertexEnd += range.vertexCount;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, packedEbo.Get());
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(indexSpace.Capacity() * IndexSize()), nullptr, GL_STATIC_DRAW);
+
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return ranges[a].firstIndex < ranges[b].firstIndex;
+    });
+    glBindBuffer(GL_COPY_READ_BUFFER, ebo.Get());
+    uint32_t indexEnd = 0;
+    for (auto id : order) {
+        auto& range = ranges[id];
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            (GLintptr)(range.firstIndex * IndexSize()), (GLintptr)(indexEnd * IndexSize()),
+            (GLsizeiptr)(range.indexCount * IndexSize()));
+        range.firstIndex = indexEnd;
+        indexEnd += range.indexCount;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    vbo = std::move(packedVbo);
+    ebo = std::move(packedEbo);
+    vertexSpace.Reset(vertexSpace.Capacity(), vertexEnd);
+    indexSpace.Reset(indexSpace.Capacity(), indexEnd);
+
+    setupVertexArray();
+    defragmentations++;
+}
+
+GeometryPool::Allocation GeometryPool::Allocate(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+    if (vertices.empty() || indices.empty()) {
+        return Allocation();
+    }
+
+    const void* indexData = indices.data();
+    if (indexType == GL_UNSIGNED_SHORT) {
+        if (vertices.size() > 0xffff + 1) {
+            std::cout << "ERROR::GEOMETRY_POOL::INDEX_RANGE " << vertices.size() << " vertices" << std::endl;
+            return Allocation();
+        }
+        narrowed.assign(indices.begin(), indices.end());
+        indexData = narrowed.data();
+    }
+
+    reserve((uint32_t)vertices.size(), (uint32_t)indices.size());
+
+    Range range;
+    range.vertexCount = (uint32_t)vertices.size();
+    range.indexCount = (uint32_t)indices.size();
+    range.baseVertex = vertexSpace.Allocate(range.vertexCount);
+    range.firstIndex = indexSpace.Allocate(range.indexCount);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo.Get());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)range.baseVertex * sizeof(Vertex),
+        (GLsizeiptr)vertices.size() * sizeof(Vertex), vertices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo.Get());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(range.firstIndex * IndexSize()),
+        (GLsizeiptr)(indices.size() * IndexSize()), indexData);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    uint32_t id;
+    if (!freeIds.empty()) {
+        id = freeIds.back();
+        freeIds.pop_back();
+        ranges[id] = range;
+        live[id] = true;
+    }
+    else {
+        id = (uint32_t)ranges.size();
+        ranges.push_back(range);
+        live.push_back(true);
+    }
+    return Allocation(this, id);
+}
+
+void GeometryPool::free(uint32_t id) {
+    auto& range = ranges[id];
+    vertexSpace.Free(range.baseVertex, range.vertexCount);
+    indexSpace.Free(range.firstIndex, range.indexCount);
+    live[id] = false;
+    freeIds.push_back(id);
+}
+
+void GeometryPool::Draw(const Allocation& allocation, GLenum mode) const {
+    auto& range = allocation.Get();
+    glBindVertexArray(vao.Get());
+    glDrawElementsBaseVertex(mode, range.indexCount, indexType,
+        (void*)(range.firstIndex * IndexSize()), (GLint)range.baseVertex);
+    glBindVertexArray(0);
+}
+
+void GeometryPool::MultiDraw(const std::vector<const Allocation*>& allocations, GLenum mode) {
+    drawCounts.clear();
+    drawOffsets.clear();
+    drawBaseVertices.clear();
+    for (auto allocation : allocations) {
+        auto& range = allocation->Get();
+        drawCounts.push_back((GLsizei)range.indexCount);
+        drawOffsets.push_back((const void*)(range.firstIndex * IndexSize()));
+        drawBaseVertices.push_back((GLint)range.baseVertex);
+    }
+
+    glBindVertexArray(vao.Get());
+    glMultiDrawElementsBaseVertex(mode, drawCounts.data(), indexType,
+        drawOffsets.data(), (GLsizei)drawCounts.size(), drawBaseVertices.data());
+    glBindVertexArray(0);
+}
+
+void GeometryPool::MultiDraw(const std::vector<SubRange>& ranges, GLenum mode) {
+    drawCounts.clear();
+    drawOffsets.clear();
+    drawBaseVertices.clear();
+    for (auto& sub : ranges) {
+        auto& range = sub.allocation->Get();
+        drawCounts.push_back((GLsizei)sub.indexCount);
+        drawOffsets.push_back((const void*)((range.firstIndex + sub.firstIndex) * IndexSize()));
+        drawBaseVertices.push_back((GLint)range.baseVertex);
+    }
+
+    glBindVertexArray(vao.Get());
+    glMultiDrawElementsBaseVertex(mode, drawCounts.data(), indexType,
+        drawOffsets.data(), (GLsizei)drawCounts.size(), drawBaseVertices.data());
+    glBindVertexArray(0);
+}
+
+GeometryPool::Stats GeometryPool::GetStats() const {
+    Stats stats;
+    stats.allocations = (unsigned int)(ranges.size() - freeIds.size());
+    stats.vertexCapacity = vertexSpace.Capacity();
+    stats.vertexUsed = vertexSpace.Used();
+    stats.vertexFreeBlocks = vertexSpace.FreeBlocks();
+    stats.vertexFragmentation = vertexSpace.Fragmentation();
+    stats.indexCapacity = indexSpace.Capacity();
+    stats.indexUsed = indexSpace.Used();
+    stats.indexFreeBlocks = indexSpace.FreeBlocks();
+    stats.indexFragmentation = indexSpace.Fragmentation();
+    stats.growths = growths;
+    stats.defragmentations = defragmentations;
+    return stats;
+}
@@ -0,0 +1,44 @@
+#include <rendersystem/GpuTimer.h>
+
+GpuTimer::GpuTimer() {
+    for (auto& query : queries) {
+        query = GLQuery::Create();
+    }
+}
+
+void GpuTimer::Begin() {
+    // every query is in flight: the oldest one has to finish before it can be reused
+    if (outstanding == QUERY_COUNT) {
+        collect(true);
+    }
+    glBeginQuery(GL_TIME_ELAPSED, queries[next].Get());
+}
+
+void GpuTimer::End() {
+    glEndQuery(GL_TIME_ELAPSED);
+    next = (next + 1) % QUERY_COUNT;
+    outstanding++;
+}
+
+double GpuTimer::Milliseconds() {
+    collect(false);
+    return last;
+}
+
+void GpuTimer::collect(bool block) {
+    while (outstanding > 0) {
+        unsigned int query = queries[(next - outstanding + QUERY_COUNT) % QUERY_COUNT].Get();
+
+        if (!block) {
+            GLint available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) return;
+        }
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+        last = nanoseconds / 1.0e6;
+        outstanding--;
+        block = false;
+    }
+}
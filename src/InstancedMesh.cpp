@@ -0,0 +1,194 @@
+#include <rendersystem/InstancedMesh.h>
+#include <rendersystem/Utils.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+InstancedMesh::InstancedMesh(std::shared_ptr<const MeshGeometry> geometry) :
+    geometry(std::move(geometry))
+{
+    VAO = GLVertexArray::Create();
+    instanceVBO = GLBuffer::Create();
+    setupVertexArray();
+}
+
+InstancedMesh::InstancedMesh(MeshData data) :
+    InstancedMesh(std::make_shared<MeshGeometry>(std::move(data.vertices), std::move(data.indices),
+        data.strip ? GL_TRIANGLE_STRIP : GL_TRIANGLES)) {}
+
+InstancedMesh::InstanceData InstancedMesh::Pack(const glm::vec3& position,
+    float scale,
+    const glm::quat& rotation,
+    const glm::vec3& color,
+    int layer)
+{
+    InstanceData instance;
+    instance.positionScale = glm::vec4(position, scale);
+    instance.rotation = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+    instance.colorLayer = glm::vec4(color, (float)layer);
+    return instance;
+}
+
+size_t InstancedMesh::Add(const InstanceData& instance) {
+    instances.push_back(instance);
+    MarkDirty(instances.size() - 1, 1);
+    return instances.size() - 1;
+}
+
+void InstancedMesh::Set(size_t index, const InstanceData& instance) {
+    instances[index] = instance;
+    MarkDirty(index, 1);
+}
+
+void InstancedMesh::Resize(size_t count) {
+    size_t old = instances.size();
+    instances.resize(count);
+    if (count > old) {
+        MarkDirty(old, count - old);
+    }
+    boundsDirty = true;
+}
+
+void InstancedMesh::MarkDirty(size_t first, size_t count) {
+    if (count == 0) return;
+    boundsDirty = true;
+
+    // extend the last range when writes come in order, the common case
+    size_t last = first + count;
+    if (!dirty.empty() && first <= dirty.back().second + MERGE_GAP && last + MERGE_GAP >= dirty.back().first) {
+        dirty.back().first = std::min(dirty.back().first, first);
+        dirty.back().second = std::max(dirty.back().second, last);
+        return;
+    }
+    dirty.push_back({ first, last });
+
+    // scattered writes: past a point one range over all of them is cheaper to track
+    if (dirty.size() > MAX_DIRTY_RANGES) {
+        size_t lo = first, hi = last;
+        for (auto& range : dirty) {
+            lo = std::min(lo, range.first);
+            hi = std::max(hi, range.second);
+        }
+        dirty.assign(1, { lo, hi });
+    }
+}
+
+bool InstancedMesh::SetTextures(const std::vector<std::string>& paths) {
+    diffuseArray = GLTexture(Utils::TextureArrayFromFiles(paths));
+    return (bool)diffuseArray;
+}
+
+void InstancedMesh::setupVertexArray() {
+    poolGeneration = geometry->allocation ? geometry->allocation.Pool()->Generation() : 0;
+
+    unsigned int vbo = geometry->allocation ? geometry->allocation.Pool()->VertexBuffer() : geometry->VBO.Get();
+    unsigned int ebo = geometry->allocation ? geometry->allocation.Pool()->IndexBuffer() : geometry->EBO.Get();
+
+    glBindVertexArray(VAO.Get());
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+    MeshGeometry::SetupAttributes(geometry->encoding);
+
+    // one step per instance
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO.Get());
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, positionScale));
+    glVertexAttribDivisor(4, 1);
+    glEnableVertexAttribArray(5);
+    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, rotation));
+    glVertexAttribDivisor(5, 1);
+    glEnableVertexAttribArray(6);
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, colorLayer));
+    glVertexAttribDivisor(6, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void InstancedMesh::upload() {
+    lastUpload = UploadStats();
+    if (dirty.empty()) return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO.Get());
+    if (instances.size() > instanceCapacity) {
+        // a new store needs everything, not just the dirty part
+        instanceCapacity = std::max<size_t>(1024, instances.size() * 3 / 2);
+        glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+        dirty.assign(1, { 0, instances.size() });
+    }
+
+    std::sort(dirty.begin(), dirty.end());
+    size_t uploadedTo = 0;
+    for (auto& range : dirty) {
+        size_t first = std::max(range.first, uploadedTo);
+        size_t last = std::min(range.second, instances.size());
+        if (first >= last) continue;
+
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(InstanceData), (last - first) * sizeof(InstanceData), instances.data() + first);
+        uploadedTo = last;
+        lastUpload.instances += (unsigned int)(last - first);
+        lastUpload.bytes += (unsigned int)((last - first) * sizeof(InstanceData));
+        lastUpload.ranges++;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    dirty.clear();
+}
+
+BoundingSphere InstancedMesh::Bounds() {
+    if (!boundsDirty) return bounds;
+    boundsDirty = false;
+
+    if (instances.empty()) {
+        bounds = BoundingSphere(glm::vec3(0.0f), 0.0f);
+        return bounds;
+    }
+
+    // a box around the instance centers, padded by the largest scaled mesh radius
+    glm::vec3 lo(std::numeric_limits<float>::max());
+    glm::vec3 hi(-std::numeric_limits<float>::max());
+    float maxScale = 0.0f;
+    for (auto& instance : instances) {
+        glm::vec3 p(instance.positionScale);
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+        maxScale = std::max(maxScale, std::abs(instance.positionScale.w));
+    }
+
+    auto& local = geometry->localBounds;
+    bounds = BoundingSphere((lo + hi) * 0.5f,
+        glm::length(hi - lo) * 0.5f + (glm::length(local.center) + local.radius) * maxScale);
+    return bounds;
+}
+
+void InstancedMesh::Draw(const Shader& shader) {
+    if (instances.empty() || geometry->indices.empty()) return;
+
+    upload();
+    if (geometry->allocation && geometry->allocation.Pool()->Generation() != poolGeneration) {
+        setupVertexArray();
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, diffuseArray.Get());
+    shader.setInt("material.texture_diffuse_array", 0);
+    geometry->BindDecode(shader);
+    size_t triangles = geometry->Triangles() * instances.size();
+    Mesh::CountTriangles(triangles, triangles);
+
+    GLint baseVertex = 0;
+    size_t indexOffset = 0;
+    if (geometry->allocation) {
+        auto& range = geometry->allocation.Get();
+        baseVertex = (GLint)range.baseVertex;
+        indexOffset = range.firstIndex * geometry->allocation.Pool()->IndexSize();
+    }
+
+    glBindVertexArray(VAO.Get());
+    glDrawElementsInstancedBaseVertex(geometry->drawMode, (GLsizei)geometry->indices.size(), geometry->indexType,
+        (void*)indexOffset, (GLsizei)instances.size(), baseVertex);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,339 @@
+#include <rendersystem/LightClusters.h>
+#include <rendersystem/Parallel.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+    // a light in view space, with the conservative range of clusters it can touch
+    struct ClusterLight {
+        glm::vec3 center;
+        float radius;
+        int slice0, slice1;
+        int tileX0, tileX1;
+        int tileY0, tileY1;
+        bool visible;
+    };
+
+    bool sphereIntersectsBox(const glm::vec3& center, float radius, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+        glm::vec3 closest = glm::clamp(center, boxMin, boxMax);
+        glm::vec3 d = center - closest;
+        return glm::dot(d, d) <= radius * radius;
+    }
+}
+
+LightClusters::LightClusters(int tilesX, int tilesY, int slices) :
+    tilesX(tilesX),
+    tilesY(tilesY),
+    slices(slices)
+{
+    ranges.resize(ClusterCount());
+    scratch.resize(slices);
+
+    rangesTBO = GLBuffer::Create();
+    glBindBuffer(GL_TEXTURE_BUFFER, rangesTBO.Get());
+    glBufferData(GL_TEXTURE_BUFFER, ranges.size() * sizeof(glm::uvec2), nullptr, GL_STREAM_DRAW);
+
+    rangesTexture = GLTexture::Create();
+    glBindTexture(GL_TEXTURE_BUFFER, rangesTexture.Get());
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, rangesTBO.Get());
+
+    indicesTBO = GLBuffer::Create();
+    indicesTexture = GLTexture::Create();
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+float LightClusters::sliceDepth(int slice) const {
+    return near * std::pow(far / near, (float)slice / (float)slices);
+}
+
+void LightClusters::setProjection(float fovY, float aspect, float near, float far) {
+    if (fovY != this->fovY || aspect != this->aspect || near != this->near || far != this->far) {
+        this->fovY = fovY;
+        this->aspect = aspect;
+        this->near = near;
+        this->far = far;
+        computeClusterBounds();
+    }
+}
+
+void LightClusters::computeClusterBounds() {
+    clusterMin.resize(ClusterCount());
+    clusterMax.resize(ClusterCount());
+
+    float tanY = std::tan(fovY * 0.5f);
+    float tanX = tanY * aspect;
+
+    for (int z = 0; z < slices; z++) {
+        float d0 = sliceDepth(z);
+        float d1 = sliceDepth(z + 1);
+
+        for (int y = 0; y < tilesY; y++) {
+            float ny0 = -1.0f + 2.0f * y / tilesY;
+            float ny1 = -1.0f + 2.0f * (y + 1) / tilesY;
+
+            for (int x = 0; x < tilesX; x++) {
+                float nx0 = -1.0f + 2.0f * x / tilesX;
+                float nx1 = -1.0f + 2.0f * (x + 1) / tilesX;
+
+                // the cluster is a frustum section, bound its 8 corners
+                glm::vec3 lo(std::numeric_limits<float>::max());
+                glm::vec3 hi(-std::numeric_limits<float>::max());
+                for (float d : { d0, d1 }) {
+                    for (float nx : { nx0, nx1 }) {
+                        for (float ny : { ny0, ny1 }) {
+                            glm::vec3 corner(nx * d * tanX, ny * d * tanY, -d);
+                            lo = glm::min(lo, corner);
+                            hi = glm::max(hi, corner);
+                        }
+                    }
+                }
+
+                int cluster = (z * tilesY + y) * tilesX + x;
+                clusterMin[cluster] = lo;
+                clusterMax[cluster] = hi;
+            }
+        }
+    }
+}
+
+void LightClusters::Build(const std::vector<PointLight>& lights,
+    const glm::mat4& view,
+    float fovY, float aspect, float near, float far,
+    float threshold)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    setProjection(fovY, aspect, near, far);
+    lightDataTexture = 0;
+
+    float tanY = std::tan(fovY * 0.5f);
+    float tanX = tanY * aspect;
+    float logRatio = std::log(far / near);
+
+    auto sliceOf = [&](float depth) {
+        int s = (int)std::floor(std::log(depth / near) / logRatio * slices);
+        return std::clamp(s, 0, slices - 1);
+    };
+
+    auto tileOf = [](float ndc, int tiles) {
+        int t = (int)std::floor((ndc * 0.5f + 0.5f) * tiles);
+        return std::clamp(t, 0, tiles - 1);
+    };
+
+    // 1. move every light to view space and find the clusters it could touch
+    std::vector<ClusterLight> culled(lights.size());
+    Parallel::For(0, (int)lights.size(), [&](int i) {
+        auto& out = culled[i];
+        out.center = glm::vec3(view * glm::vec4(lights[i].GetPosition(), 1.0f));
+        out.radius = lights[i].Range(threshold);
+
+        float dMin = -out.center.z - out.radius;
+        float dMax = -out.center.z + out.radius;
+        out.visible = out.radius > 0.0f && dMax >= near && dMin <= far;
+        if (!out.visible) return;
+
+        out.slice0 = sliceOf(std::max(dMin, near));
+        out.slice1 = sliceOf(std::min(dMax, far));
+
+        // conservative screen bounds of the sphere's box over its depth range: a
+        // coordinate's projection is extreme at the nearest or farthest depth
+        float dNear = std::max(dMin, near);
+        float dFar = std::max(dMax, dNear);
+        auto ndcRange = [&](float lo, float hi, float tanHalf, int tiles, int& t0, int& t1) {
+            float ndcLo = lo >= 0.0f ? lo / (dFar * tanHalf) : lo / (dNear * tanHalf);
+            float ndcHi = hi >= 0.0f ? hi / (dNear * tanHalf) : hi / (dFar * tanHalf);
+            t0 = tileOf(std::max(ndcLo, -1.0f), tiles);
+            t1 = tileOf(std::min(ndcHi, 1.0f), tiles);
+            return ndcHi >= -1.0f && ndcLo <= 1.0f;
+        };
+
+        out.visible =
+            ndcRange(out.center.x - out.radius, out.center.x + out.radius, tanX, tilesX, out.tileX0, out.tileX1) &&
+            ndcRange(out.center.y - out.radius, out.center.y + out.radius, tanY, tilesY, out.tileY0, out.tileY1);
+    }, 64);
+
+    // 2. cull the lights slice by slice, each slice builds its own sorted list
+    int tilesPerSlice = tilesX * tilesY;
+    Parallel::For(0, slices, [&](int z) {
+        auto& slice = scratch[z];
+        slice.pairs.clear();
+        slice.counts.assign(tilesPerSlice, 0);
+
+        for (size_t i = 0; i < culled.size(); i++) {
+            auto& light = culled[i];
+            if (!light.visible || z < light.slice0 || z > light.slice1) continue;
+
+            for (int y = light.tileY0; y <= light.tileY1; y++) {
+                for (int x = light.tileX0; x <= light.tileX1; x++) {
+                    int tile = y * tilesX + x;
+                    int cluster = z * tilesPerSlice + tile;
+                    if (sphereIntersectsBox(light.center, light.radius, clusterMin[cluster], clusterMax[cluster])) {
+                        slice.pairs.push_back(glm::uvec2(tile, (uint32_t)i));
+                        slice.counts[tile]++;
+                    }
+                }
+            }
+        }
+
+        // counting sort by tile, keeping lights in index order inside a tile
+        std::vector<uint32_t> cursor(tilesPerSlice);
+        uint32_t offset = 0;
+        for (int t = 0; t < tilesPerSlice; t++) {
+            cursor[t] = offset;
+            offset += slice.counts[t];
+        }
+
+        slice.indices.resize(slice.pairs.size());
+        for (auto& pair : slice.pairs) {
+            slice.indices[cursor[pair.x]++] = pair.y;
+        }
+    });
+
+    // 3. concatenate the slices into one index list and upload it
+    gatherSlices();
+    for (auto& light : culled) {
+        if (light.visible) stats.lights++;
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.cullMilliseconds = elapsed.count();
+
+    upload();
+}
+
+void LightClusters::Build(const LightTree& tree,
+    const glm::mat4& view,
+    float fovY, float aspect, float near, float far,
+    float threshold)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    setProjection(fovY, aspect, near, far);
+    lightDataTexture = tree.NodeTexture();
+
+    // the tree is in world space, so every cluster box goes the other way
+    glm::mat4 invView = glm::inverse(view);
+    int tilesPerSlice = tilesX * tilesY;
+    Parallel::For(0, slices, [&](int z) {
+        auto& slice = scratch[z];
+        slice.counts.assign(tilesPerSlice, 0);
+        slice.indices.clear();
+        slice.aggregates = 0;
+
+        std::vector<uint32_t> cut(std::max(tree.MaxCut(), 1));
+        for (int tile = 0; tile < tilesPerSlice; tile++) {
+            int cluster = z * tilesPerSlice + tile;
+            auto& cMin = clusterMin[cluster];
+            auto& cMax = clusterMax[cluster];
+
+            glm::vec3 lo(std::numeric_limits<float>::max());
+            glm::vec3 hi(-std::numeric_limits<float>::max());
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec3 p((corner & 1) ? cMax.x : cMin.x, (corner & 2) ? cMax.y : cMin.y, (corner & 4) ? cMax.z : cMin.z);
+                glm::vec3 world(invView * glm::vec4(p, 1.0f));
+                lo = glm::min(lo, world);
+                hi = glm::max(hi, world);
+            }
+
+            // sorted so neighbouring fragments walk the light data in the same order
+            int count = tree.Cut(lo, hi, threshold, cut.data());
+            std::sort(cut.begin(), cut.begin() + count);
+            for (int i = 0; i < count; i++) {
+                if (tree.IsAggregate(cut[i])) slice.aggregates++;
+            }
+            slice.indices.insert(slice.indices.end(), cut.begin(), cut.begin() + count);
+            slice.counts[tile] = count;
+        }
+    });
+
+    gatherSlices();
+    stats.lights = tree.LastStats().lights;
+    for (auto& slice : scratch) {
+        stats.aggregates += slice.aggregates;
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.cullMilliseconds = elapsed.count();
+
+    upload();
+}
+
+void LightClusters::gatherSlices() {
+    int tilesPerSlice = tilesX * tilesY;
+
+    // concatenate the slices into one index list
+    std::vector<uint32_t> sliceBase(slices + 1, 0);
+    for (int z = 0; z < slices; z++) {
+        sliceBase[z + 1] = sliceBase[z] + (uint32_t)scratch[z].indices.size();
+    }
+
+    indices.resize(sliceBase[slices]);
+    stats = Stats();
+    Parallel::For(0, slices, [&](int z) {
+        auto& slice = scratch[z];
+        std::copy(slice.indices.begin(), slice.indices.end(), indices.begin() + sliceBase[z]);
+
+        uint32_t offset = sliceBase[z];
+        for (int t = 0; t < tilesPerSlice; t++) {
+            ranges[z * tilesPerSlice + t] = glm::uvec2(offset, slice.counts[t]);
+            offset += slice.counts[t];
+        }
+    });
+
+    for (auto& range : ranges) {
+        if (range.y > 0) stats.occupiedClusters++;
+    }
+    stats.assignments = (unsigned int)indices.size();
+}
+
+void LightClusters::upload() {
+    glBindBuffer(GL_TEXTURE_BUFFER, rangesTBO.Get());
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, ranges.size() * sizeof(glm::uvec2), ranges.data());
+
+    glBindBuffer(GL_TEXTURE_BUFFER, indicesTBO.Get());
+    if (indices.size() > indicesCapacity || indicesCapacity == 0) {
+        indicesCapacity = std::max<size_t>(1024, indices.size() * 2);
+        glBufferData(GL_TEXTURE_BUFFER, indicesCapacity * sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+
+        glBindTexture(GL_TEXTURE_BUFFER, indicesTexture.Get());
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, indicesTBO.Get());
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    if (!indices.empty()) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, indices.size() * sizeof(uint32_t), indices.data());
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::Bind(const Shader& shader, const LightingSystem& lighting, int viewportWidth, int viewportHeight) const {
+    glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, lightDataTexture != 0 ? lightDataTexture : lighting.PointLightTexture());
+    glActiveTexture(GL_TEXTURE0 + RANGES_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, rangesTexture.Get());
+    glActiveTexture(GL_TEXTURE0 + INDICES_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, indicesTexture.Get());
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.setInt("pointLightData", LIGHT_DATA_UNIT);
+    shader.setInt("clusterRanges", RANGES_UNIT);
+    shader.setInt("clusterLightIndices", INDICES_UNIT);
+
+    // slice = log(depth) * scale + bias, the inverse of sliceDepth
+    float logRatio = std::log(far / near);
+    float scale = slices / logRatio;
+    float bias = -slices * std::log(near) / logRatio;
+
+    shader.setVec3("clusterGrid", glm::vec3(tilesX, tilesY, slices));
+    shader.setVec3("clusterParams", glm::vec3(
+        (float)viewportWidth / tilesX,
+        (float)viewportHeight / tilesY,
+        scale));
+    shader.setFloat("clusterDepthBias", bias);
+}
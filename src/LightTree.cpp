@@ -0,0 +1,210 @@
+#include <rendersystem/LightTree.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <utility>
+
+namespace {
+    // refit boxes may grow this much (summed surface area) before the tree is rebuilt
+    const float REBUILD_GROWTH = 1.5f;
+
+    float attenuate(const QuadAttenuation& falloff, float d) {
+        return 1.0f / std::max(falloff.constant + falloff.linear * d + falloff.quadratic * d * d, 1e-4f);
+    }
+
+    float surfaceArea(const glm::vec3& lo, const glm::vec3& hi) {
+        glm::vec3 e = hi - lo;
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    // 10 bits per axis interleaved, for sorting the lights along a space filling curve
+    uint32_t spread(uint32_t v) {
+        v = (v | (v << 16)) & 0x030000ffu;
+        v = (v | (v << 8)) & 0x0300f00fu;
+        v = (v | (v << 4)) & 0x030c30c3u;
+        v = (v | (v << 2)) & 0x09249249u;
+        return v;
+    }
+}
+
+LightTree::LightTree()
+{
+    nodeTBO = GLBuffer::Create();
+    nodeTexture = GLTexture::Create();
+}
+
+uint32_t LightTree::build(std::vector<uint32_t>& order, size_t begin, size_t end) {
+    if (end - begin == 1) {
+        return order[begin];
+    }
+
+    size_t mid = begin + (end - begin) / 2;
+    uint32_t left = build(order, begin, mid);
+    uint32_t right = build(order, mid, end);
+
+    Node node;
+    node.left = left;
+    node.right = right;
+    nodes.push_back(node);
+    return (uint32_t)nodes.size() - 1;
+}
+
+float LightTree::refitNode(uint32_t index) {
+    auto& node = nodes[index];
+    auto& a = nodes[node.left];
+    auto& b = nodes[node.right];
+
+    node.lo = glm::min(a.lo, b.lo);
+    node.hi = glm::max(a.hi, b.hi);
+    node.intensity = a.intensity + b.intensity;
+    node.falloff.constant = std::min(a.falloff.constant, b.falloff.constant);
+    node.falloff.linear = std::min(a.falloff.linear, b.falloff.linear);
+    node.falloff.quadratic = std::min(a.falloff.quadratic, b.falloff.quadratic);
+
+    // the representative keeps the place and falloff of the brighter side and
+    // emits the light of both
+    auto& da = data[node.left];
+    auto& db = data[node.right];
+    auto& out = data[index];
+    out = a.intensity >= b.intensity ? da : db;
+    out.ambient = da.ambient + db.ambient;
+    out.diffuse = da.diffuse + db.diffuse;
+    out.specular = da.specular + db.specular;
+
+    return surfaceArea(node.lo, node.hi);
+}
+
+void LightTree::Update(const std::vector<PointLight>& lights) {
+    auto start = std::chrono::steady_clock::now();
+
+    bool rebuild = lights.size() != lightCount;
+    lightCount = (uint32_t)lights.size();
+    if (rebuild) {
+        nodes.assign(lightCount, Node());
+        data.resize(lightCount);
+    }
+
+    for (uint32_t i = 0; i < lightCount; i++) {
+        auto& node = nodes[i];
+        data[i] = lights[i].Pack();
+        node.lo = node.hi = lights[i].GetPosition();
+        node.intensity = lights[i].Intensity();
+        node.falloff = lights[i].GetAttenuation();
+    }
+
+    auto refit = [&]() {
+        float area = 0.0f;
+        for (uint32_t i = lightCount; i < nodes.size(); i++) {
+            area += refitNode(i);
+        }
+        return area;
+    };
+
+    if (!rebuild && lightCount > 0) {
+        rebuild = refit() > REBUILD_GROWTH * builtArea + std::numeric_limits<float>::epsilon();
+    }
+
+    if (rebuild) {
+        nodes.resize(lightCount);
+        root = NONE;
+        if (lightCount > 0) {
+            glm::vec3 lo(std::numeric_limits<float>::max());
+            glm::vec3 hi(-std::numeric_limits<float>::max());
+            for (uint32_t i = 0; i < lightCount; i++) {
+                lo = glm::min(lo, nodes[i].lo);
+                hi = glm::max(hi, nodes[i].hi);
+            }
+            glm::vec3 scale = 1023.0f / glm::max(hi - lo, glm::vec3(1e-6f));
+
+            std::vector<std::pair<uint32_t, uint32_t>> keyed(lightCount);
+            for (uint32_t i = 0; i < lightCount; i++) {
+                glm::uvec3 q(glm::clamp((nodes[i].lo - lo) * scale, glm::vec3(0.0f), glm::vec3(1023.0f)));
+                keyed[i] = { spread(q.x) | (spread(q.y) << 1) | (spread(q.z) << 2), i };
+            }
+            std::sort(keyed.begin(), keyed.end());
+
+            std::vector<uint32_t> order(lightCount);
+            for (uint32_t i = 0; i < lightCount; i++) {
+                order[i] = keyed[i].second;
+            }
+
+            nodes.reserve(2 * lightCount - 1);
+            root = build(order, 0, lightCount);
+            data.resize(nodes.size());
+            builtArea = refit();
+        }
+    }
+
+    stats = Stats();
+    stats.lights = lightCount;
+    stats.nodes = (unsigned int)nodes.size();
+    stats.rebuilt = rebuild;
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.updateMilliseconds = elapsed.count();
+
+    // every representative may have moved, so the whole buffer goes up
+    glBindBuffer(GL_TEXTURE_BUFFER, nodeTBO.Get());
+    if (data.size() > nodeCapacity || nodeCapacity == 0) {
+        nodeCapacity = std::max<size_t>(64, data.size() * 2);
+        glBufferData(GL_TEXTURE_BUFFER, nodeCapacity * sizeof(PointLightData), nullptr, GL_DYNAMIC_DRAW);
+
+        glBindTexture(GL_TEXTURE_BUFFER, nodeTexture.Get());
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, nodeTBO.Get());
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    if (!data.empty()) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, data.size() * sizeof(PointLightData), data.data());
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+float LightTree::bound(uint32_t index, const glm::vec3& lo, const glm::vec3& hi) const {
+    auto& node = nodes[index];
+    glm::vec3 gap = glm::max(glm::max(node.lo - hi, lo - node.hi), glm::vec3(0.0f));
+    return node.intensity * attenuate(node.falloff, glm::length(gap));
+}
+
+float LightTree::estimate(uint32_t index, const glm::vec3& lo, const glm::vec3& hi) const {
+    auto& light = data[index];
+    QuadAttenuation falloff{ light.attenuation.x, light.attenuation.y, light.attenuation.z };
+    float d = glm::length(glm::vec3(light.position) - (lo + hi) * 0.5f);
+    return nodes[index].intensity * attenuate(falloff, d);
+}
+
+int LightTree::Cut(const glm::vec3& lo, const glm::vec3& hi, float threshold, uint32_t* out) const {
+    if (root == NONE) {
+        return 0;
+    }
+
+    // max heap of (error bound, node); a leaf is exact, so its bound only decides culling
+    thread_local std::vector<std::pair<float, uint32_t>> heap;
+    heap.clear();
+    heap.push_back({ bound(root, lo, hi), root });
+    float total = estimate(root, lo, hi);
+    size_t limit = (size_t)std::max(maxCut, 1);
+
+    int count = 0;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end());
+        auto [error, node] = heap.back();
+        heap.pop_back();
+
+        // everything left is bounded by this, too dim to light the region
+        if (error < threshold) break;
+
+        if (node < lightCount || error <= errorBudget * total || count + heap.size() + 2 > limit) {
+            out[count++] = node;
+            continue;
+        }
+
+        total -= estimate(node, lo, hi);
+        for (uint32_t child : { nodes[node].left, nodes[node].right }) {
+            total += estimate(child, lo, hi);
+            heap.push_back({ bound(child, lo, hi), child });
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+    return count;
+}
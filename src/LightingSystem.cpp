@@ -0,0 +1,214 @@
+#include <rendersystem/LightingSystem.h>
+
+#include <cstddef>
+#include <iostream>
+#include <algorithm>
+#include <utility>
+
+LightingSystem::LightingSystem() {
+    UBO = GLBuffer::Create();
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO.Get());
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(BlockLayout), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, UniformBlocks::LIGHTS, UBO.Get());
+
+    pointLightTBO = GLBuffer::Create();
+    pointLightTexture = GLTexture::Create();
+    glBindBuffer(GL_TEXTURE_BUFFER, pointLightTBO.Get());
+    allocatePointLightBuffer(64);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    pointLights.reserve(MAX_POINT_LIGHTS);
+    directionalLights.reserve(MAX_DIRECTIONAL_LIGHTS);
+}
+
+int LightingSystem::AddPointLight(const PointLight& light) {
+    if ((int)pointLights.size() == MAX_POINT_LIGHTS) {
+        std::cout << "WARNING::LIGHTING_SYSTEM::POINT_LIGHTS_PAST_UNIFORM_BLOCK_CAPACITY "
+            << "only the clustered path sees lights past " << MAX_POINT_LIGHTS << std::endl;
+    }
+
+    pointLights.push_back(light);
+    dirtyPoint.Add((int)pointLights.size() - 1);
+    countsDirty = true;
+    return (int)pointLights.size() - 1;
+}
+
+int LightingSystem::AddDirectionalLight(const DirectionalLight& light) {
+    if ((int)directionalLights.size() >= MAX_DIRECTIONAL_LIGHTS) {
+        std::cout << "ERROR::LIGHTING_SYSTEM::TOO_MANY_DIRECTIONAL_LIGHTS" << std::endl;
+        return -1;
+    }
+
+    directionalLights.push_back(light);
+    dirtyDirectional.Add((int)directionalLights.size() - 1);
+    countsDirty = true;
+    return (int)directionalLights.size() - 1;
+}
+
+LightingSystem::PointLightEdit LightingSystem::EditPointLight(int index) {
+    return PointLightEdit(this, index);
+}
+
+LightingSystem::DirectionalLightEdit LightingSystem::EditDirectionalLight(int index) {
+    return DirectionalLightEdit(this, index);
+}
+
+PointLight* LightingSystem::PointLightEdit::operator->() const {
+    system->dirtyPoint.Add(index);
+    return &system->pointLights[index];
+}
+
+DirectionalLight* LightingSystem::DirectionalLightEdit::operator->() const {
+    system->dirtyDirectional.Add(index);
+    return &system->directionalLights[index];
+}
+
+void LightingSystem::allocatePointLightBuffer(size_t capacity) {
+    pointLightCapacity = capacity;
+    glBufferData(GL_TEXTURE_BUFFER, pointLightCapacity * sizeof(PointLightData), nullptr, GL_DYNAMIC_DRAW);
+
+    glBindTexture(GL_TEXTURE_BUFFER, pointLightTexture.Get());
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, pointLightTBO.Get());
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightingSystem::SetCullThreshold(float threshold) {
+    if (threshold == cullThreshold) return;
+
+    cullThreshold = threshold;
+    cullInfoDirty = true;
+}
+
+void LightingSystem::updateCullInfo(int first, int last) {
+    cullInfo.resize(pointLights.size());
+    for (int i = first; i < last; i++) {
+        auto data = pointLights[i].Pack();
+        auto& info = cullInfo[i];
+        info.position = glm::vec3(data.position);
+        info.range = pointLights[i].Range(cullThreshold);
+        info.attenuation = glm::vec3(data.attenuation);
+        info.intensity = pointLights[i].Intensity();
+    }
+}
+
+int LightingSystem::SelectPointLights(const BoundingSphere& bounds, int* out) const {
+    int candidates = std::min((int)cullInfo.size(), MAX_POINT_LIGHTS);
+    selection.draws++;
+    selection.lightsConsidered += candidates;
+
+    // (brightness at the nearest point of the bounds, index), kept sorted, strongest first
+    std::pair<float, int> best[MAX_OBJECT_LIGHTS];
+    int count = 0;
+
+    for (int i = 0; i < candidates; i++) {
+        auto& info = cullInfo[i];
+        if (!bounds.Intersects(info.position, info.range)) continue;
+
+        float d = bounds.Unbounded() ? 0.0f : std::max(0.0f, glm::length(info.position - bounds.center) - bounds.radius);
+        float falloff = info.attenuation.x + info.attenuation.y * d + info.attenuation.z * d * d;
+        float strength = falloff > 0.0f ? info.intensity / falloff : info.intensity;
+
+        if (count == MAX_OBJECT_LIGHTS && strength <= best[count - 1].first) continue;
+
+        int slot = count < MAX_OBJECT_LIGHTS ? count++ : count - 1;
+        while (slot > 0 && best[slot - 1].first < strength) {
+            best[slot] = best[slot - 1];
+            slot--;
+        }
+        best[slot] = std::make_pair(strength, i);
+    }
+
+    for (int i = 0; i < count; i++) {
+        out[i] = best[i].second;
+    }
+    selection.lightsSelected += count;
+    return count;
+}
+
+void LightingSystem::Upload() {
+    lastUpload = UploadStats();
+    selection = SelectionStats();
+
+    if (cullInfoDirty) {
+        updateCullInfo(0, (int)pointLights.size());
+        cullInfoDirty = false;
+    }
+    else if (!dirtyPoint.Empty()) {
+        updateCullInfo(dirtyPoint.first, dirtyPoint.last);
+    }
+
+    if (!countsDirty && dirtyPoint.Empty() && dirtyDirectional.Empty()) {
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO.Get());
+
+    if (countsDirty) {
+        glm::ivec4 counts(std::min((int)pointLights.size(), MAX_POINT_LIGHTS), (int)directionalLights.size(), 0, 0);
+        glBufferSubData(GL_UNIFORM_BUFFER, offsetof(BlockLayout, counts), sizeof(counts), &counts);
+        lastUpload.bytes += sizeof(counts);
+        countsDirty = false;
+    }
+
+    if (!dirtyDirectional.Empty()) {
+        std::vector<DirectionalLightData> packed;
+        packed.reserve(dirtyDirectional.last - dirtyDirectional.first);
+        for (int i = dirtyDirectional.first; i < dirtyDirectional.last; i++) {
+            packed.push_back(directionalLights[i].Pack());
+        }
+
+        auto bytes = packed.size() * sizeof(DirectionalLightData);
+        glBufferSubData(GL_UNIFORM_BUFFER,
+            offsetof(BlockLayout, directionalLights) + dirtyDirectional.first * sizeof(DirectionalLightData),
+            bytes, packed.data());
+
+        lastUpload.lights += (unsigned int)packed.size();
+        lastUpload.bytes += (unsigned int)bytes;
+        dirtyDirectional = DirtyRange();
+    }
+
+    if (!dirtyPoint.Empty()) {
+        std::vector<PointLightData> packed;
+        packed.reserve(dirtyPoint.last - dirtyPoint.first);
+        for (int i = dirtyPoint.first; i < dirtyPoint.last; i++) {
+            packed.push_back(pointLights[i].Pack());
+        }
+
+        // the part of the range that fits in the uniform block
+        int blockLast = std::min(dirtyPoint.last, MAX_POINT_LIGHTS);
+        if (dirtyPoint.first < blockLast) {
+            auto bytes = (blockLast - dirtyPoint.first) * sizeof(PointLightData);
+            glBufferSubData(GL_UNIFORM_BUFFER,
+                offsetof(BlockLayout, pointLights) + dirtyPoint.first * sizeof(PointLightData),
+                bytes, packed.data());
+            lastUpload.bytes += (unsigned int)bytes;
+        }
+
+        // and every light to the texture buffer, growing it when it's full
+        glBindBuffer(GL_TEXTURE_BUFFER, pointLightTBO.Get());
+        auto bytes = packed.size() * sizeof(PointLightData);
+        if (pointLights.size() > pointLightCapacity) {
+            allocatePointLightBuffer(pointLights.size() * 2);
+
+            std::vector<PointLightData> all;
+            all.reserve(pointLights.size());
+            for (auto& light : pointLights) {
+                all.push_back(light.Pack());
+            }
+            bytes = all.size() * sizeof(PointLightData);
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, all.data());
+        }
+        else {
+            glBufferSubData(GL_TEXTURE_BUFFER, dirtyPoint.first * sizeof(PointLightData), bytes, packed.data());
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        lastUpload.lights += (unsigned int)packed.size();
+        lastUpload.bytes += (unsigned int)bytes;
+        dirtyPoint = DirtyRange();
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
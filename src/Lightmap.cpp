@@ -0,0 +1,344 @@
+#include <rendersystem/Lightmap.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+    // file layout: header, remap, uvs, indices, then the texels as float rgb
+    struct LightmapHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+    };
+
+    const char LIGHTMAP_MAGIC[4] = { 'R', 'S', 'L', 'M' };
+    const uint32_t LIGHTMAP_VERSION = 1;
+
+    // a triangle joins a chart when it faces within ~45 degrees of the chart's first one,
+    // which keeps the planar projection from folding over itself
+    const float CHART_NORMAL_COS = 0.7f;
+
+    struct Chart {
+        std::vector<uint32_t> triangles;
+        glm::vec3 tangent;
+        glm::vec3 bitangent;
+        glm::vec2 lo;           // projected bounds, world units
+        glm::vec2 hi;
+        glm::ivec2 size;        // texels, including the padding
+        glm::ivec2 offset;      // position in the lightmap
+    };
+
+    uint32_t nextPowerOfTwo(uint32_t v) {
+        uint32_t p = 1;
+        while (p < v) p <<= 1;
+        return p;
+    }
+
+    // shelf packs the charts tallest first into the narrowest power of two width that
+    // holds their area. returns the lightmap size
+    glm::ivec2 packCharts(std::vector<Chart>& charts) {
+        std::vector<size_t> order(charts.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return charts[a].size.y > charts[b].size.y;
+        });
+
+        uint64_t area = 0;
+        int widest = 0;
+        for (auto& chart : charts) {
+            area += (uint64_t)chart.size.x * chart.size.y;
+            widest = std::max(widest, chart.size.x);
+        }
+
+        int width = (int)nextPowerOfTwo(std::max((uint32_t)widest, (uint32_t)std::ceil(std::sqrt((double)area))));
+        int x = 0, y = 0, shelfHeight = 0;
+        for (auto i : order) {
+            auto& chart = charts[i];
+            if (x + chart.size.x > width) {
+                y += shelfHeight;
+                x = 0;
+                shelfHeight = 0;
+            }
+            chart.offset = glm::ivec2(x, y);
+            x += chart.size.x;
+            shelfHeight = std::max(shelfHeight, chart.size.y);
+        }
+
+        return glm::ivec2(width, y + shelfHeight);
+    }
+}
+
+Lightmap Lightmap::Unwrap(const MeshData& mesh, const glm::mat4& transform,
+    float texelsPerUnit, int padding, int maxSize)
+{
+    Lightmap lightmap;
+    auto triangles = Geometry::Triangles(mesh);
+    size_t triangleCount = triangles.size() / 3;
+    if (triangleCount == 0) {
+        return lightmap;
+    }
+
+    std::vector<glm::vec3> world(mesh.vertices.size());
+    for (size_t i = 0; i < world.size(); i++) {
+        world[i] = glm::vec3(transform * glm::vec4(mesh.vertices[i].Position, 1.0f));
+    }
+
+    std::vector<glm::vec3> faceNormals(triangleCount);
+    std::vector<float> faceAreas(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        auto& a = world[triangles[t * 3]];
+        auto& b = world[triangles[t * 3 + 1]];
+        auto& c = world[triangles[t * 3 + 2]];
+        auto n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        faceNormals[t] = length > 0.0f ? n / length : glm::vec3(0, 1, 0);
+        faceAreas[t] = length * 0.5f;
+    }
+
+    // loaders split vertices along uv and normal seams, so adjacency goes by position:
+    // vertices at the same place share a canonical id
+    std::vector<uint32_t> canonical(world.size());
+    {
+        std::vector<uint32_t> sorted(world.size());
+        std::iota(sorted.begin(), sorted.end(), 0);
+        auto less = [&](uint32_t a, uint32_t b) {
+            auto& p = mesh.vertices[a].Position;
+            auto& q = mesh.vertices[b].Position;
+            if (p.x != q.x) return p.x < q.x;
+            if (p.y != q.y) return p.y < q.y;
+            return p.z < q.z;
+        };
+        std::sort(sorted.begin(), sorted.end(), less);
+        for (size_t i = 0; i < sorted.size(); i++) {
+            bool same = i > 0 && mesh.vertices[sorted[i]].Position == mesh.vertices[sorted[i - 1]].Position;
+            canonical[sorted[i]] = same ? canonical[sorted[i - 1]] : sorted[i];
+        }
+    }
+
+    auto edgeKey = [&](size_t t, int k) {
+        uint64_t a = canonical[triangles[t * 3 + k]];
+        uint64_t b = canonical[triangles[t * 3 + (k + 1) % 3]];
+        return std::min(a, b) << 32 | std::max(a, b);
+    };
+
+    std::unordered_map<uint64_t, std::vector<uint32_t>> edgeTriangles;
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            edgeTriangles[edgeKey(t, k)].push_back((uint32_t)t);
+        }
+    }
+
+    // grow charts over shared edges while the triangles face roughly the same way
+    std::vector<Chart> charts;
+    std::vector<int> chartOf(triangleCount, -1);
+    std::vector<uint32_t> stack;
+    for (size_t seed = 0; seed < triangleCount; seed++) {
+        if (chartOf[seed] >= 0) continue;
+
+        int id = (int)charts.size();
+        charts.emplace_back();
+        auto& chart = charts.back();
+        auto seedNormal = faceNormals[seed];
+
+        chartOf[seed] = id;
+        stack.push_back((uint32_t)seed);
+        while (!stack.empty()) {
+            auto t = stack.back();
+            stack.pop_back();
+            chart.triangles.push_back(t);
+
+            for (int k = 0; k < 3; k++) {
+                for (auto n : edgeTriangles[edgeKey(t, k)]) {
+                    if (chartOf[n] < 0 && glm::dot(faceNormals[n], seedNormal) > CHART_NORMAL_COS) {
+                        chartOf[n] = id;
+                        stack.push_back(n);
+                    }
+                }
+            }
+        }
+
+        // project along the area weighted normal of the chart
+        glm::vec3 normal(0.0f);
+        for (auto t : chart.triangles) {
+            normal += faceNormals[t] * faceAreas[t];
+        }
+        normal = glm::length(normal) > 0.0f ? glm::normalize(normal) : seedNormal;
+
+        auto helper = std::abs(normal.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+        chart.tangent = glm::normalize(glm::cross(helper, normal));
+        chart.bitangent = glm::cross(normal, chart.tangent);
+
+        chart.lo = glm::vec2(std::numeric_limits<float>::max());
+        chart.hi = glm::vec2(-std::numeric_limits<float>::max());
+        for (auto t : chart.triangles) {
+            for (int k = 0; k < 3; k++) {
+                auto& p = world[triangles[t * 3 + k]];
+                glm::vec2 q(glm::dot(p, chart.tangent), glm::dot(p, chart.bitangent));
+                chart.lo = glm::min(chart.lo, q);
+                chart.hi = glm::max(chart.hi, q);
+            }
+        }
+    }
+
+    // pack, lowering the density until everything fits
+    float density = texelsPerUnit;
+    glm::ivec2 size;
+    for (int attempt = 0; ; attempt++) {
+        for (auto& chart : charts) {
+            auto extent = glm::ceil((chart.hi - chart.lo) * density);
+            chart.size = glm::ivec2(extent) + 1 + 2 * padding;
+        }
+
+        size = packCharts(charts);
+        if (size.x <= maxSize && size.y <= maxSize) break;
+
+        if (attempt == 16) {
+            std::cout << "WARNING::LIGHTMAP::DOES_NOT_FIT " << size.x << "x" << size.y << std::endl;
+            break;
+        }
+        density *= 0.8f;
+    }
+
+    lightmap.width = size.x;
+    lightmap.height = size.y;
+
+    // charts get their own copy of every vertex they use
+    std::vector<int> vertexChart(world.size(), -1);
+    std::vector<uint32_t> vertexIndex(world.size());
+    for (size_t c = 0; c < charts.size(); c++) {
+        auto& chart = charts[c];
+        glm::vec2 origin = glm::vec2(chart.offset) + glm::vec2((float)padding + 0.5f);
+
+        for (auto t : chart.triangles) {
+            for (int k = 0; k < 3; k++) {
+                auto v = triangles[t * 3 + k];
+                if (vertexChart[v] != (int)c) {
+                    vertexChart[v] = (int)c;
+                    vertexIndex[v] = (uint32_t)lightmap.remap.size();
+
+                    auto& p = world[v];
+                    glm::vec2 q(glm::dot(p, chart.tangent), glm::dot(p, chart.bitangent));
+                    auto texel = origin + (q - chart.lo) * density;
+
+                    lightmap.remap.push_back(v);
+                    lightmap.uvs.push_back(texel / glm::vec2(size));
+                }
+                lightmap.indices.push_back(vertexIndex[v]);
+            }
+        }
+    }
+
+    return lightmap;
+}
+
+bool Lightmap::Save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "ERROR::LIGHTMAP::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+
+    LightmapHeader header;
+    std::copy(LIGHTMAP_MAGIC, LIGHTMAP_MAGIC + 4, header.magic);
+    header.version = LIGHTMAP_VERSION;
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    header.vertexCount = (uint32_t)remap.size();
+    header.indexCount = (uint32_t)indices.size();
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(remap.data()), remap.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(uvs.data()), uvs.size() * sizeof(glm::vec2));
+    file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(texels.data()), texels.size() * sizeof(glm::vec3));
+
+    if (!file) {
+        std::cout << "ERROR::LIGHTMAP::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Lightmap::Load(const std::string& path, Lightmap& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    LightmapHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file ||
+        !std::equal(header.magic, header.magic + 4, LIGHTMAP_MAGIC) ||
+        header.version != LIGHTMAP_VERSION) {
+        std::cout << "ERROR::LIGHTMAP::INVALID_FILE " << path << std::endl;
+        return false;
+    }
+
+    Lightmap lightmap;
+    lightmap.width = (int)header.width;
+    lightmap.height = (int)header.height;
+    lightmap.remap.resize(header.vertexCount);
+    lightmap.uvs.resize(header.vertexCount);
+    lightmap.indices.resize(header.indexCount);
+    lightmap.texels.resize((size_t)header.width * header.height);
+
+    file.read(reinterpret_cast<char*>(lightmap.remap.data()), lightmap.remap.size() * sizeof(uint32_t));
+    file.read(reinterpret_cast<char*>(lightmap.uvs.data()), lightmap.uvs.size() * sizeof(glm::vec2));
+    file.read(reinterpret_cast<char*>(lightmap.indices.data()), lightmap.indices.size() * sizeof(uint32_t));
+    file.read(reinterpret_cast<char*>(lightmap.texels.data()), lightmap.texels.size() * sizeof(glm::vec3));
+
+    bool valid = (bool)file;
+    for (auto index : lightmap.indices) {
+        valid = valid && index < header.vertexCount;
+    }
+    if (!valid) {
+        std::cout << "ERROR::LIGHTMAP::INVALID_FILE " << path << std::endl;
+        return false;
+    }
+
+    out = std::move(lightmap);
+    return true;
+}
+
+bool Lightmap::SaveHDR(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "ERROR::LIGHTMAP::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+
+    file << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " << height << " +X " << width << "\n";
+
+    // uncompressed rgbe scanlines, top row first
+    std::vector<unsigned char> row(width * 4);
+    for (int y = height - 1; y >= 0; y--) {
+        for (int x = 0; x < width; x++) {
+            auto& c = texels[(size_t)y * width + x];
+            float v = std::max(c.r, std::max(c.g, c.b));
+            unsigned char* rgbe = &row[x * 4];
+            if (v < 1e-32f) {
+                rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+                continue;
+            }
+
+            int e;
+            float scale = std::frexp(v, &e) * 256.0f / v;
+            rgbe[0] = (unsigned char)(c.r * scale);
+            rgbe[1] = (unsigned char)(c.g * scale);
+            rgbe[2] = (unsigned char)(c.b * scale);
+            rgbe[3] = (unsigned char)(e + 128);
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    return (bool)file;
+}
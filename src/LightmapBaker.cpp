@@ -0,0 +1,405 @@
+#include <rendersystem/LightmapBaker.h>
+#include <rendersystem/Parallel.h>
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+    // direction around n with a cos(theta) density, which cancels the cosine term
+    glm::vec3 cosineSample(const glm::vec3& n, float u1, float u2) {
+        float r = std::sqrt(u1);
+        float phi = 2.0f * glm::pi<float>() * u2;
+
+        auto helper = std::abs(n.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+        auto t = glm::normalize(glm::cross(helper, n));
+        auto b = glm::cross(n, t);
+        return t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + n * std::sqrt(std::max(0.0f, 1.0f - u1));
+    }
+
+    // a lightmap texel whose center lies on a triangle
+    struct TexelSample {
+        glm::vec3 position;
+        glm::vec3 normal;     // interpolated, for shading
+        glm::vec3 faceNormal; // for offsetting rays
+        uint32_t texel;
+    };
+
+    const float INFINITE_DISTANCE = std::numeric_limits<float>::max();
+}
+
+int LightmapBaker::AddMesh(const MeshData& mesh, const glm::mat4& transform, const glm::vec3& albedo)
+{
+    instances.push_back(Instance{ mesh, transform, albedo });
+    return (int)instances.size() - 1;
+}
+
+void LightmapBaker::AddPointLight(const PointLight& light)
+{
+    pointLights.push_back(light.Pack());
+}
+
+void LightmapBaker::AddDirectionalLight(const DirectionalLight& light)
+{
+    directionalLights.push_back(light.Pack());
+}
+
+glm::vec3 LightmapBaker::directLight(const glm::vec3& p, const glm::vec3& n, float bias, uint64_t& rays) const
+{
+    glm::vec3 light(0.0f);
+    auto origin = p + n * bias;
+
+    for (auto& dl : directionalLights) {
+        auto l = glm::normalize(-glm::vec3(dl.direction));
+        float cosine = glm::dot(n, l);
+        if (cosine <= 0.0f) continue;
+
+        rays++;
+        if (!bvh.Occluded(origin, l, INFINITE_DISTANCE)) {
+            light += glm::vec3(dl.diffuse) * cosine;
+        }
+    }
+
+    // same falloff as CalcPointLight
+    for (auto& pl : pointLights) {
+        auto d = glm::vec3(pl.position) - p;
+        float distance = glm::length(d);
+        if (distance <= bias) continue;
+
+        auto l = d / distance;
+        float cosine = glm::dot(n, l);
+        if (cosine <= 0.0f) continue;
+
+        float attenuation = 1.0f / (pl.attenuation.x + pl.attenuation.y * distance + pl.attenuation.z * distance * distance);
+        auto contribution = glm::vec3(pl.diffuse) * attenuation * cosine;
+        if (std::max(contribution.r, std::max(contribution.g, contribution.b)) < 1.0f / 1024.0f) continue;
+
+        rays++;
+        if (!bvh.Occluded(origin, l, distance - bias)) {
+            light += contribution;
+        }
+    }
+
+    return light;
+}
+
+glm::vec3 LightmapBaker::traceRadiance(glm::vec3 origin, glm::vec3 dir, int bounces, float bias,
+    Random& random, uint64_t& rays, bool* backfaceHit) const
+{
+    glm::vec3 radiance(0.0f);
+    glm::vec3 throughput(1.0f);
+
+    for (int bounce = 0; bounce < bounces; bounce++) {
+        TriangleBVH::Hit hit;
+        rays++;
+        if (!bvh.Intersect(origin, dir, INFINITE_DISTANCE, hit)) break;
+
+        // inside a closed mesh or looking at a back face: no light comes back
+        auto& tri = sceneTriangles[hit.triangle];
+        if (glm::dot(tri.faceNormal, dir) >= 0.0f) {
+            if (backfaceHit != nullptr && bounce == 0) *backfaceHit = true;
+            break;
+        }
+
+        auto position = origin + dir * hit.t;
+        auto normal = tri.normals[0] * (1.0f - hit.u - hit.v) + tri.normals[1] * hit.u + tri.normals[2] * hit.v;
+        normal = glm::length(normal) > 0.0f ? glm::normalize(normal) : tri.faceNormal;
+
+        throughput *= instances[tri.instance].albedo;
+        radiance += throughput * directLight(position, normal, bias, rays);
+
+        origin = position + tri.faceNormal * bias;
+        dir = cosineSample(normal, random.Next(), random.Next());
+    }
+
+    return radiance;
+}
+
+void LightmapBaker::buildScene()
+{
+    std::vector<glm::vec3> positions;
+    sceneTriangles.clear();
+    worldPositions.assign(instances.size(), {});
+    worldNormals.assign(instances.size(), {});
+
+    for (size_t i = 0; i < instances.size(); i++) {
+        auto& instance = instances[i];
+        auto normalMatrix = glm::transpose(glm::inverse(glm::mat3(instance.transform)));
+
+        auto& world = worldPositions[i];
+        auto& normals = worldNormals[i];
+        for (auto& v : instance.mesh.vertices) {
+            world.push_back(glm::vec3(instance.transform * glm::vec4(v.Position, 1.0f)));
+            auto n = normalMatrix * v.Normal;
+            normals.push_back(glm::length(n) > 0.0f ? glm::normalize(n) : glm::vec3(0, 1, 0));
+        }
+
+        auto triangles = Geometry::Triangles(instance.mesh);
+        for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+            SceneTriangle tri;
+            for (int k = 0; k < 3; k++) {
+                positions.push_back(world[triangles[t + k]]);
+                tri.normals[k] = normals[triangles[t + k]];
+            }
+
+            auto* p = &positions[positions.size() - 3];
+            auto n = glm::cross(p[1] - p[0], p[2] - p[0]);
+            // meshes are wound counter-clockwise seen from the front
+            tri.faceNormal = glm::length(n) > 0.0f ? glm::normalize(n) : tri.normals[0];
+            tri.instance = (uint32_t)i;
+            sceneTriangles.push_back(tri);
+        }
+    }
+
+    bvh.Build(positions);
+    stats.triangles = (unsigned int)sceneTriangles.size();
+}
+
+std::vector<Lightmap> LightmapBaker::Bake(const Settings& settings)
+{
+    stats = Stats();
+    auto start = std::chrono::steady_clock::now();
+
+    buildScene();
+
+    std::vector<Lightmap> lightmaps;
+    for (auto& instance : instances) {
+        lightmaps.push_back(Lightmap::Unwrap(instance.mesh, instance.transform,
+            settings.texelsPerUnit, settings.padding, settings.maxSize));
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.buildMilliseconds = elapsed.count();
+    start = std::chrono::steady_clock::now();
+
+    // the directional ambient term is unshadowed, like in the shader
+    glm::vec3 ambient(0.0f);
+    for (auto& dl : directionalLights) {
+        ambient += glm::vec3(dl.ambient);
+    }
+
+    std::atomic<uint64_t> totalRays{ 0 };
+    for (size_t i = 0; i < instances.size(); i++) {
+        auto& lightmap = lightmaps[i];
+        auto& world = worldPositions[i];
+        auto& normals = worldNormals[i];
+        lightmap.texels.assign((size_t)lightmap.width * lightmap.height, glm::vec3(0.0f));
+
+        // rasterize the triangles in lightmap space, one sample per covered texel center
+        std::vector<TexelSample> samples;
+        std::vector<char> covered(lightmap.texels.size(), 0);
+        auto size = glm::vec2(lightmap.width, lightmap.height);
+        for (size_t t = 0; t + 2 < lightmap.indices.size(); t += 3) {
+            uint32_t v[3] = { lightmap.indices[t], lightmap.indices[t + 1], lightmap.indices[t + 2] };
+            glm::vec2 q[3];
+            for (int k = 0; k < 3; k++) {
+                q[k] = lightmap.uvs[v[k]] * size - 0.5f;
+            }
+
+            float area = (q[1].x - q[0].x) * (q[2].y - q[0].y) - (q[2].x - q[0].x) * (q[1].y - q[0].y);
+            if (area == 0.0f) continue;
+
+            auto lo = glm::max(glm::ivec2(glm::floor(glm::min(q[0], glm::min(q[1], q[2])))), glm::ivec2(0));
+            auto hi = glm::min(glm::ivec2(glm::ceil(glm::max(q[0], glm::max(q[1], q[2])))),
+                glm::ivec2(lightmap.width - 1, lightmap.height - 1));
+
+            auto& p0 = world[lightmap.remap[v[0]]];
+            auto& p1 = world[lightmap.remap[v[1]]];
+            auto& p2 = world[lightmap.remap[v[2]]];
+            auto faceNormal = glm::cross(p1 - p0, p2 - p0);
+            if (glm::length(faceNormal) == 0.0f) continue;
+            faceNormal = glm::normalize(faceNormal);
+
+            for (int y = lo.y; y <= hi.y; y++) {
+                for (int x = lo.x; x <= hi.x; x++) {
+                    uint32_t texel = (uint32_t)(y * lightmap.width + x);
+                    if (covered[texel]) continue;
+
+                    glm::vec2 c(x, y);
+                    float w1 = ((c.x - q[0].x) * (q[2].y - q[0].y) - (q[2].x - q[0].x) * (c.y - q[0].y)) / area;
+                    float w2 = ((q[1].x - q[0].x) * (c.y - q[0].y) - (c.x - q[0].x) * (q[1].y - q[0].y)) / area;
+                    float w0 = 1.0f - w1 - w2;
+                    if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+
+                    auto n = normals[lightmap.remap[v[0]]] * w0 +
+                        normals[lightmap.remap[v[1]]] * w1 +
+                        normals[lightmap.remap[v[2]]] * w2;
+                    n = glm::length(n) > 0.0f ? glm::normalize(n) : faceNormal;
+
+                    covered[texel] = 1;
+                    samples.push_back(TexelSample{ p0 * w0 + p1 * w1 + p2 * w2, n, faceNormal, texel });
+                }
+            }
+        }
+        stats.texels += (unsigned int)samples.size();
+
+        Parallel::For(0, (int)samples.size(), [&](int s) {
+            auto& sample = samples[s];
+            Random random(((uint64_t)i << 32) ^ sample.texel);
+            uint64_t rays = 0;
+
+            auto light = ambient + directLight(sample.position, sample.normal, settings.bias, rays);
+
+            // the shader multiplies by the diffuse color, so the indirect estimate is the
+            // mean incoming radiance over cosine distributed directions
+            glm::vec3 indirect(0.0f);
+            for (int path = 0; path < settings.samples && settings.bounces > 0; path++) {
+                auto dir = cosineSample(sample.normal, random.Next(), random.Next());
+                indirect += traceRadiance(sample.position + sample.faceNormal * settings.bias, dir,
+                    settings.bounces, settings.bias, random, rays);
+            }
+            if (settings.samples > 0) {
+                light += indirect / (float)settings.samples;
+            }
+
+            lightmap.texels[sample.texel] = light;
+            totalRays += rays;
+        }, 64);
+
+        // bleed the charts into their padding so bilinear filtering never reads black
+        for (int pass = 0; pass < settings.padding; pass++) {
+            auto next = covered;
+            for (int y = 0; y < lightmap.height; y++) {
+                for (int x = 0; x < lightmap.width; x++) {
+                    size_t texel = (size_t)y * lightmap.width + x;
+                    if (covered[texel]) continue;
+
+                    glm::vec3 sum(0.0f);
+                    int count = 0;
+                    for (int dy = -1; dy <= 1; dy++) {
+                        for (int dx = -1; dx <= 1; dx++) {
+                            int nx = x + dx, ny = y + dy;
+                            if (nx < 0 || ny < 0 || nx >= lightmap.width || ny >= lightmap.height) continue;
+                            size_t neighbour = (size_t)ny * lightmap.width + nx;
+                            if (!covered[neighbour]) continue;
+                            sum += lightmap.texels[neighbour];
+                            count++;
+                        }
+                    }
+
+                    if (count > 0) {
+                        lightmap.texels[texel] = sum / (float)count;
+                        next[texel] = 1;
+                    }
+                }
+            }
+            covered.swap(next);
+        }
+    }
+
+    stats.rays = totalRays;
+    elapsed = std::chrono::steady_clock::now() - start;
+    stats.traceMilliseconds = elapsed.count();
+
+    return lightmaps;
+}
+
+ProbeGrid LightmapBaker::BakeProbes(const glm::vec3& lo, const glm::vec3& hi, const glm::ivec3& counts, const Settings& settings)
+{
+    stats = Stats();
+    auto start = std::chrono::steady_clock::now();
+
+    buildScene();
+    ProbeGrid grid(lo, hi, counts);
+    auto size = grid.Counts();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.buildMilliseconds = elapsed.count();
+    start = std::chrono::steady_clock::now();
+
+    // monte carlo projection over uniformly distributed directions, then the cosine
+    // convolution per band (pi, 2pi/3, pi/4) and the division by pi the shader expects
+    const float bandScale[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+    int samples = std::max(1, settings.probeSamples);
+    float weight = 4.0f * glm::pi<float>() / samples;
+
+    std::vector<char> valid(grid.ProbeCount(), 1);
+    std::atomic<uint64_t> totalRays{ 0 };
+    Parallel::For(0, (int)grid.ProbeCount(), [&](int index) {
+        int x = index % size.x;
+        int y = (index / size.x) % size.y;
+        int z = index / (size.x * size.y);
+        auto origin = grid.ProbePosition(x, y, z);
+
+        Random random(((uint64_t)1 << 63) ^ (uint64_t)index);
+        uint64_t rays = 0;
+        int backfaces = 0;
+
+        SH9 sh;
+        for (int s = 0; s < samples; s++) {
+            float cosTheta = 1.0f - 2.0f * random.Next();
+            float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+            float phi = 2.0f * glm::pi<float>() * random.Next();
+            glm::vec3 dir(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+
+            bool backface = false;
+            auto radiance = traceRadiance(origin, dir, std::max(1, settings.bounces), settings.bias, random, rays, &backface);
+            backfaces += backface;
+
+            float basis[9];
+            SH9::Basis(dir, basis);
+            for (int i = 0; i < 9; i++) {
+                sh.c[i] += radiance * basis[i];
+            }
+        }
+
+        for (int i = 0; i < 9; i++) {
+            sh.c[i] *= weight * bandScale[i];
+        }
+
+        grid.Probe(index) = sh;
+        valid[index] = backfaces * 4 < samples;
+        totalRays += rays;
+    });
+
+    // probes inside geometry only see back faces: fill them from their valid neighbours
+    for (int pass = 0; pass < size.x + size.y + size.z; pass++) {
+        auto next = valid;
+        bool missing = false;
+        for (int z = 0; z < size.z; z++) {
+            for (int y = 0; y < size.y; y++) {
+                for (int x = 0; x < size.x; x++) {
+                    int index = grid.Index(x, y, z);
+                    if (valid[index]) continue;
+
+                    SH9 sum;
+                    int count = 0;
+                    const glm::ivec3 neighbours[6] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+                    for (auto& offset : neighbours) {
+                        auto p = glm::ivec3(x, y, z) + offset;
+                        if (glm::any(glm::lessThan(p, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(p, size))) continue;
+                        int neighbour = grid.Index(p.x, p.y, p.z);
+                        if (!valid[neighbour]) continue;
+                        for (int i = 0; i < 9; i++) {
+                            sum.c[i] += grid.Probe(neighbour).c[i];
+                        }
+                        count++;
+                    }
+
+                    if (count > 0) {
+                        for (int i = 0; i < 9; i++) {
+                            grid.Probe(index).c[i] = sum.c[i] / (float)count;
+                        }
+                        next[index] = 1;
+                    }
+                    else {
+                        missing = true;
+                    }
+                }
+            }
+        }
+        valid.swap(next);
+        if (!missing) break;
+    }
+
+    stats.probes = (unsigned int)grid.ProbeCount();
+    stats.rays = totalRays;
+    elapsed = std::chrono::steady_clock::now() - start;
+    stats.traceMilliseconds = elapsed.count();
+
+    return grid;
+}
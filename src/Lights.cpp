@@ -1,5 +1,8 @@
 #include <rendersystem/Lights.h>
 
+#include <cmath>
+#include <limits>
+
 
 PointLight PointLight::DefaultPointLight()
 {
@@ -17,33 +20,57 @@ void PointLight::SetPosition(glm::vec3 pos)
     Position = pos;
 }
 
-// TODO: this shouldn't take in an index. Create a lightingsystem class that manages lights.
-void PointLight::SetShader(const Shader& shader, int index) const
+float PointLight::Intensity() const
 {
-    auto flPrefix = struct_name + "[" + std::to_string(index) + "]";
-
-    shader.setBool(flPrefix + ".activated", true);
-    shader.setVec3(flPrefix + ".position", Position);
-    shader.setFloat(flPrefix + ".constant", Attenuation.constant);
-    shader.setFloat(flPrefix + ".linear", Attenuation.linear);
-    shader.setFloat(flPrefix + ".quadratic", Attenuation.quadratic);
-    shader.setVec3(flPrefix + ".ambient", Ambient);
-    shader.setVec3(flPrefix + ".diffuse", Diffuse);
-    shader.setVec3(flPrefix + ".specular", Specular);
+    return glm::max(glm::max(glm::max(Ambient.r, Ambient.g), Ambient.b), glm::max(
+        glm::max(glm::max(Diffuse.r, Diffuse.g), Diffuse.b),
+        glm::max(glm::max(Specular.r, Specular.g), Specular.b)));
+}
+
+float PointLight::Range(float threshold) const
+{
+    // solve intensity / (c + l*d + q*d^2) = threshold for d
+    float k = Intensity() / threshold - Attenuation.constant;
+    if (k <= 0.0f) {
+        return 0.0f;
+    }
+
+    if (Attenuation.quadratic > 0.0f) {
+        float l = Attenuation.linear;
+        float q = Attenuation.quadratic;
+        return (-l + std::sqrt(l * l + 4.0f * q * k)) / (2.0f * q);
+    }
+
+    if (Attenuation.linear > 0.0f) {
+        return k / Attenuation.linear;
+    }
+
+    // no falloff, the light reaches everything
+    return std::numeric_limits<float>::max();
+}
+
+PointLightData PointLight::Pack() const
+{
+    PointLightData data;
+    data.position = glm::vec4(Position, 1.0f);
+    data.attenuation = glm::vec4(Attenuation.constant, Attenuation.linear, Attenuation.quadratic, 0.0f);
+    data.ambient = glm::vec4(Ambient, 0.0f);
+    data.diffuse = glm::vec4(Diffuse, 0.0f);
+    data.specular = glm::vec4(Specular, 0.0f);
+    return data;
 }
 
 void DirectionalLight::SetDirection(glm::vec3 dir) {
     Direction = dir;
 }
 
-void DirectionalLight::SetShader(const Shader& shader, int index) const {
-    auto flPrefix = struct_name + "[" + std::to_string(index) + "]";
-
-    shader.setBool(flPrefix + ".activated", true);
-    shader.setVec3(flPrefix + ".direction", Direction);
-    shader.setVec3(flPrefix + ".ambient", Ambient);
-    shader.setVec3(flPrefix + ".diffuse", Diffuse);
-    shader.setVec3(flPrefix + ".specular", Specular);
+DirectionalLightData DirectionalLight::Pack() const {
+    DirectionalLightData data;
+    data.direction = glm::vec4(Direction, 0.0f);
+    data.ambient = glm::vec4(Ambient, 0.0f);
+    data.diffuse = glm::vec4(Diffuse, 0.0f);
+    data.specular = glm::vec4(Specular, 0.0f);
+    return data;
 }
 
 DirectionalLight DirectionalLight::DefaultDirectionalLight() {
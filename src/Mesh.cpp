@@ -1,46 +1,197 @@
 #include <rendersystem/Mesh.h>
+#include <rendersystem/MeshOptimizer.h>
+#include <rendersystem/Primitives.h>
 #include <rendersystem/Utils.h>
 #include <rendersystem/Shader.h>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/glm.hpp>
 
-Mesh::Mesh(std::vector<Vertex> vertices,
-    std::vector<unsigned int> indices,
-    std::vector<Texture> textures)
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    MeshFrameStats frameStats;
+    bool countFrameStats = true; // off while a Mesh::UncountedDraws lives
+
+    // drawRanges() arguments, kept to avoid reallocating every draw
+    std::vector<GeometryPool::SubRange> subRanges;
+    std::vector<GLsizei> rangeCounts;
+    std::vector<const void*> rangeOffsets;
+
+    // draws parts of the geometry's indices with one multi-draw
+    void drawRanges(const MeshGeometry& geometry, const std::vector<Meshlets::Range>& ranges) {
+        if (geometry.allocation) {
+            subRanges.clear();
+            for (auto& range : ranges) {
+                subRanges.push_back({ &geometry.allocation, range.firstIndex, range.indexCount });
+            }
+            geometry.allocation.Pool()->MultiDraw(subRanges, geometry.drawMode);
+            return;
+        }
+
+        size_t indexSize = geometry.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        rangeCounts.clear();
+        rangeOffsets.clear();
+        for (auto& range : ranges) {
+            rangeCounts.push_back((GLsizei)range.indexCount);
+            rangeOffsets.push_back((const void*)(range.firstIndex * indexSize));
+        }
+        glBindVertexArray(geometry.VAO.Get());
+        glMultiDrawElements(geometry.drawMode, rangeCounts.data(), geometry.indexType, rangeOffsets.data(), (GLsizei)rangeCounts.size());
+        glBindVertexArray(0);
+    }
+}
+
+DetailView::DetailView(const glm::vec3& cameraPosition, float fovY, float viewportHeight) :
+    cameraPosition(cameraPosition),
+    projectionScale(viewportHeight / (2.0f * std::tan(fovY * 0.5f))) {}
+
+DetailView::DetailView(const glm::vec3& cameraPosition, float fovY, float viewportHeight, const glm::mat4& viewProjection) :
+    DetailView(cameraPosition, fovY, viewportHeight)
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+    this->viewProjection = viewProjection;
+    cullMeshlets = true;
+}
+
+float DetailView::PixelsPerUnit(const BoundingSphere& bounds) const {
+    if (bounds.Unbounded()) return std::numeric_limits<float>::max();
 
-    setupMesh();
+    float distance = glm::length(bounds.center - cameraPosition) - bounds.radius;
+    if (distance <= 0.0f) return std::numeric_limits<float>::max();
+    return projectionScale / distance;
 }
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices) {
-    this->vertices = vertices;
-    this->indices = indices;
+MeshGeometry::MeshGeometry(std::vector<Vertex> vertices,
+    std::vector<unsigned int> indices,
+    unsigned int drawMode,
+    std::vector<glm::vec2> lightmapUVs,
+    VertexEncoding encoding) :
+    vertices(std::move(vertices)),
+    indices(std::move(indices)),
+    drawMode(drawMode),
+    lightmapUVs(std::move(lightmapUVs)),
+    encoding(encoding),
+    indexType(this->vertices.size() < 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT)
+{
+    // bounding sphere around the center of the vertices' box
+    glm::vec3 lo(std::numeric_limits<float>::max());
+    glm::vec3 hi(-std::numeric_limits<float>::max());
+    for (auto& v : this->vertices) {
+        lo = glm::min(lo, v.Position);
+        hi = glm::max(hi, v.Position);
+    }
+
+    localBounds = BoundingSphere(this->vertices.empty() ? glm::vec3(0.0f) : (lo + hi) * 0.5f, 0.0f);
+    for (auto& v : this->vertices) {
+        localBounds.radius = std::max(localBounds.radius, glm::length(v.Position - localBounds.center));
+    }
+
+    if (this->lightmapUVs.empty() && encoding == VertexEncoding::Float) {
+        allocation = GeometryPool::Shared(indexType).Allocate(this->vertices, this->indices);
+        return;
+    }
+
+    QuantizedMesh quantized;
+    if (encoding == VertexEncoding::Quantized) {
+        quantized = Quantization::Encode(this->vertices);
+        positionOrigin = quantized.origin;
+        positionExtent = quantized.extent;
+        quantization = quantized.report;
+    }
+
+    VAO = GLVertexArray::Create();
+    VBO = GLBuffer::Create();
+    EBO = GLBuffer::Create();
+
+    // bind the VAO then {VBO, EBO} 
+    glBindVertexArray(VAO.Get());
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.Get());
+
+    // load the vertices into the VBO
+    if (encoding == VertexEncoding::Quantized) {
+        glBufferData(GL_ARRAY_BUFFER, quantized.vertices.size() * sizeof(QuantizedVertex), quantized.vertices.data(), GL_STATIC_DRAW);
+    }
+    else {
+        glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), this->vertices.data(), GL_STATIC_DRAW);
+    }
 
-    setupMesh();
+    // load the indices into the EBO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.Get());
+    if (indexType == GL_UNSIGNED_SHORT) {
+        std::vector<uint16_t> narrowed(this->indices.begin(), this->indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrowed.size() * sizeof(uint16_t), narrowed.data(), GL_STATIC_DRAW);
+    }
+    else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(unsigned int), this->indices.data(), GL_STATIC_DRAW);
+    }
+
+    SetupAttributes(encoding);
+
+    // lightmap coords live in their own buffer so unbaked meshes don't carry them
+    if (!this->lightmapUVs.empty()) {
+        lightmapVBO = GLBuffer::Create();
+        glBindBuffer(GL_ARRAY_BUFFER, lightmapVBO.Get());
+        glBufferData(GL_ARRAY_BUFFER, this->lightmapUVs.size() * sizeof(glm::vec2), this->lightmapUVs.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    }
+
+    // unbind {EBO, VBO} then VAO
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-Mesh::Mesh(const Mesh& other) {
-    this->vertices = other.vertices;
-    this->indices = other.indices;
-    this->textures = other.textures;
+void MeshGeometry::SetupAttributes(VertexEncoding encoding) {
+    if (encoding == VertexEncoding::Quantized) {
+        // positions as unorms within the box, octahedral normals as snorms, half float
+        // texcoords. the QUANTIZED variant decodes the first two
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, TexCoords));
+        return;
+    }
 
-    this->DrawMode = other.DrawMode;
-    setupMesh();
+    // vertex positions
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    // vertex normals
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+    // vertex texture coords
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
 }
 
-ControlledMesh::ControlledMesh(const ControlledMesh& other) : Mesh(other) {
-    this->axis = other.axis;
-    this->angle = other.angle;
-    this->position = other.position;
-    this->color = other.color;
-    this->scale = other.scale;
-    this->opaque_ = other.opaque_;
+void MeshGeometry::BindDecode(const Shader& shader) const {
+    shader.setVec3("positionOrigin", positionOrigin);
+    shader.setVec3("positionExtent", positionExtent);
 }
 
+Mesh::Mesh(std::vector<Vertex> vertices,
+    std::vector<unsigned int> indices,
+    std::vector<Texture> textures,
+    VertexEncoding encoding) :
+    geometry(std::make_shared<MeshGeometry>(std::move(vertices), std::move(indices), GL_TRIANGLES,
+        std::vector<glm::vec2>(), encoding)),
+    textures(std::move(textures)) {}
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices) :
+    geometry(std::make_shared<MeshGeometry>(std::move(vertices), std::move(indices))) {}
+
+Mesh::Mesh(MeshData data, VertexEncoding encoding) :
+    geometry(std::make_shared<MeshGeometry>(std::move(data.vertices), std::move(data.indices),
+        data.strip ? GL_TRIANGLE_STRIP : GL_TRIANGLES, std::vector<glm::vec2>(), encoding)) {}
+
+Mesh::Mesh(std::shared_ptr<const MeshGeometry> geometry, std::vector<Texture> textures) :
+    geometry(std::move(geometry)),
+    textures(std::move(textures)) {}
+
 void ControlledMesh::Rotate(float degrees) {
     angle += degrees;
     if (angle > 360.0f) {
@@ -64,83 +215,225 @@ void ControlledMesh::SetPosition(const glm::vec3& pos) {
     this->position = pos;
 }
 
-void Mesh::Draw(const Shader& shader) {
+void Mesh::BindTextures(const Shader& shader) const {
     unsigned int diffuseNr = 1;
     unsigned int specularNr = 1;
 
     // naming convention:
     //  texture_specularN  => specular map
     //  texture_diffuseN   => diffuse map
+    //  texture_lightmap   => baked lighting, see SetLightmap
     for (unsigned int i = 0; i < textures.size(); i++) {
         glActiveTexture(GL_TEXTURE0 + i);
         glBindTexture(GL_TEXTURE_2D, textures[i].id);
 
-        // if textures haven't changed, this doesnt need to be done
-        if (Mesh::textures_dirty) {
-            std::string name = textures[i].type;
-            std::string num;
-            if (name == "texture_diffuse") num = std::to_string(diffuseNr++);
-            else if (name == "texture_specular") num = std::to_string(specularNr++);
-            else std::cout << "ERROR: invalid texture name " << name << std::endl;
-
-            auto prop = "material." + name + num;
-            shader.setInt(prop.c_str(), i);
+        // the shader skips the upload when the sampler already points at this unit
+        std::string name = textures[i].type;
+        std::string num;
+        if (name == "texture_diffuse") num = std::to_string(diffuseNr++);
+        else if (name == "texture_specular") num = std::to_string(specularNr++);
+        else if (name == "texture_lightmap") num = "";
+        else std::cout << "ERROR: invalid texture name " << name << std::endl;
 
-            textures_dirty = false;
-        }
+        auto prop = "material." + name + num;
+        shader.setInt(prop, i);
     }
+}
+
+void Mesh::Draw(const Shader& shader) {
+    auto& drawn = DrawnGeometry();
+    BindTextures(shader);
+    drawn.BindDecode(shader);
+    CountTriangles(drawn.Triangles(), geometry->Triangles());
 
     // now draw the mesh and unbind the VAO
-    glBindVertexArray(VAO);
-    glDrawElements(DrawMode, indices.size(), GL_UNSIGNED_INT, 0);
+    if (drawn.allocation) {
+        drawn.allocation.Pool()->Draw(drawn.allocation, drawn.drawMode);
+        return;
+    }
+    glBindVertexArray(drawn.VAO.Get());
+    glDrawElements(drawn.drawMode, drawn.indices.size(), drawn.indexType, 0);
     glBindVertexArray(0);
 }
 
-void ControlledMesh::Draw(const Shader& shader)
+void Mesh::GenerateLods(size_t minTriangles, int maxLevels) {
+    lods.clear();
+    lod = 0;
+
+    // the lightmap only covers the full mesh
+    if (!geometry->lightmapUVs.empty()) return;
+
+    MeshData data;
+    data.vertices = geometry->vertices;
+    data.indices = geometry->indices;
+    data.strip = geometry->drawMode == GL_TRIANGLE_STRIP;
+    auto levels = MeshOptimizer::BuildLods(data, minTriangles, maxLevels);
+    if (levels.size() < 2) return;
+
+    // level 0 is the geometry itself
+    lods.push_back({ geometry, 0.0f });
+    for (size_t i = 1; i < levels.size(); i++) {
+        auto& level = levels[i];
+        lods.push_back({ std::make_shared<MeshGeometry>(std::move(level.mesh.vertices), std::move(level.mesh.indices),
+            GL_TRIANGLES, std::vector<glm::vec2>(), geometry->encoding), level.error });
+    }
+}
+
+bool Mesh::SelectDetail(const DetailView& view) {
+    auto bounds = Bounds();
+    float pixels = view.PixelsPerUnit(bounds);
+    if (pixels * 2.0f * bounds.radius < view.minPixelSize) {
+        CountCulled(geometry->Triangles());
+        return false;
+    }
+
+    // errors are in model units, the bounds scale with the transform
+    float scale = LocalBounds().radius > 0.0f ? bounds.radius / LocalBounds().radius : 1.0f;
+    SelectLod(pixels * scale, view);
+    if (!CullMeshlets(view, Transform())) {
+        CountCulled(geometry->Triangles());
+        return false;
+    }
+    return true;
+}
+
+void Mesh::GenerateMeshlets() {
+    meshletsCulled = false;
+    if (geometry->drawMode == GL_TRIANGLE_STRIP) return;
+
+    MeshData data;
+    data.vertices = geometry->vertices;
+    data.indices = geometry->indices;
+    auto built = std::make_shared<Meshlets>(Meshlets::Build(data));
+    if (built->Empty()) return;
+
+    // copy on write, the triangles are reordered into the meshlets
+    geometry = std::make_shared<MeshGeometry>(std::move(data.vertices), std::move(data.indices),
+        GL_TRIANGLES, geometry->lightmapUVs, geometry->encoding);
+    if (!lods.empty()) {
+        lods[0].geometry = geometry;
+    }
+    meshlets = std::move(built);
+}
+
+bool Mesh::CullMeshlets(const DetailView& view, const glm::mat4& transform) {
+    meshletsCulled = false;
+    if (!meshlets || !view.cullMeshlets || lod != 0) return true;
+
+    // in model space, where the meshlet bounds are
+    glm::vec3 camera = glm::vec3(glm::inverse(transform) * glm::vec4(view.cameraPosition, 1.0f));
+    auto frustum = Meshlets::FrustumPlanes(view.viewProjection * transform);
+    meshletsCulled = true;
+    return meshlets->Cull(camera, frustum, visible, &frameStats.meshlets);
+}
+
+void Mesh::DrawVisible(const Shader& shader) {
+    auto ranges = VisibleRanges();
+    if (ranges == nullptr) {
+        Draw(shader);
+        return;
+    }
+
+    BindTextures(shader);
+    geometry->BindDecode(shader);
+    size_t triangles = 0;
+    for (auto& range : *ranges) {
+        triangles += range.indexCount / 3;
+    }
+    CountTriangles(triangles, geometry->Triangles());
+    if (!ranges->empty()) {
+        drawRanges(*geometry, *ranges);
+    }
+}
+
+void Mesh::SelectLod(float pixelsPerUnit, const DetailView& view) {
+    if (lods.empty()) return;
+
+    // the coarsest level under the threshold, and under it less the hysteresis margin.
+    // errors only grow with the level
+    size_t finest = 0;
+    size_t coarsest = 0;
+    for (size_t i = 1; i < lods.size(); i++) {
+        float pixels = lods[i].error * pixelsPerUnit;
+        if (pixels <= view.maxPixelError) finest = i;
+        if (pixels <= view.maxPixelError * (1.0f - view.hysteresis)) coarsest = i;
+    }
+
+    if (finest < lod) lod = finest;
+    else if (coarsest > lod) lod = coarsest;
+}
+
+const MeshFrameStats& Mesh::FrameStats() {
+    return frameStats;
+}
+
+void Mesh::ResetFrameStats() {
+    frameStats = MeshFrameStats();
+}
+
+void Mesh::CountTriangles(size_t drawn, size_t fullDetail) {
+    if (!countFrameStats) return;
+    frameStats.triangles += drawn;
+    frameStats.fullDetailTriangles += fullDetail;
+}
+
+void Mesh::CountCulled(size_t fullDetail) {
+    if (!countFrameStats) return;
+    frameStats.fullDetailTriangles += fullDetail;
+    frameStats.culled++;
+}
+
+Mesh::UncountedDraws::UncountedDraws() : counting(countFrameStats) {
+    countFrameStats = false;
+}
+
+Mesh::UncountedDraws::~UncountedDraws() {
+    countFrameStats = counting;
+}
+
+glm::mat4 ControlledMesh::modelMatrix() const
 {
-    // apply transformations
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, position);
     model = glm::scale(model, glm::vec3(scale));
     model = glm::rotate(model, (float)glm::radians(angle), axis);
+    return model;
+}
 
-    shader.setMat4("model", model);
+void ControlledMesh::bindTransform(const Shader& shader) const
+{
+    // apply transformations
+    shader.setMat4("model", modelMatrix());
     shader.setVec3("material.ambient", color);
+}
 
+void ControlledMesh::Draw(const Shader& shader)
+{
+    bindTransform(shader);
     Mesh::Draw(shader);
 }
 
-void Mesh::setupMesh()
+void ControlledMesh::DrawVisible(const Shader& shader)
 {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    // bind the VAO then {VBO, EBO} 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-    // load the vertices into the VBO
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-    // load the indices into the EBO
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-
-    // vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    // vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    // vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    bindTransform(shader);
+    Mesh::DrawVisible(shader);
+}
 
-    // unbind {EBO, VBO} then VAO
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+void Mesh::MaterialFeatures(ShaderFeatures& features) {
+    for (auto& texture : textures) {
+        if (texture.type == "texture_specular") {
+            features.specularMap = true;
+        }
+        else if (texture.type == "texture_diffuse" && texture.alpha) {
+            features.alphaTest = true;
+        }
+        else if (texture.type == "texture_lightmap") {
+            features.lightmap = true;
+        }
+    }
+    if (geometry->encoding == VertexEncoding::Quantized) {
+        features.quantized = true;
+    }
 }
 
 void ControlledMesh::AddTexture(const std::string& texture_path,
@@ -156,182 +449,106 @@ void ControlledMesh::AddTexture(const std::string& texture_path,
 
     // if not, load it
     Texture texture;
-    texture.id = Utils::TextureFromFile(texture_path, textureSettingsCallback);
+    int channels = 0;
+    texture.id = Utils::TextureFromFile(texture_path, textureSettingsCallback, &channels);
     texture.type = texture_type;
     texture.path = texture_path;
+    texture.alpha = channels == 4;
     textures.push_back(texture);
-
-    textures_dirty = true;
+    ownedTextures.push_back(std::make_shared<GLTexture>(texture.id));
 }
 
 
-ControlledMesh ControlledMesh::CreateSphere(float radius, int resolution, bool opaque) {
-    // step 1: generate vertices (incl. vertex|normal|texcoord) and indices
-    std::vector<Vertex> tmp_vertices;
-    std::vector<unsigned int> tmp_indices;
-
-    glm::vec3 r_vec = -glm::vec3(0, radius, 0); // bottom of the sphere
-
-    int divsPhi = 10;
-    int divsTheta = 20;
-
-    if (resolution >= 0) {
-        switch (resolution) {
-        case 0:
-            divsPhi = 20;
-            divsTheta = 40;
-            break;
-        case 1:
-            divsPhi = 36;
-            divsTheta = 72;
-            break;
-        default:
-            divsPhi = 90;
-            divsTheta = 180;
-            break;
-        }
+bool Mesh::SetLightmap(const Lightmap& lightmap)
+{
+    bool matches = lightmap.uvs.size() == lightmap.remap.size() &&
+        lightmap.texels.size() == (size_t)lightmap.width * lightmap.height &&
+        lightmap.width > 0 && lightmap.height > 0;
+    for (auto v : lightmap.remap) {
+        matches = matches && v < geometry->vertices.size();
+    }
+    if (!matches) {
+        std::cout << "ERROR::LIGHTMAP::MESH_MISMATCH" << std::endl;
+        return false;
     }
 
+    std::vector<Vertex> remapped;
+    remapped.reserve(lightmap.remap.size());
+    for (auto v : lightmap.remap) {
+        remapped.push_back(geometry->vertices[v]);
+    }
 
-    float rho = radius;
-    for (int l = 0; l <= divsPhi; l++) { // layer (starting at 0 at the bottom and 180/d at the top)
-        float phi = glm::radians(l * (180.0f / divsPhi));
-
-        // round sin(phi)
-        for (int t = 0; t <= divsTheta; t++) {
-            float theta = glm::radians(t  * (360.0f / divsTheta));
-            auto x = rho * sin(phi) * cos(theta);
-            auto y = rho * sin(phi) * sin(theta);
-            auto z = rho * cos(phi);
-            auto pos = glm::vec3(x, y, z);
-            auto d = - glm::normalize(pos);
-            auto u = 0.5 + std::atan2(d.x, d.z) / (2 * 3.14159);
-            auto v = 0.5 - std::asin(d.y) / 3.14159;
-
-            auto tex = glm::vec2(u, v);
-            Vertex vert(pos, pos, tex);
-            tmp_vertices.push_back(vert);
-            
-            if (l == 0 || t == divsTheta) continue;
-
-            // using triangle strip, so draw them in 'backwards N'
-            unsigned int base = l * (divsTheta + 1);
-            tmp_indices.push_back(base + t);
-            tmp_indices.push_back(base + t - divsTheta);
-            tmp_indices.push_back(base + t + 1);
-            tmp_indices.push_back(base + t - divsTheta + 1);
-        }
+    // the lightmap has triangles of its own, cut them into meshlets again
+    MeshData data;
+    data.vertices = std::move(remapped);
+    data.indices.assign(lightmap.indices.begin(), lightmap.indices.end());
+    if (meshlets) {
+        meshlets = std::make_shared<Meshlets>(Meshlets::Build(data));
+        meshletsCulled = false;
     }
 
-    auto cmesh = ControlledMesh(tmp_vertices, tmp_indices, opaque);
-    cmesh.DrawMode = GL_TRIANGLE_STRIP;
+    // copy on write, the geometry may be shared with meshes that aren't baked
+    geometry = std::make_shared<MeshGeometry>(std::move(data.vertices),
+        std::move(data.indices),
+        GL_TRIANGLES,
+        lightmap.uvs,
+        geometry->encoding);
+    lods.clear();
+    lod = 0;
+
+    auto owned = std::make_shared<GLTexture>(GLTexture::Create());
+    Texture texture;
+    texture.id = owned->Get();
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, lightmap.width, lightmap.height, 0, GL_RGB, GL_FLOAT, lightmap.texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    texture.type = "texture_lightmap";
+
+    // a second bake replaces the first
+    for (auto& t : textures) {
+        if (t.type != "texture_lightmap") continue;
+        ownedTextures.erase(std::remove_if(ownedTextures.begin(), ownedTextures.end(), [&](const std::shared_ptr<GLTexture>& o) {
+            return o->Get() == t.id;
+        }), ownedTextures.end());
+    }
+    textures.erase(std::remove_if(textures.begin(), textures.end(), [](const Texture& t) {
+        return t.type == "texture_lightmap";
+    }), textures.end());
+    textures.push_back(texture);
+    ownedTextures.push_back(std::move(owned));
 
-    return cmesh;
+    return true;
 }
 
-ControlledMesh ControlledMesh::CreateCuboid(float length, float height, float depth, bool opaque) {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-
-    auto x = glm::vec3(length/2, 0, 0);
-    auto y = glm::vec3(0, height/2, 0);
-    auto z = glm::vec3(0, 0,  depth/2);
-
-    // front face: position - z
-    auto front_and_center = -z;
-    auto back_and_center = +z;
-    std::vector<glm::vec3> tmp_vertices{
-        front_and_center - y - x, // bottom left
-        front_and_center - y + x, // bottom right
-        front_and_center + y + x, // top right
-        front_and_center + y - x, // top left
-        back_and_center - y - x, // bottom left
-        back_and_center - y + x, // bottom right
-        back_and_center + y + x, // top right
-        back_and_center + y - x // top left
-    };
-
-    // front left top right bottom back
-    std::vector<glm::vec3> normals {
-        glm::vec3(0.0f, 0.0f, -1.0f),
-        glm::vec3(-1.0f, 0.0f, 0.0f),
-        glm::vec3(0.0f, 1.0f, 0.0f),
-        glm::vec3(1.0f, 0.0f, 0.0f),
-        glm::vec3(0.0f, -1.0f, 0.0f),
-        glm::vec3(0.0f, 0.0f, 1.0f)
-    };
-
-    // front left top right bottom back
-    int base_index;
-    
-    // bl br tr tl
-    auto push_back_vertices = [&](int a, int b, int c, int d, glm::vec3 normal) {
-        vertices.push_back(Vertex(tmp_vertices[a], normal, glm::vec2(0.0f, 0.0f)));
-        vertices.push_back(Vertex(tmp_vertices[b], normal, glm::vec2(1.0f, 0.0f)));
-        vertices.push_back(Vertex(tmp_vertices[c], normal, glm::vec2(1.0f, 1.0f)));
-        vertices.push_back(Vertex(tmp_vertices[d], normal, glm::vec2(0.0f, 1.0f)));
-    };
-
-    // front left top right bottom back
-    push_back_vertices(0, 1, 2, 3, normals[0]);
-    push_back_vertices(4, 0, 3, 7, normals[1]);
-    push_back_vertices(7, 3, 2, 6, normals[2]);
-    push_back_vertices(6, 2, 1, 5, normals[3]);
-    push_back_vertices(5, 1, 0, 4, normals[4]);
-    push_back_vertices(5, 4, 7, 6, normals[5]);
-
-    for (unsigned int i = 0; i < 6; i++) {
-        indices.insert(indices.end(), {
-            i * 4 + 0,
-            i * 4 + 1,
-            i * 4 + 2,
-            i * 4 + 0,
-            i * 4 + 2,
-            i * 4 + 3
-        });
+bool Mesh::LoadLightmap(const std::string& path)
+{
+    Lightmap lightmap;
+    if (!Lightmap::Load(path, lightmap)) {
+        return false;
     }
+    return SetLightmap(lightmap);
+}
 
-    auto cmesh = ControlledMesh(vertices, indices, opaque);
-    cmesh.DrawMode = GL_TRIANGLES;
+ControlledMesh ControlledMesh::CreateSphere(float radius, int resolution, bool opaque) {
+    return ControlledMesh(Primitives::Sphere(radius, resolution), opaque);
+}
+
+ControlledMesh ControlledMesh::CreateIcosphere(float radius, int resolution, bool opaque) {
+    return ControlledMesh(Primitives::Icosphere(radius, resolution), opaque);
+}
 
-    return cmesh;
+ControlledMesh ControlledMesh::CreateCuboid(float length, float height, float depth, bool opaque) {
+    return ControlledMesh(Primitives::Cuboid(length, height, depth), opaque);
 }
 
 ControlledMesh ControlledMesh::CreateCube(float size, bool opaque) {
-    return ControlledMesh::CreateCuboid(size, size, size);
+    return ControlledMesh::CreateCuboid(size, size, size, opaque);
 }
 
 ControlledMesh ControlledMesh::CreateQuad(float length, float height, bool opaque) {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-
-    auto x = glm::vec3(length/2, 0, 0);
-    auto y = glm::vec3(0, height/2, 0);
-
-    // front side
-    auto front_norm = glm::vec3(0.0f, 0.0f, -1.0f);
-    vertices.push_back(Vertex(-x - y, front_norm, glm::vec2(0.0f, 0.0f)));
-    vertices.push_back(Vertex(x - y, front_norm, glm::vec2(1.0f, 0.0f)));
-    vertices.push_back(Vertex(x + y, front_norm, glm::vec2(1.0f, 1.0f)));
-    vertices.push_back(Vertex(-x + y, front_norm, glm::vec2(0.0f, 1.0f)));
-
-    // back side
-    auto back_norm = glm::vec3(0.0f, 0.0f, 1.0f);
-    vertices.push_back(Vertex(-x - y, back_norm, glm::vec2(0.0f, 0.0f)));
-    vertices.push_back(Vertex(x - y, back_norm, glm::vec2(1.0f, 0.0f)));
-    vertices.push_back(Vertex(x + y, back_norm, glm::vec2(1.0f, 1.0f)));
-    vertices.push_back(Vertex(-x + y, back_norm, glm::vec2(0.0f, 1.0f)));
-
-    // indices
-    indices.insert(indices.end(), {
-        0, 1, 2,
-        0, 2, 3,
-        4, 5, 6,
-        4, 6, 7
-    });
-
-    auto cmesh = ControlledMesh(vertices, indices, opaque);
-    cmesh.DrawMode = GL_TRIANGLES;
-
-    return cmesh;
+    return ControlledMesh(Primitives::Quad(length, height), opaque);
 }
\ No newline at end of file
@@ -0,0 +1,614 @@
+#include <rendersystem/MeshOptimizer.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+    // vertices are welded when all their bits match
+    struct VertexBits {
+        uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+
+        explicit VertexBits(const Vertex& vertex) {
+            std::memcpy(words, &vertex, sizeof(words));
+        }
+
+        bool operator==(const VertexBits& other) const {
+            return std::memcmp(words, other.words, sizeof(words)) == 0;
+        }
+    };
+
+    struct VertexBitsHash {
+        size_t operator()(const VertexBits& bits) const {
+            // FNV-1a over the words
+            uint64_t hash = 14695981039346656037ull;
+            for (auto word : bits.words) {
+                hash = (hash ^ word) * 1099511628211ull;
+            }
+            return (size_t)hash;
+        }
+    };
+
+    float ratio(size_t numerator, size_t denominator) {
+        return denominator == 0 ? 0.0f : (float)numerator / (float)denominator;
+    }
+
+    // triangles around every vertex: adjacency[offsets[v], offsets[v + 1])
+    void buildAdjacency(const std::vector<unsigned int>& indices, size_t vertexCount,
+        std::vector<uint32_t>& offsets, std::vector<uint32_t>& adjacency)
+    {
+        size_t triangleCount = indices.size() / 3;
+        offsets.assign(vertexCount + 1, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            offsets[indices[i] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        adjacency.resize(triangleCount * 3);
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+        }
+    }
+
+    // sum of squared distances to planes, weighted by the area of their triangles
+    struct Quadric {
+        double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+        double b2 = 0.0, bc = 0.0, bd = 0.0;
+        double c2 = 0.0, cd = 0.0;
+        double d2 = 0.0;
+        double weight = 0.0;
+
+        // the plane n.p + d = 0, n unit length
+        void AddPlane(const glm::dvec3& n, double d, double w) {
+            a2 += w * n.x * n.x; ab += w * n.x * n.y; ac += w * n.x * n.z; ad += w * n.x * d;
+            b2 += w * n.y * n.y; bc += w * n.y * n.z; bd += w * n.y * d;
+            c2 += w * n.z * n.z; cd += w * n.z * d;
+            d2 += w * d * d;
+            weight += w;
+        }
+
+        void Add(const Quadric& q) {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+            b2 += q.b2; bc += q.bc; bd += q.bd;
+            c2 += q.c2; cd += q.cd;
+            d2 += q.d2;
+            weight += q.weight;
+        }
+
+        // RMS distance of p to the planes
+        float Error(const glm::vec3& p) const {
+            if (weight <= 0.0) return 0.0f;
+            double x = p.x, y = p.y, z = p.z;
+            double sum = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+                + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+                + c2 * z * z + 2.0 * cd * z
+                + d2;
+            return (float)std::sqrt(std::max(sum / weight, 0.0));
+        }
+    };
+
+    struct PositionHash {
+        size_t operator()(const glm::vec3& p) const {
+            uint32_t words[3];
+            std::memcpy(words, &p, sizeof(words));
+            uint64_t hash = 14695981039346656037ull;
+            for (auto word : words) {
+                hash = (hash ^ word) * 1099511628211ull;
+            }
+            return (size_t)hash;
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        float error;
+    };
+}
+
+float MeshOptimizer::Stats::ACMRBefore() const {
+    return ratio(cacheMissesBefore, trianglesBefore);
+}
+
+float MeshOptimizer::Stats::ACMRAfter() const {
+    return ratio(cacheMissesAfter, trianglesAfter);
+}
+
+float MeshOptimizer::Stats::OverdrawBefore() const {
+    return ratio(shadedBefore, covered);
+}
+
+float MeshOptimizer::Stats::OverdrawAfter() const {
+    return ratio(shadedAfter, covered);
+}
+
+void MeshOptimizer::Stats::Merge(const Stats& other) {
+    meshes += other.meshes;
+    trianglesBefore += other.trianglesBefore;
+    trianglesAfter += other.trianglesAfter;
+    verticesBefore += other.verticesBefore;
+    verticesAfter += other.verticesAfter;
+    cacheMissesBefore += other.cacheMissesBefore;
+    cacheMissesAfter += other.cacheMissesAfter;
+    shadedBefore += other.shadedBefore;
+    shadedAfter += other.shadedAfter;
+    covered += other.covered;
+    milliseconds += other.milliseconds;
+}
+
+void MeshOptimizer::Stats::Print(const std::string& name) const {
+    std::cout << name << ": optimized " << meshes << " meshes in " << milliseconds << " ms, vertices "
+        << verticesBefore << " -> " << verticesAfter << ", triangles " << trianglesBefore << " -> " << trianglesAfter << std::endl;
+    std::cout << "  ACMR " << ACMRBefore() << " -> " << ACMRAfter() << ", overdraw "
+        << OverdrawBefore() << " -> " << OverdrawAfter() << std::endl;
+}
+
+void MeshOptimizer::Optimize(MeshData& mesh, Stats* stats) {
+    if (mesh.strip || mesh.indices.size() < 3) return;
+
+    if (stats != nullptr) {
+        stats->meshes++;
+        stats->trianglesBefore += mesh.indices.size() / 3;
+        stats->verticesBefore += mesh.vertices.size();
+        stats->cacheMissesBefore += CacheMisses(mesh.indices, mesh.vertices.size());
+        Overdraw(mesh, stats->shadedBefore, stats->covered);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    WeldVertices(mesh);
+    auto boundaries = OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    OptimizeOverdraw(mesh, boundaries);
+    OptimizeVertexFetch(mesh);
+    auto end = std::chrono::steady_clock::now();
+
+    if (stats != nullptr) {
+        stats->milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+        stats->trianglesAfter += mesh.indices.size() / 3;
+        stats->verticesAfter += mesh.vertices.size();
+        stats->cacheMissesAfter += CacheMisses(mesh.indices, mesh.vertices.size());
+        size_t covered = 0;
+        Overdraw(mesh, stats->shadedAfter, covered);
+    }
+}
+
+void MeshOptimizer::WeldVertices(MeshData& mesh) {
+    std::unordered_map<VertexBits, unsigned int, VertexBitsHash> unique;
+    unique.reserve(mesh.vertices.size());
+
+    std::vector<unsigned int> remap(mesh.vertices.size());
+    std::vector<Vertex> welded;
+    welded.reserve(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        auto inserted = unique.emplace(VertexBits(mesh.vertices[i]), (unsigned int)welded.size());
+        if (inserted.second) {
+            welded.push_back(mesh.vertices[i]);
+        }
+        remap[i] = inserted.first->second;
+    }
+
+    std::vector<unsigned int> indices;
+    indices.reserve(mesh.indices.size());
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        unsigned int a = remap[mesh.indices[i]];
+        unsigned int b = remap[mesh.indices[i + 1]];
+        unsigned int c = remap[mesh.indices[i + 2]];
+        if (a == b || b == c || a == c) continue;
+        indices.insert(indices.end(), { a, b, c });
+    }
+
+    mesh.vertices = std::move(welded);
+    mesh.indices = std::move(indices);
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount) {
+    std::vector<uint32_t> boundaries;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return boundaries;
+
+    // triangles around every vertex, and how many of them are still to be emitted
+    std::vector<uint32_t> offsets, adjacency;
+    buildAdjacency(indices, vertexCount, offsets, adjacency);
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        live[v] = offsets[v + 1] - offsets[v];
+    }
+
+    // a vertex is in the cache while fewer than CACHE_SIZE misses happened since its own
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t time = CACHE_SIZE + 1;
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<unsigned int> ordered;
+    ordered.reserve(triangleCount * 3);
+    size_t cursor = 0;
+
+    int64_t fanning = indices[0];
+    while (fanning >= 0) {
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t k = offsets[fanning]; k < offsets[fanning + 1]; k++) {
+            uint32_t t = adjacency[k];
+            if (emitted[t]) continue;
+            emitted[t] = true;
+
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t v = indices[t * 3 + corner];
+                ordered.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > CACHE_SIZE) {
+                    cacheTime[v] = time++;
+                }
+            }
+        }
+
+        // next: the candidate that stays in the cache longest once its fan is emitted
+        fanning = -1;
+        int64_t best = -1;
+        for (auto v : candidates) {
+            if (live[v] == 0) continue;
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= CACHE_SIZE) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > best) {
+                best = priority;
+                fanning = v;
+            }
+        }
+        if (fanning >= 0) continue;
+
+        // dead end: the walk jumps, which OptimizeOverdraw may cut a cluster at. recently
+        // used vertices first, then the next unfinished one in input order
+        boundaries.push_back((uint32_t)(ordered.size() / 3));
+        while (!deadEnd.empty() && fanning < 0) {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) fanning = v;
+        }
+        while (fanning < 0 && cursor < vertexCount) {
+            if (live[cursor] > 0) fanning = (int64_t)cursor;
+            cursor++;
+        }
+    }
+
+    indices.resize(triangleCount * 3);
+    std::copy(ordered.begin(), ordered.end(), indices.begin());
+    return boundaries;
+}
+
+void MeshOptimizer::OptimizeOverdraw(MeshData& mesh, const std::vector<uint32_t>& boundaries, size_t minCluster) {
+    size_t triangleCount = mesh.indices.size() / 3;
+
+    // clusters start at jumps of the cache order, so each keeps its own cache locality
+    std::vector<size_t> starts{ 0 };
+    for (auto boundary : boundaries) {
+        if (boundary < triangleCount && boundary - starts.back() >= minCluster) {
+            starts.push_back(boundary);
+        }
+    }
+    if (starts.size() < 2) return;
+    starts.push_back(triangleCount);
+
+    auto position = [&](size_t corner) -> const glm::vec3& {
+        return mesh.vertices[mesh.indices[corner]].Position;
+    };
+
+    // area weighted centroid and normal of every cluster, and of the whole mesh
+    size_t clusterCount = starts.size() - 1;
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+    std::vector<float> areas(clusterCount, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++) {
+        for (size_t t = starts[c]; t < starts[c + 1]; t++) {
+            auto& a = position(t * 3);
+            auto& b = position(t * 3 + 1);
+            auto& d = position(t * 3 + 2);
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+            centroids[c] += (a + b + d) * (area / 3.0f);
+            normals[c] += normal;
+            areas[c] += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += areas[c];
+    }
+    if (meshArea <= 0.0f) return;
+    meshCentroid /= meshArea;
+
+    // clusters facing away from the center are the outside, draw them first
+    std::vector<float> keys(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; c++) {
+        float length = glm::length(normals[c]);
+        if (areas[c] <= 0.0f || length <= 0.0f) continue;
+        keys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normals[c] / length);
+    }
+
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return keys[a] > keys[b];
+    });
+
+    std::vector<unsigned int> indices;
+    indices.reserve(mesh.indices.size());
+    for (auto c : order) {
+        indices.insert(indices.end(), mesh.indices.begin() + starts[c] * 3, mesh.indices.begin() + starts[c + 1] * 3);
+    }
+    mesh.indices = std::move(indices);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData& mesh) {
+    const unsigned int unused = std::numeric_limits<unsigned int>::max();
+    std::vector<unsigned int> remap(mesh.vertices.size(), unused);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (auto& index : mesh.indices) {
+        if (remap[index] == unused) {
+            remap[index] = (unsigned int)vertices.size();
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices = std::move(vertices);
+}
+
+std::vector<unsigned int> MeshOptimizer::Simplify(const MeshData& mesh, size_t targetTriangles, float* error) {
+    std::vector<unsigned int> indices = Geometry::Triangles(mesh);
+    size_t vertexCount = mesh.vertices.size();
+    float maxError = 0.0f;
+
+    // vertices at one position share a quadric. more than one vertex there is a seam
+    std::unordered_map<glm::vec3, uint32_t, PositionHash> positions;
+    std::vector<uint32_t> canonical(vertexCount);
+    std::vector<uint32_t> shared(vertexCount, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        canonical[v] = positions.emplace(mesh.vertices[v].Position, (uint32_t)v).first->second;
+        shared[canonical[v]]++;
+    }
+
+    // edges without exactly two triangles are open borders (or non-manifold)
+    std::unordered_map<uint64_t, uint32_t> edgeUse;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int e = 0; e < 3; e++) {
+            uint64_t a = canonical[indices[i + e]];
+            uint64_t b = canonical[indices[i + (e + 1) % 3]];
+            edgeUse[std::min(a, b) << 32 | std::max(a, b)]++;
+        }
+    }
+    std::vector<bool> lockedPosition(vertexCount, false);
+    for (auto& [edge, uses] : edgeUse) {
+        if (uses == 2) continue;
+        lockedPosition[edge >> 32] = true;
+        lockedPosition[edge & 0xffffffffu] = true;
+    }
+    std::vector<bool> locked(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        locked[v] = shared[canonical[v]] > 1 || lockedPosition[canonical[v]];
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        glm::dvec3 a = mesh.vertices[indices[i]].Position;
+        glm::dvec3 b = mesh.vertices[indices[i + 1]].Position;
+        glm::dvec3 c = mesh.vertices[indices[i + 2]].Position;
+        glm::dvec3 normal = glm::cross(b - a, c - a);
+        double length = glm::length(normal);
+        if (length <= 0.0) continue;
+        normal /= length;
+        for (int corner = 0; corner < 3; corner++) {
+            quadrics[canonical[indices[i + corner]]].AddPlane(normal, -glm::dot(normal, a), length * 0.5);
+        }
+    }
+
+    auto position = [&](uint32_t v) -> const glm::vec3& {
+        return mesh.vertices[v].Position;
+    };
+
+    // would moving from onto to turn a remaining triangle around from over
+    std::vector<uint32_t> offsets, adjacency;
+    auto flips = [&](const Collapse& collapse) {
+        for (uint32_t k = offsets[collapse.from]; k < offsets[collapse.from + 1]; k++) {
+            size_t t = adjacency[k] * 3;
+            glm::vec3 p[3];
+            bool collapsed = false;
+            for (int corner = 0; corner < 3; corner++) {
+                collapsed = collapsed || indices[t + corner] == collapse.to;
+                p[corner] = position(indices[t + corner]);
+            }
+            if (collapsed) continue;
+
+            glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            for (int corner = 0; corner < 3; corner++) {
+                if (indices[t + corner] == collapse.from) p[corner] = position(collapse.to);
+            }
+            glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+            if (glm::dot(before, after) <= 0.0f) return true;
+        }
+        return false;
+    };
+
+    // passes of the cheapest collapses that don't share a triangle, until the target
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertexCount);
+    std::iota(remap.begin(), remap.end(), 0);
+    std::vector<bool> touched(vertexCount);
+    while (indices.size() / 3 > targetTriangles) {
+        buildAdjacency(indices, vertexCount, offsets, adjacency);
+
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (int e = 0; e < 3; e++) {
+                uint32_t a = indices[i + e];
+                uint32_t b = indices[i + (e + 1) % 3];
+                Quadric q = quadrics[canonical[a]];
+                q.Add(quadrics[canonical[b]]);
+                if (!locked[a]) collapses.push_back({ a, b, q.Error(position(b)) });
+                if (!locked[b]) collapses.push_back({ b, a, q.Error(position(a)) });
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.error < b.error;
+        });
+
+        size_t needed = indices.size() / 3 - targetTriangles;
+        size_t removed = 0;
+        std::fill(touched.begin(), touched.end(), false);
+        for (auto& collapse : collapses) {
+            if (removed >= needed) break;
+            if (touched[collapse.from] || touched[collapse.to] || flips(collapse)) continue;
+
+            for (uint32_t k = offsets[collapse.from]; k < offsets[collapse.from + 1]; k++) {
+                size_t t = adjacency[k] * 3;
+                bool collapsed = false;
+                for (int corner = 0; corner < 3; corner++) {
+                    collapsed = collapsed || indices[t + corner] == collapse.to;
+                    touched[indices[t + corner]] = true;
+                }
+                if (collapsed) removed++;
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[canonical[collapse.to]].Add(quadrics[canonical[collapse.from]]);
+            maxError = std::max(maxError, collapse.error);
+        }
+        if (removed == 0) break;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            unsigned int a = remap[indices[i]];
+            unsigned int b = remap[indices[i + 1]];
+            unsigned int c = remap[indices[i + 2]];
+            if (a == b || b == c || a == c) continue;
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indices.resize(kept);
+    }
+
+    if (error != nullptr) {
+        *error = maxError;
+    }
+    return indices;
+}
+
+std::vector<MeshOptimizer::Lod> MeshOptimizer::BuildLods(const MeshData& mesh, size_t minTriangles, int maxLevels) {
+    std::vector<Lod> lods;
+
+    MeshData current;
+    current.vertices = mesh.vertices;
+    current.indices = Geometry::Triangles(mesh);
+    lods.push_back({ current, 0.0f });
+    float error = 0.0f;
+    for (int level = 1; level < maxLevels; level++) {
+        size_t triangles = current.indices.size() / 3;
+        if (triangles / 2 < minTriangles) break;
+
+        // each level simplifies the one before, so their errors add up
+        float levelError = 0.0f;
+        MeshData next;
+        next.indices = Simplify(current, triangles / 2, &levelError);
+        if (next.indices.size() / 3 > triangles * 85 / 100) break; // borders and seams, no real progress
+
+        next.vertices = current.vertices;
+        OptimizeVertexCache(next.indices, next.vertices.size());
+        OptimizeVertexFetch(next);
+
+        error += levelError;
+        lods.push_back({ next, error });
+        current = std::move(next);
+    }
+    return lods;
+}
+
+size_t MeshOptimizer::CacheMisses(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+    // FIFO: a vertex stays until cacheSize misses after its own
+    const size_t never = std::numeric_limits<size_t>::max();
+    std::vector<size_t> insertedAt(vertexCount, never);
+    size_t misses = 0;
+    for (auto index : indices) {
+        if (insertedAt[index] != never && misses - insertedAt[index] < cacheSize) continue;
+        insertedAt[index] = misses++;
+    }
+    return misses;
+}
+
+void MeshOptimizer::Overdraw(const MeshData& mesh, size_t& shaded, size_t& covered, int resolution) {
+    if (mesh.vertices.empty()) return;
+
+    glm::vec3 lo(std::numeric_limits<float>::max());
+    glm::vec3 hi(-std::numeric_limits<float>::max());
+    for (auto& v : mesh.vertices) {
+        lo = glm::min(lo, v.Position);
+        hi = glm::max(hi, v.Position);
+    }
+
+    std::vector<float> depth((size_t)resolution * resolution);
+    for (int axis = 0; axis < 3; axis++) {
+        for (float sign : { 1.0f, -1.0f }) {
+            // looking down -sign * axis, screen axes chosen so counter clockwise stays front
+            int u = (axis + 1) % 3;
+            int v = (axis + 2) % 3;
+            if (sign < 0.0f) std::swap(u, v);
+
+            float extent = std::max(hi[u] - lo[u], hi[v] - lo[v]);
+            if (extent <= 0.0f) continue;
+            float scale = (float)resolution / extent;
+
+            std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+            for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+                glm::vec3 p[3];
+                for (int corner = 0; corner < 3; corner++) {
+                    auto& position = mesh.vertices[mesh.indices[i + corner]].Position;
+                    p[corner] = glm::vec3((position[u] - lo[u]) * scale, (position[v] - lo[v]) * scale, -sign * position[axis]);
+                }
+
+                float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+                if (area <= 0.0f) continue; // back facing or degenerate
+
+                int x0 = std::max(0, (int)std::floor(std::min({ p[0].x, p[1].x, p[2].x })));
+                int x1 = std::min(resolution - 1, (int)std::ceil(std::max({ p[0].x, p[1].x, p[2].x })));
+                int y0 = std::max(0, (int)std::floor(std::min({ p[0].y, p[1].y, p[2].y })));
+                int y1 = std::min(resolution - 1, (int)std::ceil(std::max({ p[0].y, p[1].y, p[2].y })));
+
+                auto edge = [](const glm::vec3& a, const glm::vec3& b, float x, float y) {
+                    return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+                };
+                for (int y = y0; y <= y1; y++) {
+                    for (int x = x0; x <= x1; x++) {
+                        float cx = x + 0.5f, cy = y + 0.5f;
+                        float w0 = edge(p[1], p[2], cx, cy);
+                        float w1 = edge(p[2], p[0], cx, cy);
+                        float w2 = edge(p[0], p[1], cx, cy);
+                        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+
+                        float z = (w0 * p[0].z + w1 * p[1].z + w2 * p[2].z) / area;
+                        float& stored = depth[(size_t)y * resolution + x];
+                        if (z < stored) {
+                            stored = z;
+                            shaded++;
+                        }
+                    }
+                }
+            }
+
+            for (auto d : depth) {
+                if (d != std::numeric_limits<float>::max()) covered++;
+            }
+        }
+    }
+}
@@ -0,0 +1,322 @@
+#include <rendersystem/Meshlets.h>
+#include <rendersystem/MeshOptimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MESHLETS_SSE 1
+#endif
+
+float Meshlets::Stats::RejectionRate() const {
+    return triangles == 0 ? 0.0f : (float)trianglesRejected / (float)triangles;
+}
+
+void Meshlets::Stats::Merge(const Stats& other) {
+    meshlets += other.meshlets;
+    triangles += other.triangles;
+    backfacing += other.backfacing;
+    outside += other.outside;
+    trianglesRejected += other.trianglesRejected;
+}
+
+void Meshlets::Stats::Print(const std::string& name) const {
+    std::cout << name << ": " << meshlets << " meshlets tested, " << backfacing << " backfacing, " << outside
+        << " outside the frustum, " << trianglesRejected << " of " << triangles << " triangles rejected ("
+        << RejectionRate() * 100.0f << "%)" << std::endl;
+}
+
+Meshlets Meshlets::Build(MeshData& mesh, uint32_t maxVertices, uint32_t maxTriangles) {
+    Meshlets meshlets;
+    if (mesh.strip || mesh.indices.size() < 3) return meshlets;
+
+    size_t triangleCount = mesh.indices.size() / 3;
+    size_t vertexCount = mesh.vertices.size();
+
+    // triangles around every vertex: adjacency[offsets[v], offsets[v + 1])
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        offsets[mesh.indices[i] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        adjacency[fill[mesh.indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<glm::vec3> normals(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        auto& a = mesh.vertices[mesh.indices[t * 3]].Position;
+        auto& b = mesh.vertices[mesh.indices[t * 3 + 1]].Position;
+        auto& c = mesh.vertices[mesh.indices[t * 3 + 2]].Position;
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+    }
+
+    // a vertex is in the current meshlet when its stamp is the meshlet's
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> stamp(vertexCount, 0);
+    std::vector<uint32_t> members;
+    std::vector<unsigned int> ordered;
+    ordered.reserve(mesh.indices.size());
+    size_t seed = 0;
+    for (uint32_t current = 1;; current++) {
+        while (seed < triangleCount && emitted[seed]) seed++;
+        if (seed == triangleCount) break;
+
+        Range range{ (uint32_t)ordered.size(), 0 };
+        members.clear();
+        glm::vec3 normalSum(0.0f);
+        size_t next = seed;
+        while (true) {
+            emitted[next] = true;
+            for (int corner = 0; corner < 3; corner++) {
+                auto v = mesh.indices[next * 3 + corner];
+                ordered.push_back(v);
+                if (stamp[v] != current) {
+                    stamp[v] = current;
+                    members.push_back(v);
+                }
+            }
+            range.indexCount += 3;
+            normalSum += normals[next];
+            if (range.indexCount / 3 == maxTriangles) break;
+
+            // each new vertex costs as much as a normal at right angles to the cone
+            glm::vec3 axis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f);
+            size_t best = triangleCount;
+            float bestCost = std::numeric_limits<float>::max();
+            for (auto v : members) {
+                for (uint32_t k = offsets[v]; k < offsets[v + 1]; k++) {
+                    uint32_t t = adjacency[k];
+                    if (emitted[t]) continue;
+
+                    uint32_t added = 0;
+                    for (int corner = 0; corner < 3; corner++) {
+                        added += stamp[mesh.indices[t * 3 + corner]] != current;
+                    }
+                    if (members.size() + added > maxVertices) continue;
+
+                    float cost = (float)added + 2.0f * (1.0f - glm::dot(normals[t], axis));
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        best = t;
+                    }
+                }
+            }
+            if (best == triangleCount) break;
+            next = best;
+        }
+        meshlets.ranges.push_back(range);
+    }
+    mesh.indices = std::move(ordered);
+
+    // growing gives up the vertex cache order, restore it within every meshlet
+    std::vector<uint32_t> local(vertexCount, 0);
+    std::vector<unsigned int> localIndices;
+    std::fill(stamp.begin(), stamp.end(), 0);
+    uint32_t current = 0;
+    for (auto& range : meshlets.ranges) {
+        current++;
+        members.clear();
+        localIndices.clear();
+        for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; i++) {
+            auto v = mesh.indices[i];
+            if (stamp[v] != current) {
+                stamp[v] = current;
+                local[v] = (uint32_t)members.size();
+                members.push_back(v);
+            }
+            localIndices.push_back(local[v]);
+        }
+        MeshOptimizer::OptimizeVertexCache(localIndices, members.size());
+        for (size_t i = 0; i < localIndices.size(); i++) {
+            mesh.indices[range.firstIndex + i] = members[localIndices[i]];
+        }
+
+        meshlets.addBounds(mesh, range);
+    }
+
+    // padding: a point at the origin whose cone never faces away
+    while (meshlets.centerX.size() % 4 != 0) {
+        meshlets.centerX.push_back(0.0f);
+        meshlets.centerY.push_back(0.0f);
+        meshlets.centerZ.push_back(0.0f);
+        meshlets.radius.push_back(0.0f);
+        meshlets.axisX.push_back(0.0f);
+        meshlets.axisY.push_back(0.0f);
+        meshlets.axisZ.push_back(0.0f);
+        meshlets.cutoff.push_back(1.0f);
+    }
+    return meshlets;
+}
+
+void Meshlets::addBounds(const MeshData& mesh, const Range& range) {
+    // sphere around the center of the box
+    glm::vec3 lo(std::numeric_limits<float>::max());
+    glm::vec3 hi(-std::numeric_limits<float>::max());
+    for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; i++) {
+        auto& p = mesh.vertices[mesh.indices[i]].Position;
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    glm::vec3 center = (lo + hi) * 0.5f;
+    float r = 0.0f;
+    for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; i++) {
+        r = std::max(r, glm::length(mesh.vertices[mesh.indices[i]].Position - center));
+    }
+
+    // the cone axis is the mean face normal. the meshlet faces away once the camera is
+    // behind every triangle's plane: dot(center - camera, axis) >= cutoff * distance + radius
+    // with cutoff the sine of the widest angle to the axis. past 90 degrees never
+    std::vector<glm::vec3> normals;
+    glm::vec3 sum(0.0f);
+    for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; i += 3) {
+        auto& a = mesh.vertices[mesh.indices[i]].Position;
+        auto& b = mesh.vertices[mesh.indices[i + 1]].Position;
+        auto& c = mesh.vertices[mesh.indices[i + 2]].Position;
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        if (length <= 0.0f) continue;
+        normals.push_back(n / length);
+        sum += normals.back();
+    }
+
+    glm::vec3 axis(0.0f);
+    float sine = 1.0f;
+    float length = glm::length(sum);
+    if (length > 0.0f) {
+        axis = sum / length;
+        float minDot = 1.0f;
+        for (auto& n : normals) {
+            minDot = std::min(minDot, glm::dot(n, axis));
+        }
+        if (minDot > 0.0f) {
+            sine = std::sqrt(std::max(1.0f - minDot * minDot, 0.0f));
+        }
+    }
+
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    radius.push_back(r);
+    axisX.push_back(axis.x);
+    axisY.push_back(axis.y);
+    axisZ.push_back(axis.z);
+    cutoff.push_back(sine);
+}
+
+std::array<glm::vec4, 6> Meshlets::FrustumPlanes(const glm::mat4& m) {
+    // Gribb and Hartmann: sums and differences of the w row with the others
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++) {
+        row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+
+    std::array<glm::vec4, 6> planes = {
+        row[3] + row[0], row[3] - row[0],
+        row[3] + row[1], row[3] - row[1],
+        row[3] + row[2], row[3] - row[2] };
+    for (auto& plane : planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+    return planes;
+}
+
+bool Meshlets::Cull(const glm::vec3& cameraPosition, const std::array<glm::vec4, 6>& frustum,
+    std::vector<Range>& visible, Stats* stats) const
+{
+    visible.clear();
+
+    // bit 0 backfacing, bit 1 outside
+    auto emit = [&](size_t i, int rejected) {
+        if (stats != nullptr) {
+            stats->meshlets++;
+            stats->triangles += ranges[i].indexCount / 3;
+            if (rejected & 1) stats->backfacing++;
+            if (rejected & 2) stats->outside++;
+            if (rejected) stats->trianglesRejected += ranges[i].indexCount / 3;
+        }
+        if (rejected) return;
+
+        if (!visible.empty() && visible.back().firstIndex + visible.back().indexCount == ranges[i].firstIndex) {
+            visible.back().indexCount += ranges[i].indexCount;
+        }
+        else {
+            visible.push_back(ranges[i]);
+        }
+    };
+
+    size_t i = 0;
+#ifdef MESHLETS_SSE
+    __m128 camX = _mm_set1_ps(cameraPosition.x);
+    __m128 camY = _mm_set1_ps(cameraPosition.y);
+    __m128 camZ = _mm_set1_ps(cameraPosition.z);
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; p++) {
+        planeX[p] = _mm_set1_ps(frustum[p].x);
+        planeY[p] = _mm_set1_ps(frustum[p].y);
+        planeZ[p] = _mm_set1_ps(frustum[p].z);
+        planeW[p] = _mm_set1_ps(frustum[p].w);
+    }
+
+    for (; i + 4 <= centerX.size(); i += 4) {
+        __m128 cx = _mm_loadu_ps(&centerX[i]);
+        __m128 cy = _mm_loadu_ps(&centerY[i]);
+        __m128 cz = _mm_loadu_ps(&centerZ[i]);
+        __m128 r = _mm_loadu_ps(&radius[i]);
+
+        __m128 dx = _mm_sub_ps(cx, camX);
+        __m128 dy = _mm_sub_ps(cy, camY);
+        __m128 dz = _mm_sub_ps(cz, camZ);
+        __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        __m128 along = _mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(dx, _mm_loadu_ps(&axisX[i])),
+            _mm_mul_ps(dy, _mm_loadu_ps(&axisY[i]))),
+            _mm_mul_ps(dz, _mm_loadu_ps(&axisZ[i])));
+        __m128 backfacing = _mm_cmpge_ps(along, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&cutoff[i]), distance), r));
+
+        __m128 outside = _mm_setzero_ps();
+        __m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+        for (int p = 0; p < 6; p++) {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(cx, planeX[p]), _mm_mul_ps(cy, planeY[p])), _mm_mul_ps(cz, planeZ[p])), planeW[p]);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negR));
+        }
+
+        int backMask = _mm_movemask_ps(backfacing);
+        int outMask = _mm_movemask_ps(outside);
+        for (size_t lane = 0; lane < 4 && i + lane < ranges.size(); lane++) {
+            emit(i + lane, (backMask >> lane & 1) | (outMask >> lane & 1) << 1);
+        }
+    }
+#endif
+
+    for (; i < ranges.size(); i++) {
+        glm::vec3 center(centerX[i], centerY[i], centerZ[i]);
+        glm::vec3 d = center - cameraPosition;
+        int rejected = 0;
+        if (glm::dot(d, glm::vec3(axisX[i], axisY[i], axisZ[i])) >= cutoff[i] * glm::length(d) + radius[i]) {
+            rejected |= 1;
+        }
+        for (auto& plane : frustum) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius[i]) {
+                rejected |= 2;
+                break;
+            }
+        }
+        emit(i, rejected);
+    }
+
+    return !visible.empty();
+}
@@ -1,22 +1,175 @@
 #include <rendersystem/Model.h>
 #include <rendersystem/Utils.h>
+#include <rendersystem/MeshOptimizer.h>
 
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
-void Model::Draw(const Shader& shader)
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+	// measuring a mesh (Overdraw rasterizes it from six views, before and after) costs
+	// more than optimizing it, so loads only do it when $RS_MESH_STATS is set
+	bool measureOptimization() {
+		static bool measure = std::getenv("RS_MESH_STATS") != nullptr;
+		return measure;
+	}
+}
+
+glm::mat4 Model::modelMatrix() const
 {
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::translate(model, position);
 	model = glm::scale(model, glm::vec3(scale));
 	model = glm::rotate(model, glm::radians(angle), axis);
+	return model;
+}
+
+void Model::Draw(const Shader& shader)
+{
+	draw(shader, false);
+}
 
-	shader.setMat4("model", model);
+void Model::DrawVisible(const Shader& shader)
+{
+	draw(shader, true);
+}
+
+void Model::draw(const Shader& shader, bool visibleOnly)
+{
+	shader.setMat4("model", modelMatrix());
 	shader.setVec3("material.ambient", 0.0f, 0.0f, 0.0f);
 	shader.setFloat("material.shininess", 32.0f);
 
-	for (unsigned int i = 0; i < meshes.size(); i++) {
-		meshes[i].Draw(shader);
+	for (auto& batch : batches) {
+		auto& first = meshes[batch.meshes[0]];
+		if (batch.meshes.size() == 1) {
+			if (visibleOnly) first.DrawVisible(shader);
+			else first.Draw(shader);
+			continue;
+		}
+
+		// the levels of detail of a batch are all float geometry, but may be in either pool
+		first.BindTextures(shader);
+		first.DrawnGeometry().BindDecode(shader);
+		pending.clear();
+		for (auto i : batch.meshes) {
+			auto& mesh = meshes[i];
+			auto& geometry = mesh.DrawnGeometry();
+			auto ranges = visibleOnly ? mesh.VisibleRanges() : nullptr;
+			if (ranges == nullptr) {
+				Mesh::CountTriangles(geometry.Triangles(), mesh.SharedGeometry()->Triangles());
+				pending.push_back({ &geometry.allocation, 0, (uint32_t)geometry.indices.size() });
+				continue;
+			}
+
+			size_t triangles = 0;
+			for (auto& range : *ranges) {
+				triangles += range.indexCount / 3;
+				pending.push_back({ &geometry.allocation, range.firstIndex, range.indexCount });
+			}
+			Mesh::CountTriangles(triangles, mesh.SharedGeometry()->Triangles());
+		}
+		while (!pending.empty()) {
+			auto pool = pending[0].allocation->Pool();
+			auto rest = std::stable_partition(pending.begin(), pending.end(), [&](const GeometryPool::SubRange& range) {
+				return range.allocation->Pool() != pool;
+			});
+			samePool.assign(rest, pending.end());
+			pending.erase(rest, pending.end());
+			if (pool != nullptr) {
+				pool->MultiDraw(samePool, first.SharedGeometry()->drawMode);
+			}
+		}
+	}
+}
+
+void Model::generateLods()
+{
+	// lightmapped meshes keep their full detail, see Mesh::SetLightmap
+	size_t levels = 0;
+	for (auto& mesh : meshes) {
+		mesh.GenerateLods();
+		levels += mesh.LodCount();
+	}
+	std::cout << meshes.size() << " meshes, " << levels << " levels of detail" << std::endl;
+	lodsGenerated = true;
+}
+
+bool Model::SelectDetail(const DetailView& view)
+{
+	if (!lodsGenerated) {
+		generateLods();
+	}
+
+	size_t triangles = 0;
+	for (auto& mesh : meshes) {
+		triangles += mesh.SharedGeometry()->Triangles();
+	}
+
+	auto bounds = Bounds();
+	float pixels = view.PixelsPerUnit(bounds);
+	if (pixels * 2.0f * bounds.radius < view.minPixelSize) {
+		Mesh::CountCulled(triangles);
+		return false;
+	}
+
+	bool visible = false;
+	auto transform = modelMatrix();
+	for (auto& mesh : meshes) {
+		mesh.SelectLod(pixels * scale, view);
+		visible = mesh.CullMeshlets(view, transform) || visible;
+	}
+	if (!visible) {
+		Mesh::CountCulled(triangles);
+	}
+	return visible;
+}
+
+void Model::buildBatches()
+{
+	auto sameTextures = [](const Mesh& a, const Mesh& b) {
+		auto& ta = a.Textures();
+		auto& tb = b.Textures();
+		if (ta.size() != tb.size()) return false;
+		for (size_t i = 0; i < ta.size(); i++) {
+			if (ta[i].id != tb[i].id || ta[i].type != tb[i].type) return false;
+		}
+		return true;
+	};
+
+	batches.clear();
+	for (size_t i = 0; i < meshes.size(); i++) {
+		auto& geometry = *meshes[i].SharedGeometry();
+
+		// geometry outside the pools (lightmapped or quantized meshes) is drawn on its own
+		Batch* batch = nullptr;
+		if (geometry.allocation) {
+			for (auto& candidate : batches) {
+				auto& first = meshes[candidate.meshes[0]];
+				auto& firstGeometry = *first.SharedGeometry();
+				if (firstGeometry.allocation &&
+					firstGeometry.drawMode == geometry.drawMode &&
+					sameTextures(first, meshes[i])) {
+					batch = &candidate;
+					break;
+				}
+			}
+		}
+		if (batch == nullptr) {
+			batches.emplace_back();
+			batch = &batches.back();
+		}
+
+		batch->meshes.push_back(i);
+	}
+}
+
+void Model::MaterialFeatures(ShaderFeatures& features)
+{
+	for (auto& mesh : meshes) {
+		mesh.MaterialFeatures(features);
 	}
 }
 
@@ -38,6 +191,31 @@ void Model::loadModel(std::string path)
 
 	std::cout << "meshes processed" << std::endl;
 
+	if (!meshes.empty()) {
+		localBounds = meshes[0].LocalBounds();
+		for (auto& mesh : meshes) {
+			localBounds = localBounds.Merge(mesh.LocalBounds());
+		}
+	}
+
+	if (optimization.meshes > 0) {
+		optimization.Print(path);
+	}
+
+	for (auto& mesh : meshes) {
+		mesh.GenerateMeshlets();
+	}
+
+	buildBatches();
+	std::cout << meshes.size() << " meshes in " << batches.size() << " draw calls" << std::endl;
+
+	if (encoding == VertexEncoding::Quantized) {
+		QuantizationReport report;
+		for (auto& mesh : meshes) {
+			report.Merge(mesh.SharedGeometry()->quantization);
+		}
+		report.Print(path);
+	}
 }
 
 void Model::processNode(aiNode* node, const aiScene* scene)
@@ -62,38 +240,10 @@ void Model::processNode(aiNode* node, const aiScene* scene)
 
 Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
 {
-	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
+	// the same optimization Geometry::LoadModel applies, so baked lightmaps match
+	auto data = Geometry::FromAssimp(mesh);
+	MeshOptimizer::Optimize(data, measureOptimization() ? &optimization : nullptr);
 	std::vector<Texture> textures;
-	if (!mesh->HasNormals() || !mesh->HasPositions() || !mesh->HasTextureCoords(0)) {
-		std::cout << "Cannot Load Model, missing one of normals/positions/texturecoords" << std::endl;
-	}
-
-	auto aiVec3ToGlm = [](const aiVector3t<float>& in) {
-		return glm::vec3(in.x, in.y, in.z);
-	};
-
-	// cet vertices
-	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-		Vertex v;
-		
-		v.Position = aiVec3ToGlm(mesh->mVertices[i]);
-		v.Normal = aiVec3ToGlm(mesh->mNormals[i]);
-		v.TexCoords.x = mesh->mTextureCoords[0][i].x;
-		v.TexCoords.y = mesh->mTextureCoords[0][i].y;
-
-		vertices.push_back(v);
-	}
-		
-	// Set indices (note: guaranteed triangles due to aiProcess_Triangulate)
-	for (unsigned int i = 0; i < mesh->mNumFaces; i++)
-	{
-		aiFace face = mesh->mFaces[i];
-		for (unsigned int j = 0; j < face.mNumIndices; j++)
-		{
-			indices.push_back(face.mIndices[j]);
-		}
-	}
 
 	if (mesh->mMaterialIndex >= 0)
 	{
@@ -106,7 +256,7 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
 		textures.insert(textures.end(), specMaps.begin(), specMaps.end());
 	}
 
-	return Mesh(vertices, indices, textures);
+	return Mesh(std::move(data.vertices), std::move(data.indices), std::move(textures), encoding);
 }
 
 std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
@@ -134,16 +284,29 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
 				std::string(str.C_Str());
 
 			Texture texture;
-			texture.id = Utils::TextureFromFile(fullpath);
+			int channels = 0;
+			texture.id = Utils::TextureFromFile(fullpath, []() {}, &channels);
 			texture.type = typeName;
 			texture.path = std::string(str.C_Str());
+			texture.alpha = channels == 4;
 			textures.push_back(texture);
 			textures_loaded.push_back(texture);
+			ownedTextures.emplace_back(texture.id);
 		}
 	}
 	return textures;
 }
 
+bool Model::LoadLightmaps(const std::string& prefix)
+{
+	bool loaded = !meshes.empty();
+	for (size_t i = 0; i < meshes.size(); i++) {
+		loaded = meshes[i].LoadLightmap(prefix + "_" + std::to_string(i) + ".lightmap") && loaded;
+	}
+	buildBatches();
+	return loaded;
+}
+
 void Model::Rotate(float theta) {
 	angle += theta;
 }
\ No newline at end of file
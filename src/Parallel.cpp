@@ -0,0 +1,133 @@
+#include <rendersystem/Parallel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    thread_local bool insideFor = false;
+
+    class ThreadPool {
+    public:
+        ThreadPool() {
+            unsigned int workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+            for (unsigned int i = 0; i < workers; i++) {
+                threads.emplace_back([this]() { workerLoop(); });
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& t : threads) {
+                t.join();
+            }
+        }
+
+        unsigned int ThreadCount() const {
+            return (unsigned int)threads.size() + 1;
+        }
+
+        void Run(int begin, int end, const std::function<void(int)>& fn, int grain) {
+            // one loop at a time, the pool has a single job slot
+            std::lock_guard<std::mutex> runLock(runMutex);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job = &fn;
+                jobEnd = end;
+                jobGrain = std::max(grain, 1);
+                next = begin;
+                active = (int)threads.size();
+                generation++;
+            }
+            wake.notify_all();
+
+            work();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]() { return active == 0; });
+            job = nullptr;
+        }
+
+    private:
+        std::vector<std::thread> threads;
+        std::mutex runMutex;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        bool stopping = false;
+        unsigned long long generation = 0;
+
+        const std::function<void(int)>* job = nullptr;
+        int jobEnd = 0;
+        int jobGrain = 1;
+        std::atomic<int> next{ 0 };
+        int active = 0;
+
+        void work() {
+            insideFor = true;
+            while (true) {
+                int first = next.fetch_add(jobGrain);
+                if (first >= jobEnd) break;
+
+                int last = std::min(first + jobGrain, jobEnd);
+                for (int i = first; i < last; i++) {
+                    (*job)(i);
+                }
+            }
+            insideFor = false;
+        }
+
+        void workerLoop() {
+            unsigned long long seen = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&]() { return stopping || generation != seen; });
+                    if (stopping) return;
+                    seen = generation;
+                }
+
+                work();
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    active--;
+                }
+                done.notify_one();
+            }
+        }
+    };
+
+    ThreadPool& pool() {
+        static ThreadPool instance;
+        return instance;
+    }
+}
+
+namespace Parallel {
+    unsigned int ThreadCount() {
+        return pool().ThreadCount();
+    }
+
+    void For(int begin, int end, const std::function<void(int)>& fn, int grain) {
+        if (begin >= end) return;
+
+        if (insideFor || end - begin <= grain) {
+            for (int i = begin; i < end; i++) {
+                fn(i);
+            }
+            return;
+        }
+
+        pool().Run(begin, end, fn, grain);
+    }
+}
@@ -0,0 +1,274 @@
+#include <rendersystem/PointShadows.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+namespace {
+    // cube faces in layer order: +X, -X, +Y, -Y, +Z, -Z. colors.frag picks faces and
+    // builds their bases the same way
+    const glm::vec3 FACE_DIRS[6] = {
+        { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+    };
+    const glm::vec3 FACE_UPS[6] = {
+        { 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 }
+    };
+    const unsigned int ALL_FACES = 0x3f;
+    const float NEAR_PLANE = 0.05f;
+
+    // the cube faces of a light at the origin a sphere reaches into
+    unsigned int overlappedFaces(const glm::vec3& center, float radius, float range) {
+        if (glm::length(center) - radius > range) return 0;
+
+        // a face's frustum is bounded by the four planes where its axis stops being
+        // the major one, e.g. x >= |y| and x >= |z| for +X
+        float reach = radius * 1.41421356f;
+        unsigned int mask = 0;
+        for (int face = 0; face < 6; face++) {
+            int axis = face / 2;
+            float major = (face % 2 == 0 ? 1.0f : -1.0f) * center[axis];
+            bool inside = true;
+            for (int other = 0; other < 3 && inside; other++) {
+                if (other == axis) continue;
+                inside = major - center[other] >= -reach && major + center[other] >= -reach;
+            }
+            if (inside) mask |= 1u << face;
+        }
+        return mask;
+    }
+
+    int popcount(unsigned int mask) {
+        int count = 0;
+        for (; mask; mask &= mask - 1) count++;
+        return count;
+    }
+}
+
+PointShadows::PointShadows(const std::string& shaderDir, int atlasSize, int minTile, int maxTile) :
+    atlas(atlasSize, minTile),
+    minTile(minTile),
+    maxTile(std::min(maxTile, atlasSize)),
+    depthShader((shaderDir + "point_shadow.vert").c_str(), (shaderDir + "point_shadow.frag").c_str(), "",
+        (shaderDir + "point_shadow.geom").c_str())
+{
+    // one layer per cube face, every light uses the same tile in all six
+    depthArray = GLTexture::Create();
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray.Get());
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT16, atlasSize, atlasSize, 6, 0,
+        GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    FBO = GLFramebuffer::Create();
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO.Get());
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void PointShadows::AddCaster(std::shared_ptr<Drawable> caster) {
+    Caster entry;
+    entry.drawable = caster;
+    casters.push_back(entry);
+}
+
+int PointShadows::desiredTile(const glm::vec3& position, float range, Camera& camera, int viewportHeight) const {
+    if (range <= 0.0f) return 0;
+
+    glm::vec3 toLight = position - camera.Position;
+    float distance = glm::length(toLight);
+    if (distance <= range) return maxTile;
+
+    // lit volume entirely behind the camera
+    if (glm::dot(toLight, camera.Front) < -range) return 0;
+
+    // approximate height of the lit sphere on screen, in pixels
+    float coverage = range / (distance * std::tan(glm::radians(camera.Zoom) * 0.5f));
+    float pixels = coverage * viewportHeight;
+    if (pixels < 4.0f) return 0;
+
+    // a cube face spans a quarter turn, about half the sphere's screen size is enough
+    return std::clamp((int)(pixels * 0.5f), minTile, maxTile);
+}
+
+void PointShadows::assignSlots(const LightingSystem& lighting, Camera& camera, int viewportHeight) {
+    auto& lights = lighting.PointLights();
+
+    // (tile size, light) of the lights worth a shadow, largest first
+    std::vector<std::pair<int, int>> wanted;
+    for (int i = 0; i < (int)lights.size(); i++) {
+        int tile = desiredTile(lights[i].GetPosition(), lights[i].Range(lighting.CullThreshold()), camera, viewportHeight);
+        if (tile > 0) wanted.push_back(std::make_pair(tile, i));
+    }
+    std::sort(wanted.begin(), wanted.end(), std::greater<std::pair<int, int>>());
+    if (wanted.size() > MAX_SHADOWED_LIGHTS) wanted.resize(MAX_SHADOWED_LIGHTS);
+
+    auto wantedTile = [&](int light) {
+        for (auto& [tile, index] : wanted) {
+            if (index == light) return tile;
+        }
+        return 0;
+    };
+
+    // drop the lights that fell out of the set first, freeing their tiles
+    for (auto& slot : slots) {
+        if (slot.light >= 0 && wantedTile(slot.light) == 0) {
+            atlas.Free(slot.tile);
+            slot = Slot();
+        }
+    }
+
+    for (auto& [tile, light] : wanted) {
+        Slot* slot = nullptr;
+        for (auto& s : slots) {
+            if (s.light == light) slot = &s;
+        }
+
+        // keep the tile unless it's off by more than a factor of two, so coverage
+        // changing slightly doesn't throw the cached faces away
+        if (slot != nullptr && slot->tile.Valid() && tile < slot->tile.size * 2 && tile * 2 > slot->tile.size) {
+            continue;
+        }
+
+        if (slot == nullptr) {
+            for (auto& s : slots) {
+                if (s.light < 0) {
+                    slot = &s;
+                    break;
+                }
+            }
+        }
+        if (slot == nullptr) continue;
+
+        atlas.Free(slot->tile);
+        slot->light = light;
+        slot->tile = ShadowAtlas::Tile();
+        for (int size = tile; size >= minTile && !slot->tile.Valid(); size /= 2) {
+            slot->tile = atlas.Allocate(size);
+        }
+        slot->dirtyFaces = ALL_FACES;
+        stats.reallocated++;
+
+        if (!slot->tile.Valid()) {
+            *slot = Slot();
+        }
+    }
+
+    // a light that moved or changed range needs all of its faces again
+    for (auto& slot : slots) {
+        if (slot.light < 0) continue;
+
+        glm::vec3 position = lights[slot.light].GetPosition();
+        float range = lights[slot.light].Range(lighting.CullThreshold());
+        if (position != slot.position || range != slot.range) {
+            slot.position = position;
+            slot.range = range;
+            slot.dirtyFaces = ALL_FACES;
+        }
+        stats.lights++;
+    }
+}
+
+void PointShadows::Update(const LightingSystem& lighting, Camera& camera, int viewportHeight) {
+    stats = Stats();
+    assignSlots(lighting, camera, viewportHeight);
+
+    // faces a moving caster was in or is in now
+    for (auto& caster : casters) {
+        glm::mat4 transform = caster.drawable->Transform();
+        if (std::memcmp(&transform, &caster.transform, sizeof(glm::mat4)) == 0) continue;
+
+        BoundingSphere bounds = caster.drawable->Bounds();
+        for (auto& slot : slots) {
+            if (slot.light < 0) continue;
+            slot.dirtyFaces |= overlappedFaces(caster.bounds.center - slot.position, caster.bounds.radius, slot.range);
+            slot.dirtyFaces |= overlappedFaces(bounds.center - slot.position, bounds.radius, slot.range);
+        }
+
+        caster.transform = transform;
+        caster.bounds = bounds;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    for (auto& slot : slots) {
+        if (slot.light < 0) continue;
+
+        int dirty = popcount(slot.dirtyFaces);
+        stats.facesRendered += dirty;
+        stats.facesSkipped += 6 - dirty;
+        if (dirty > 0) {
+            render(slot);
+            slot.dirtyFaces = 0;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void PointShadows::render(Slot& slot) {
+    auto& tile = slot.tile;
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO.Get());
+
+    // clear only this light's tile, and only in the faces being redrawn
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(tile.x, tile.y, tile.size, tile.size);
+    for (int face = 0; face < 6; face++) {
+        if (!(slot.dirtyFaces & (1u << face))) continue;
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray.Get(), 0, face);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+    glDisable(GL_SCISSOR_TEST);
+
+    // then every dirty face at once, the geometry shader picks the layer
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray.Get(), 0);
+    glViewport(tile.x, tile.y, tile.size, tile.size);
+
+    depthShader.use();
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, NEAR_PLANE, slot.range);
+    for (int face = 0; face < 6; face++) {
+        glm::mat4 view = glm::lookAt(slot.position, slot.position + FACE_DIRS[face], FACE_UPS[face]);
+        depthShader.setMat4("faceMatrices[" + std::to_string(face) + "]", projection * view);
+    }
+    depthShader.setInt("faceMask", (int)slot.dirtyFaces);
+    depthShader.setVec3("lightPosition", slot.position);
+    depthShader.setFloat("farPlane", slot.range);
+
+    Mesh::UncountedDraws uncounted;
+    for (auto& caster : casters) {
+        if (overlappedFaces(caster.bounds.center - slot.position, caster.bounds.radius, slot.range) & slot.dirtyFaces) {
+            caster.drawable->Draw(depthShader);
+        }
+    }
+}
+
+void PointShadows::Bind(const Shader& shader) const {
+    glActiveTexture(GL_TEXTURE0 + SHADOW_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray.Get());
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.setInt("pointShadowAtlas", SHADOW_UNIT);
+
+    int lights[MAX_SHADOWED_LIGHTS];
+    float atlasSize = (float)atlas.Size();
+    for (int i = 0; i < MAX_SHADOWED_LIGHTS; i++) {
+        auto& slot = slots[i];
+        lights[i] = slot.light;
+        if (slot.light < 0) continue;
+
+        auto index = "[" + std::to_string(i) + "]";
+        shader.setVec3("pointShadowTiles" + index, glm::vec3(slot.tile.x, slot.tile.y, slot.tile.size) / atlasSize);
+        shader.setFloat("pointShadowFar" + index, slot.range);
+    }
+    shader.setIntArray("pointShadowLights", lights, MAX_SHADOWED_LIGHTS);
+}
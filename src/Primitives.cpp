@@ -0,0 +1,93 @@
+#include <rendersystem/Primitives.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <tuple>
+
+namespace {
+    enum class Shape { Sphere, Icosphere, Cuboid, Quad };
+
+    struct Key {
+        Shape shape;
+        float dimensions[3];
+        int resolution;
+
+        bool operator<(const Key& other) const {
+            return std::tie(shape, dimensions[0], dimensions[1], dimensions[2], resolution) <
+                std::tie(other.shape, other.dimensions[0], other.dimensions[1], other.dimensions[2], other.resolution);
+        }
+    };
+
+    // weak, so the cache never keeps geometry (and its GL buffers) alive by itself
+    std::map<Key, std::weak_ptr<const MeshGeometry>> cache;
+
+    Primitives::Stats stats;
+
+    std::shared_ptr<const MeshGeometry> get(const Key& key, const std::function<MeshData()>& generate) {
+        stats.requests++;
+
+        auto& entry = cache[key];
+        if (auto geometry = entry.lock()) {
+            return geometry;
+        }
+
+        auto data = generate();
+        auto geometry = std::make_shared<const MeshGeometry>(std::move(data.vertices), std::move(data.indices),
+            data.strip ? GL_TRIANGLE_STRIP : GL_TRIANGLES);
+        entry = geometry;
+        stats.created++;
+
+        // drop the entries of shapes nobody uses any more
+        for (auto it = cache.begin(); it != cache.end();) {
+            if (it->second.expired()) it = cache.erase(it);
+            else ++it;
+        }
+        return geometry;
+    }
+
+    // Sphere() resolutions 0, 1 and 2+ are matched in deviation from the true sphere
+    // by 3, 4 and 5 subdivisions
+    int subdivisions(int resolution) {
+        if (resolution <= 0) return 3;
+        if (resolution == 1) return 4;
+        return 5;
+    }
+}
+
+namespace Primitives {
+    std::shared_ptr<const MeshGeometry> Sphere(float radius, int resolution) {
+        // all resolutions above 2, and all below 0, generate the same sphere
+        resolution = std::clamp(resolution, -1, 2);
+        return get({ Shape::Sphere, { radius, 0.0f, 0.0f }, resolution }, [&]() {
+            return Geometry::Sphere(radius, resolution);
+        });
+    }
+
+    std::shared_ptr<const MeshGeometry> Icosphere(float radius, int resolution) {
+        int levels = subdivisions(resolution);
+        return get({ Shape::Icosphere, { radius, 0.0f, 0.0f }, levels }, [&]() {
+            return Geometry::Icosphere(radius, levels);
+        });
+    }
+
+    std::shared_ptr<const MeshGeometry> Cuboid(float length, float height, float depth) {
+        return get({ Shape::Cuboid, { length, height, depth }, 0 }, [&]() {
+            return Geometry::Cuboid(length, height, depth);
+        });
+    }
+
+    std::shared_ptr<const MeshGeometry> Quad(float length, float height) {
+        return get({ Shape::Quad, { length, height, 0.0f }, 0 }, [&]() {
+            return Geometry::Quad(length, height);
+        });
+    }
+
+    const Stats& GetStats() {
+        return stats;
+    }
+
+    void ResetStats() {
+        stats = Stats();
+    }
+}
@@ -0,0 +1,155 @@
+#include <rendersystem/ProbeGrid.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    struct ProbeGridHeader {
+        char magic[4];
+        uint32_t version;
+        float lo[3];
+        float hi[3];
+        int32_t counts[3];
+    };
+
+    const char PROBE_GRID_MAGIC[4] = { 'R', 'S', 'P', 'G' };
+    const uint32_t PROBE_GRID_VERSION = 1;
+
+    const char* SH_UNIFORMS[9] = {
+        "shIrradiance[0]", "shIrradiance[1]", "shIrradiance[2]",
+        "shIrradiance[3]", "shIrradiance[4]", "shIrradiance[5]",
+        "shIrradiance[6]", "shIrradiance[7]", "shIrradiance[8]"
+    };
+}
+
+void SH9::Basis(const glm::vec3& d, float out[9])
+{
+    out[0] = 0.282095f;
+    out[1] = 0.488603f * d.y;
+    out[2] = 0.488603f * d.z;
+    out[3] = 0.488603f * d.x;
+    out[4] = 1.092548f * d.x * d.y;
+    out[5] = 1.092548f * d.y * d.z;
+    out[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+    out[7] = 1.092548f * d.x * d.z;
+    out[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+}
+
+glm::vec3 SH9::Evaluate(const glm::vec3& normal) const
+{
+    float basis[9];
+    Basis(normal, basis);
+
+    glm::vec3 result(0.0f);
+    for (int i = 0; i < 9; i++) {
+        result += c[i] * basis[i];
+    }
+    return glm::max(result, glm::vec3(0.0f));
+}
+
+ProbeGrid::ProbeGrid(const glm::vec3& lo, const glm::vec3& hi, const glm::ivec3& counts) :
+    lo(lo),
+    hi(hi),
+    counts(glm::max(counts, glm::ivec3(1))),
+    probes((size_t)this->counts.x * this->counts.y * this->counts.z) {}
+
+glm::vec3 ProbeGrid::ProbePosition(int x, int y, int z) const
+{
+    auto steps = glm::max(glm::vec3(counts - 1), glm::vec3(1.0f));
+    return lo + (hi - lo) * (glm::vec3(x, y, z) / steps);
+}
+
+SH9 ProbeGrid::Sample(const glm::vec3& position) const
+{
+    SH9 result;
+    if (probes.empty()) return result;
+
+    // position in probe units, clamped so objects outside the box use the border probes
+    auto steps = glm::max(glm::vec3(counts - 1), glm::vec3(1.0f));
+    auto extent = glm::max(hi - lo, glm::vec3(1e-6f));
+    auto g = glm::clamp((position - lo) / extent * steps, glm::vec3(0.0f), glm::vec3(counts - 1));
+    auto base = glm::min(glm::ivec3(g), glm::max(counts - 2, glm::ivec3(0)));
+    auto f = g - glm::vec3(base);
+
+    for (int corner = 0; corner < 8; corner++) {
+        glm::ivec3 offset(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+        auto p = glm::min(base + offset, counts - 1);
+        float w = (offset.x ? f.x : 1.0f - f.x) *
+            (offset.y ? f.y : 1.0f - f.y) *
+            (offset.z ? f.z : 1.0f - f.z);
+        if (w == 0.0f) continue;
+
+        auto& probe = probes[Index(p.x, p.y, p.z)];
+        for (int i = 0; i < 9; i++) {
+            result.c[i] += probe.c[i] * w;
+        }
+    }
+    return result;
+}
+
+void ProbeGrid::Bind(const Shader& shader, const glm::vec3& position) const
+{
+    auto sh = Sample(position);
+    for (int i = 0; i < 9; i++) {
+        shader.setVec3(SH_UNIFORMS[i], sh.c[i]);
+    }
+}
+
+bool ProbeGrid::Save(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cout << "ERROR::PROBE_GRID::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+
+    ProbeGridHeader header;
+    std::copy(PROBE_GRID_MAGIC, PROBE_GRID_MAGIC + 4, header.magic);
+    header.version = PROBE_GRID_VERSION;
+    for (int i = 0; i < 3; i++) {
+        header.lo[i] = lo[i];
+        header.hi[i] = hi[i];
+        header.counts[i] = counts[i];
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(probes.data()), probes.size() * sizeof(SH9));
+    if (!file) {
+        std::cout << "ERROR::PROBE_GRID::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ProbeGrid::Load(const std::string& path, ProbeGrid& out)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    ProbeGridHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    bool valid = file &&
+        std::equal(header.magic, header.magic + 4, PROBE_GRID_MAGIC) &&
+        header.version == PROBE_GRID_VERSION &&
+        header.counts[0] > 0 && header.counts[1] > 0 && header.counts[2] > 0;
+
+    ProbeGrid grid;
+    if (valid) {
+        grid = ProbeGrid(glm::vec3(header.lo[0], header.lo[1], header.lo[2]),
+            glm::vec3(header.hi[0], header.hi[1], header.hi[2]),
+            glm::ivec3(header.counts[0], header.counts[1], header.counts[2]));
+        file.read(reinterpret_cast<char*>(grid.probes.data()), grid.probes.size() * sizeof(SH9));
+        valid = (bool)file;
+    }
+
+    if (!valid) {
+        std::cout << "ERROR::PROBE_GRID::INVALID_FILE " << path << std::endl;
+        return false;
+    }
+
+    out = std::move(grid);
+    return true;
+}
@@ -0,0 +1,147 @@
+#include <rendersystem/QuantizedVertex.h>
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace {
+    const float UNORM16_MAX = 65535.0f;
+    const float SNORM16_MAX = 32767.0f;
+
+    float snorm16(int16_t value) {
+        return std::max((float)value / SNORM16_MAX, -1.0f);
+    }
+
+    float signNotZero(float value) {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+}
+
+void QuantizationReport::Merge(const QuantizationReport& other) {
+    vertices += other.vertices;
+    floatBytes += other.floatBytes;
+    quantizedBytes += other.quantizedBytes;
+    maxPositionError = std::max(maxPositionError, other.maxPositionError);
+    maxRelativeError = std::max(maxRelativeError, other.maxRelativeError);
+    maxNormalError = std::max(maxNormalError, other.maxNormalError);
+    maxTexCoordError = std::max(maxTexCoordError, other.maxTexCoordError);
+}
+
+void QuantizationReport::Print(const std::string& name) const {
+    std::cout << name << ": " << vertices << " quantized vertices, " << floatBytes / 1024 << " KiB -> "
+        << quantizedBytes / 1024 << " KiB (" << (floatBytes - quantizedBytes) / 1024 << " KiB saved)" << std::endl;
+    std::cout << "  max error: position " << maxPositionError << " (" << maxRelativeError * 100.0f << "% of the box), normal "
+        << maxNormalError << " deg, texcoords " << maxTexCoordError << std::endl;
+}
+
+glm::vec2 Quantization::OctahedralEncode(const glm::vec3& normal) {
+    float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (l1 < std::numeric_limits<float>::epsilon()) {
+        return glm::vec2(0.0f);
+    }
+
+    // project onto the octahedron, then fold the lower half over the diagonals
+    glm::vec3 n = normal / l1;
+    glm::vec2 encoded(n.x, n.y);
+    if (n.z < 0.0f) {
+        encoded = glm::vec2((1.0f - std::abs(n.y)) * signNotZero(n.x), (1.0f - std::abs(n.x)) * signNotZero(n.y));
+    }
+    return encoded;
+}
+
+glm::vec3 Quantization::OctahedralDecode(const glm::vec2& encoded) {
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+Vertex Quantization::Decode(const QuantizedVertex& vertex, const glm::vec3& origin, const glm::vec3& extent) {
+    Vertex decoded;
+    glm::vec3 unorm(vertex.Position[0], vertex.Position[1], vertex.Position[2]);
+    decoded.Position = origin + extent * (unorm / UNORM16_MAX);
+    decoded.Normal = OctahedralDecode(glm::vec2(snorm16(vertex.Normal[0]), snorm16(vertex.Normal[1])));
+    decoded.TexCoords = glm::vec2(glm::unpackHalf1x16(vertex.TexCoords[0]), glm::unpackHalf1x16(vertex.TexCoords[1]));
+    return decoded;
+}
+
+QuantizedMesh Quantization::Encode(const std::vector<Vertex>& vertices) {
+    QuantizedMesh mesh;
+    if (vertices.empty()) return mesh;
+
+    glm::vec3 lo(std::numeric_limits<float>::max());
+    glm::vec3 hi(-std::numeric_limits<float>::max());
+    for (auto& v : vertices) {
+        lo = glm::min(lo, v.Position);
+        hi = glm::max(hi, v.Position);
+    }
+    mesh.origin = lo;
+    mesh.extent = hi - lo;
+
+    mesh.vertices.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        auto& v = vertices[i];
+        auto& q = mesh.vertices[i];
+
+        for (int axis = 0; axis < 3; axis++) {
+            float t = mesh.extent[axis] > 0.0f ? (v.Position[axis] - lo[axis]) / mesh.extent[axis] : 0.0f;
+            q.Position[axis] = (uint16_t)std::lround(std::clamp(t, 0.0f, 1.0f) * UNORM16_MAX);
+        }
+
+        // rounding each component on its own isn't always closest on the sphere, so try
+        // the four neighbouring encodings and keep the closest. compared by distance, the
+        // dot products of neighbours are equal in float
+        glm::vec2 octahedral = Quantization::OctahedralEncode(v.Normal) * SNORM16_MAX;
+        glm::vec2 base = glm::floor(octahedral);
+        float length = glm::length(v.Normal);
+        glm::vec3 normal = length > 0.0f ? v.Normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        float best = std::numeric_limits<float>::max();
+        for (int corner = 0; corner < 4; corner++) {
+            int16_t x = (int16_t)std::clamp(base.x + (float)(corner & 1), -SNORM16_MAX, SNORM16_MAX);
+            int16_t y = (int16_t)std::clamp(base.y + (float)(corner >> 1), -SNORM16_MAX, SNORM16_MAX);
+            glm::vec3 offset = Quantization::OctahedralDecode(glm::vec2(snorm16(x), snorm16(y))) - normal;
+            float distance = glm::dot(offset, offset);
+            if (distance < best) {
+                best = distance;
+                q.Normal[0] = x;
+                q.Normal[1] = y;
+            }
+        }
+
+        q.TexCoords[0] = glm::packHalf1x16(v.TexCoords.x);
+        q.TexCoords[1] = glm::packHalf1x16(v.TexCoords.y);
+    }
+
+    // measure what the shader will see
+    auto& report = mesh.report;
+    report.vertices = vertices.size();
+    report.floatBytes = vertices.size() * sizeof(Vertex);
+    report.quantizedBytes = mesh.vertices.size() * sizeof(QuantizedVertex);
+    float size = std::max(std::max(mesh.extent.x, mesh.extent.y), mesh.extent.z);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        auto& v = vertices[i];
+        auto decoded = Decode(mesh.vertices[i], mesh.origin, mesh.extent);
+
+        float positionError = glm::length(decoded.Position - v.Position);
+        report.maxPositionError = std::max(report.maxPositionError, positionError);
+        if (size > 0.0f) {
+            report.maxRelativeError = std::max(report.maxRelativeError, positionError / size);
+        }
+
+        // meshes without normals have zero vectors there, nothing to compare
+        float length = glm::length(v.Normal);
+        if (length > 0.0f) {
+            // from the chord, acos of a dot this close to 1 is all float rounding
+            float chord = std::min(glm::length(decoded.Normal - v.Normal / length), 2.0f);
+            report.maxNormalError = std::max(report.maxNormalError, glm::degrees(2.0f * std::asin(chord * 0.5f)));
+        }
+
+        glm::vec2 texCoordError = glm::abs(decoded.TexCoords - v.TexCoords);
+        report.maxTexCoordError = std::max(report.maxTexCoordError, std::max(texCoordError.x, texCoordError.y));
+    }
+    return mesh;
+}
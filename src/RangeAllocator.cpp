@@ -0,0 +1,95 @@
+#include <rendersystem/RangeAllocator.h>
+
+RangeAllocator::RangeAllocator(uint32_t capacity)
+{
+    Reset(capacity, 0);
+}
+
+void RangeAllocator::insertFree(uint32_t offset, uint32_t size) {
+    byOffset[offset] = size;
+    bySize.insert({ size, offset });
+}
+
+void RangeAllocator::eraseFree(std::map<uint32_t, uint32_t>::iterator block) {
+    auto sized = bySize.equal_range(block->second);
+    for (auto it = sized.first; it != sized.second; ++it) {
+        if (it->second == block->first) {
+            bySize.erase(it);
+            break;
+        }
+    }
+    byOffset.erase(block);
+}
+
+uint32_t RangeAllocator::Allocate(uint32_t size) {
+    if (size == 0) return NONE;
+
+    auto best = bySize.lower_bound(size);
+    if (best == bySize.end()) return NONE;
+
+    uint32_t offset = best->second;
+    uint32_t blockSize = best->first;
+    bySize.erase(best);
+    byOffset.erase(offset);
+
+    // the rest of the block stays free
+    if (blockSize > size) {
+        insertFree(offset + size, blockSize - size);
+    }
+    used += size;
+    return offset;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t size) {
+    if (size == 0) return;
+    used -= size;
+
+    // merge with the free blocks right after and right before
+    auto next = byOffset.lower_bound(offset);
+    if (next != byOffset.end() && next->first == offset + size) {
+        size += next->second;
+        eraseFree(next);
+    }
+
+    auto prev = byOffset.lower_bound(offset);
+    if (prev != byOffset.begin()) {
+        --prev;
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            eraseFree(prev);
+        }
+    }
+
+    insertFree(offset, size);
+}
+
+void RangeAllocator::Grow(uint32_t newCapacity) {
+    if (newCapacity <= capacity) return;
+
+    uint32_t oldCapacity = capacity;
+    capacity = newCapacity;
+
+    // Free() merges the new tail with a free block ending at the old capacity
+    used += newCapacity - oldCapacity;
+    Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+void RangeAllocator::Reset(uint32_t capacity, uint32_t used) {
+    this->capacity = capacity;
+    this->used = used;
+    byOffset.clear();
+    bySize.clear();
+    if (capacity > used) {
+        insertFree(used, capacity - used);
+    }
+}
+
+uint32_t RangeAllocator::LargestFree() const {
+    return bySize.empty() ? 0 : bySize.rbegin()->first;
+}
+
+float RangeAllocator::Fragmentation() const {
+    uint32_t free = capacity - used;
+    return free == 0 ? 0.0f : 1.0f - (float)LargestFree() / (float)free;
+}
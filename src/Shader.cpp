@@ -1,6 +1,8 @@
 #include <glad/glad.h> // include glad to get all the required OpenGL headers
 
 #include <rendersystem/Shader.h>
+#include <rendersystem/ShaderCache.h>
+#include <rendersystem/UniformBlocks.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -9,16 +11,75 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
-    // 1. retrieve the vertex/fragment source code from filePath
+// GL_KHR_parallel_shader_compile, not part of the generated loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines, const char* geometryPath) {
+    beginBuild(vertexPath, fragmentPath, defines, geometryPath);
+    Poll(true);
+}
+
+std::shared_ptr<Shader> Shader::BuildAsync(const char* vertexPath, const char* fragmentPath, const std::string& defines, const char* geometryPath) {
+    auto shader = std::shared_ptr<Shader>(new Shader());
+    shader->beginBuild(vertexPath, fragmentPath, defines, geometryPath);
+    return shader;
+}
+
+namespace {
+    // inserts the defines right after the #version directive, which has to stay first
+    std::string injectDefines(const std::string& code, const std::string& defines) {
+        if (defines.empty()) return code;
+
+        size_t insertAt = 0;
+        auto version = code.find("#version");
+        if (version != std::string::npos) {
+            auto eol = code.find('\n', version);
+            insertAt = eol == std::string::npos ? code.size() : eol + 1;
+        }
+
+        auto result = code.substr(0, insertAt);
+        if (!result.empty() && result.back() != '\n') result += '\n';
+        result += defines;
+        if (defines.back() != '\n') result += '\n';
+        result += code.substr(insertAt);
+        return result;
+    }
+}
+
+bool Shader::ParallelCompileSupported() {
+    static const bool supported = []() {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            auto ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (ext && (std::strcmp(ext, "GL_KHR_parallel_shader_compile") == 0 ||
+                        std::strcmp(ext, "GL_ARB_parallel_shader_compile") == 0)) {
+                return true;
+            }
+        }
+        return false;
+    }();
+    return supported;
+}
+
+void Shader::beginBuild(const char* vertexPath, const char* fragmentPath, const std::string& defines, const char* geometryPath) {
+    // 1. retrieve the vertex/fragment (and geometry) source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
+    std::string geometryCode;
     std::ifstream vShaderFile;
     std::ifstream fShaderFile;
+    std::ifstream gShaderFile;
     // ensure ifstream objects can throw exceptions:
     vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     try
     {
         // open files
@@ -34,85 +95,466 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         // convert stream into string
         vertexCode = vShaderStream.str();
         fragmentCode = fShaderStream.str();
+
+        if (geometryPath != nullptr) {
+            gShaderFile.open(geometryPath);
+            std::stringstream gShaderStream;
+            gShaderStream << gShaderFile.rdbuf();
+            gShaderFile.close();
+            geometryCode = gShaderStream.str();
+        }
     }
     catch (std::ifstream::failure e)
     {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
     }
+
+    vertexCode = injectDefines(vertexCode, defines);
+    fragmentCode = injectDefines(fragmentCode, defines);
+    if (!geometryCode.empty()) geometryCode = injectDefines(geometryCode, defines);
+
+    // 2. load the program from the binary cache, or kick off a build from source
+    pending.start = std::chrono::steady_clock::now();
+    pending.key = ShaderCache::Key(vertexCode, fragmentCode, geometryCode);
+
+    program = std::make_shared<GLProgram>(GLProgram::Create());
+    ID = program->Get();
+    pending.cached = ShaderCache::Load(ID, pending.key);
+    if (!pending.cached) {
+        // a rejected binary can leave the program in an unusable state, start over
+        program = std::make_shared<GLProgram>(GLProgram::Create());
+        ID = program->Get();
+
+        compileAndLink(vertexCode, fragmentCode, geometryCode);
+    }
+}
+
+void Shader::compileAndLink(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode) {
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
 
-    // 2. compile shaders
-    unsigned int vertex, fragment;
-    int success;
-    char infoLog[512];
+    // only submit the work here: querying the status would wait for the driver to
+    // finish, which is deferred to finishBuild so the compiles can run in parallel
+    pending.vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(pending.vertex, 1, &vShaderCode, NULL);
+    glCompileShader(pending.vertex);
 
-    // vertex Shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    // print compile errors if any
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    };
-
-    // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    // print compile errors if any
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    };
-
-    // shader Program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
+    pending.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(pending.fragment, 1, &fShaderCode, NULL);
+    glCompileShader(pending.fragment);
+
+    if (!geometryCode.empty()) {
+        const char* gShaderCode = geometryCode.c_str();
+        pending.geometry = glCreateShader(GL_GEOMETRY_SHADER);
+        glShaderSource(pending.geometry, 1, &gShaderCode, NULL);
+        glCompileShader(pending.geometry);
+    }
+
+    // shader Program, keeping the binary retrievable for the cache
+    // (null without ARB_get_program_binary, like glProgramBinary in ShaderCache)
+    if (glProgramParameteri != nullptr) {
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(ID, pending.vertex);
+    glAttachShader(ID, pending.fragment);
+    if (pending.geometry != 0) glAttachShader(ID, pending.geometry);
     glLinkProgram(ID);
-    // print linking errors if any
-    glGetProgramiv(ID, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(ID, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+}
+
+bool Shader::Poll(bool allowBlocking) {
+    if (status != BuildStatus::Pending) {
+        return true;
+    }
+
+    // binaries from the cache are linked as soon as glProgramBinary returns
+    if (!pending.cached && !allowBlocking) {
+        if (!ParallelCompileSupported()) {
+            return false;
+        }
+
+        GLint done = GL_FALSE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+        if (!done) {
+            return false;
+        }
+    }
+
+    finishBuild();
+    return true;
+}
+
+void Shader::finishBuild() {
+    int success = 1;
+    char infoLog[512];
+
+    if (!pending.cached) {
+        // print compile errors if any
+        glGetShaderiv(pending.vertex, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(pending.vertex, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        };
+
+        glGetShaderiv(pending.fragment, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(pending.fragment, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        };
+
+        if (pending.geometry != 0) {
+            glGetShaderiv(pending.geometry, GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                glGetShaderInfoLog(pending.geometry, 512, NULL, infoLog);
+                std::cout << "ERROR::SHADER::GEOMETRY::COMPILATION_FAILED\n" << infoLog << std::endl;
+            };
+        }
+
+        // print linking errors if any
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glGetProgramInfoLog(ID, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        }
+        else {
+            ShaderCache::Store(ID, pending.key);
+        }
+
+        // delete the shaders as they're linked into our program now and no longer necessary
+        glDeleteShader(pending.vertex);
+        glDeleteShader(pending.fragment);
+        if (pending.geometry != 0) glDeleteShader(pending.geometry);
+        pending.vertex = pending.fragment = pending.geometry = 0;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - pending.start;
+    ShaderCache::RecordBuildTime(pending.cached, elapsed.count());
+
+    status = success ? BuildStatus::Ready : BuildStatus::Failed;
+    reflectUniforms();
+}
+
+void Shader::reflectUniforms() {
+    uniforms.clear();
+    uniformSlots.clear();
+
+    int count = 0;
+    int maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> nameBuffer(maxLength > 0 ? maxLength : 1);
+    for (int i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, i, maxLength, &length, &size, &type, nameBuffer.data());
+
+        std::string name(nameBuffer.data(), length);
+        GLint loc = glGetUniformLocation(ID, name.c_str());
+
+        // members of uniform blocks have no location, they're fed through buffers
+        if (loc < 0) continue;
+
+        // arrays of basic types are reported once as "name[0]". register the bare name
+        // and every element so "name", "name[0]" ... "name[size-1]" all resolve
+        auto bracket = name.find("[0]");
+        if (bracket != std::string::npos && bracket + 3 == name.size()) {
+            auto base = name.substr(0, bracket);
+            for (int e = 0; e < size; e++) {
+                auto element = base + "[" + std::to_string(e) + "]";
+                GLint elementLoc = e == 0 ? loc : glGetUniformLocation(ID, element.c_str());
+
+                uniformSlots[element] = (int)uniforms.size();
+                if (e == 0) uniformSlots[base] = (int)uniforms.size();
+                uniforms.push_back(UniformInfo{ element, elementLoc, type, size - e });
+            }
+        }
+        else {
+            uniformSlots[name] = (int)uniforms.size();
+            uniforms.push_back(UniformInfo{ name, loc, type, size });
+        }
+    }
+
+    // nothing has been written through this object yet, the first set always uploads
+    shadow.assign(uniforms.size(), UniformShadow());
+
+    // point the shared uniform blocks at their fixed binding points
+    int blockCount = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    for (int i = 0; i < blockCount; i++) {
+        GLint nameLength = 0;
+        glGetActiveUniformBlockiv(ID, i, GL_UNIFORM_BLOCK_NAME_LENGTH, &nameLength);
+
+        std::vector<char> blockName(nameLength > 0 ? nameLength : 1);
+        glGetActiveUniformBlockName(ID, i, (GLsizei)blockName.size(), nullptr, blockName.data());
+
+        GLuint binding = UniformBlocks::Binding(blockName.data());
+        if (binding != GL_INVALID_INDEX) {
+            glUniformBlockBinding(ID, i, binding);
+        }
+    }
+}
+
+int Shader::FindUniform(const std::string& name) const {
+    auto it = uniformSlots.find(name);
+    return it == uniformSlots.end() ? -1 : it->second;
+}
+
+namespace {
+    // whether a GLSL uniform of type glType can be written with a value of type T
+    template <typename T> bool uniformTypeMatches(GLenum glType);
+
+    template <> bool uniformTypeMatches<bool>(GLenum glType) {
+        return glType == GL_BOOL || glType == GL_INT;
+    }
+
+    template <> bool uniformTypeMatches<int>(GLenum glType) {
+        switch (glType) {
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_BUFFER:
+        case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    template <> bool uniformTypeMatches<float>(GLenum glType) {
+        return glType == GL_FLOAT;
+    }
+
+    template <> bool uniformTypeMatches<glm::vec3>(GLenum glType) {
+        return glType == GL_FLOAT_VEC3;
+    }
+
+    template <> bool uniformTypeMatches<glm::mat4>(GLenum glType) {
+        return glType == GL_FLOAT_MAT4;
     }
+}
+
+template <typename T>
+Uniform<T> Shader::uniform(const std::string& name) const {
+    Uniform<T> u;
+    u.slot = FindUniform(name);
+
+    if (u.valid() && !uniformTypeMatches<T>(uniforms[u.slot].type)) {
+        std::cout << "WARNING::SHADER::UNIFORM_TYPE_MISMATCH " << name << std::endl;
+    }
+
+    return u;
+}
+
+template Uniform<bool> Shader::uniform<bool>(const std::string& name) const;
+template Uniform<int> Shader::uniform<int>(const std::string& name) const;
+template Uniform<float> Shader::uniform<float>(const std::string& name) const;
+template Uniform<glm::vec3> Shader::uniform<glm::vec3>(const std::string& name) const;
+template Uniform<glm::mat4> Shader::uniform<glm::mat4>(const std::string& name) const;
+
+namespace {
+    // program last bound through Shader::use, shared by every Shader on the context
+    unsigned int boundProgram = 0;
 
-    // delete the shaders as they're linked into our program now and no longer necessary
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    ShaderFrameStats frameStats;
+
+    // glProgramUniform* (GL 4.1) writes a program's uniforms without binding it
+    bool directStateAccess() {
+        return glProgramUniform1i != nullptr;
+    }
+}
+
+const ShaderFrameStats& Shader::FrameStats() {
+    return frameStats;
+}
+
+void Shader::ResetFrameStats() {
+    frameStats = ShaderFrameStats();
+}
+
+void Shader::InvalidateBoundProgram() {
+    boundProgram = 0;
+}
+
+Shader::~Shader() {
+    // the name is free for the next program once this one is deleted, use() must not skip binding that
+    if (program && program.use_count() == 1 && boundProgram == ID) {
+        boundProgram = 0;
+    }
 }
 
 // use/activate the shader
 void Shader::use() const {
+    if (boundProgram == ID) {
+        frameStats.programBindsElided++;
+        return;
+    }
+
     glUseProgram(ID);
+    boundProgram = ID;
+    frameStats.programBinds++;
+}
+
+bool Shader::shadowChanged(int slot, const void* value, size_t bytes) const {
+    // inactive uniforms would be a no-op glUniform call at location -1
+    if (slot < 0) {
+        frameStats.uniformUploadsElided++;
+        return false;
+    }
+
+    auto& cached = shadow[slot];
+    if (cached.valid && std::memcmp(cached.data, value, bytes) == 0) {
+        frameStats.uniformUploadsElided++;
+        return false;
+    }
+
+    std::memcpy(cached.data, value, bytes);
+    cached.valid = true;
+    frameStats.uniformUploads++;
+    return true;
+}
+
+void Shader::uploadInt(int slot, int value) const {
+    if (!shadowChanged(slot, &value, sizeof(value))) return;
+
+    if (directStateAccess()) {
+        glProgramUniform1i(ID, uniforms[slot].location, value);
+    }
+    else {
+        use();
+        glUniform1i(uniforms[slot].location, value);
+    }
+}
+
+void Shader::uploadIntArray(int slot, const int* values, int count) const {
+    if (slot < 0 || count <= 0) {
+        frameStats.uniformUploadsElided++;
+        return;
+    }
+
+    // array elements take consecutive slots, uniforms[slot].size counts the ones left
+    count = std::min(count, (int)uniforms[slot].size);
+
+    // one upload for the whole range if any element changed
+    bool changed = false;
+    for (int i = 0; i < count; i++) {
+        auto& cached = shadow[slot + i];
+        if (!cached.valid || std::memcmp(cached.data, &values[i], sizeof(int)) != 0) {
+            cached.valid = true;
+            std::memcpy(cached.data, &values[i], sizeof(int));
+            changed = true;
+        }
+    }
+
+    if (!changed) {
+        frameStats.uniformUploadsElided++;
+        return;
+    }
+    frameStats.uniformUploads++;
+
+    if (directStateAccess()) {
+        glProgramUniform1iv(ID, uniforms[slot].location, count, values);
+    }
+    else {
+        use();
+        glUniform1iv(uniforms[slot].location, count, values);
+    }
+}
+
+void Shader::uploadFloat(int slot, float value) const {
+    if (!shadowChanged(slot, &value, sizeof(value))) return;
+
+    if (directStateAccess()) {
+        glProgramUniform1f(ID, uniforms[slot].location, value);
+    }
+    else {
+        use();
+        glUniform1f(uniforms[slot].location, value);
+    }
+}
+
+void Shader::uploadVec3(int slot, const glm::vec3& value) const {
+    if (!shadowChanged(slot, glm::value_ptr(value), sizeof(value))) return;
+
+    if (directStateAccess()) {
+        glProgramUniform3fv(ID, uniforms[slot].location, 1, glm::value_ptr(value));
+    }
+    else {
+        use();
+        glUniform3fv(uniforms[slot].location, 1, glm::value_ptr(value));
+    }
+}
+
+void Shader::uploadMat4(int slot, const glm::mat4& value) const {
+    if (!shadowChanged(slot, glm::value_ptr(value), sizeof(value))) return;
+
+    if (directStateAccess()) {
+        glProgramUniformMatrix4fv(ID, uniforms[slot].location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+    else {
+        use();
+        glUniformMatrix4fv(uniforms[slot].location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+}
+
+void Shader::set(Uniform<bool> u, bool value) const {
+    uploadInt(u.slot, (int)value);
+}
+
+void Shader::set(Uniform<int> u, int value) const {
+    uploadInt(u.slot, value);
+}
+
+void Shader::set(Uniform<int> u, const int* values, int count) const {
+    uploadIntArray(u.slot, values, count);
+}
+
+void Shader::set(Uniform<float> u, float value) const {
+    uploadFloat(u.slot, value);
+}
+
+void Shader::set(Uniform<glm::vec3> u, const glm::vec3& value) const {
+    uploadVec3(u.slot, value);
+}
+
+void Shader::set(Uniform<glm::mat4> u, const glm::mat4& value) const {
+    uploadMat4(u.slot, value);
 }
 
 // utility uniform functions
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    uploadInt(FindUniform(name), (int)value);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    uploadInt(FindUniform(name), value);
+}
+
+void Shader::setIntArray(const std::string& name, const int* values, int count) const
+{
+    uploadIntArray(FindUniform(name), values, count);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    uploadFloat(FindUniform(name), value);
 }
 
 void Shader::setMat4(const std::string& name, glm::mat4 value) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+    uploadMat4(FindUniform(name), value);
 }
 void Shader::setVec3(const std::string& name, glm::vec3 value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+    uploadVec3(FindUniform(name), value);
 }
@@ -0,0 +1,221 @@
+#include <rendersystem/ShaderCache.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+    // file layout: header followed by `length` bytes of driver specific binary
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    const char CACHE_MAGIC[4] = { 'R', 'S', 'P', 'B' };
+    const uint32_t CACHE_VERSION = 1;
+
+    ShaderCache::Stats stats;
+
+    std::string& directory() {
+        static std::string dir = []() -> std::string {
+            if (const char* env = std::getenv("RS_SHADER_CACHE_DIR")) {
+                return env;
+            }
+
+            std::error_code ec;
+            auto tmp = std::filesystem::temp_directory_path(ec);
+            if (ec) return "";
+            return (tmp / "rendersystem-shader-cache").string();
+        }();
+        return dir;
+    }
+
+    uint64_t fnv1a(uint64_t hash, const std::string& data) {
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 0x100000001b3ull;
+        }
+        // separator so ("ab", "c") and ("a", "bc") hash differently
+        hash ^= 0xff;
+        hash *= 0x100000001b3ull;
+        return hash;
+    }
+
+    std::string glString(GLenum name) {
+        auto str = glGetString(name);
+        return str ? reinterpret_cast<const char*>(str) : "";
+    }
+
+    std::filesystem::path entryPath(uint64_t key) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return std::filesystem::path(directory()) / name;
+    }
+}
+
+namespace ShaderCache {
+    void SetDirectory(const std::string& dir) {
+        directory() = dir;
+    }
+
+    const std::string& Directory() {
+        return directory();
+    }
+
+    bool Enabled() {
+        if (directory().empty() || glProgramBinary == nullptr || glGetProgramBinary == nullptr) {
+            return false;
+        }
+
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    uint64_t Key(const std::string& vertexCode, const std::string& fragmentCode, const std::string& geometryCode) {
+        // the driver strings don't change for the lifetime of the context
+        static const std::string driver =
+            glString(GL_VENDOR) + "\n" +
+            glString(GL_RENDERER) + "\n" +
+            glString(GL_VERSION) + "\n" +
+            glString(GL_SHADING_LANGUAGE_VERSION);
+
+        uint64_t hash = 0xcbf29ce484222325ull;
+        hash = fnv1a(hash, vertexCode);
+        hash = fnv1a(hash, fragmentCode);
+        if (!geometryCode.empty()) hash = fnv1a(hash, geometryCode);
+        hash = fnv1a(hash, driver);
+        return hash;
+    }
+
+    bool Load(unsigned int program, uint64_t key) {
+        if (!Enabled()) {
+            stats.misses++;
+            return false;
+        }
+
+        auto path = entryPath(key);
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            stats.misses++;
+            return false;
+        }
+
+        CacheHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        bool valid = file &&
+            std::equal(header.magic, header.magic + 4, CACHE_MAGIC) &&
+            header.version == CACHE_VERSION &&
+            header.key == key;
+
+        std::vector<char> binary;
+        if (valid) {
+            binary.resize(header.length);
+            file.read(binary.data(), header.length);
+            valid = (bool)file;
+        }
+
+        if (valid) {
+            glProgramBinary(program, header.format, binary.data(), header.length);
+
+            GLint success = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            valid = success != 0;
+        }
+
+        if (!valid) {
+            // stale or corrupt entry: drop it so the rebuilt program replaces it
+            file.close();
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+
+            stats.rejected++;
+            stats.misses++;
+            return false;
+        }
+
+        stats.hits++;
+        return true;
+    }
+
+    void Store(unsigned int program, uint64_t key) {
+        if (!Enabled()) return;
+
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+        std::error_code ec;
+        std::filesystem::create_directories(directory(), ec);
+        if (ec) {
+            std::cout << "WARNING::SHADER_CACHE::CANNOT_CREATE_DIRECTORY " << directory() << std::endl;
+            return;
+        }
+
+        // write to a temporary then rename, so a concurrent reader never sees half a file
+        auto path = entryPath(key);
+        auto tmpPath = path;
+        tmpPath += ".tmp";
+
+        CacheHeader header;
+        std::copy(CACHE_MAGIC, CACHE_MAGIC + 4, header.magic);
+        header.version = CACHE_VERSION;
+        header.key = key;
+        header.format = format;
+        header.length = (uint32_t)length;
+
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(binary.data(), length);
+            if (!file) {
+                std::cout << "WARNING::SHADER_CACHE::WRITE_FAILED " << tmpPath.string() << std::endl;
+                return;
+            }
+        }
+
+        std::filesystem::rename(tmpPath, path, ec);
+        if (!ec) {
+            stats.stored++;
+        }
+    }
+
+    void RecordBuildTime(bool hit, double seconds) {
+        if (hit) {
+            stats.loadSeconds += seconds;
+        }
+        else {
+            stats.compileSeconds += seconds;
+        }
+    }
+
+    const Stats& GetStats() {
+        return stats;
+    }
+
+    void ResetStats() {
+        stats = Stats();
+    }
+
+    void PrintReport(std::ostream& os) {
+        os << "shader cache (" << (directory().empty() ? "disabled" : directory()) << "): "
+            << stats.hits << " hits, "
+            << stats.misses << " misses ("
+            << stats.rejected << " rejected), "
+            << stats.stored << " stored" << std::endl;
+        os << "  program build time: "
+            << (stats.loadSeconds + stats.compileSeconds) * 1000.0 << " ms total, "
+            << stats.loadSeconds * 1000.0 << " ms from cache, "
+            << stats.compileSeconds * 1000.0 << " ms compiling" << std::endl;
+    }
+}
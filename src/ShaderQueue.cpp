@@ -0,0 +1,51 @@
+#include <rendersystem/ShaderQueue.h>
+
+#include <algorithm>
+
+// GL_KHR_parallel_shader_compile, not part of the generated loader
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+ShaderQueue::ShaderQueue(GLADloadproc loader) {
+    if (loader == nullptr || !Shader::ParallelCompileSupported()) {
+        return;
+    }
+
+    auto maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsKHR");
+    if (maxThreads == nullptr) {
+        maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsARB");
+    }
+
+    // 0xFFFFFFFF lets the driver pick as many threads as it likes
+    if (maxThreads != nullptr) {
+        maxThreads(0xFFFFFFFF);
+    }
+}
+
+ShaderFuture ShaderQueue::Submit(const char* vertexPath, const char* fragmentPath, const std::string& defines) {
+    auto shader = Shader::BuildAsync(vertexPath, fragmentPath, defines);
+    pending.push_back(shader);
+    return ShaderFuture(shader);
+}
+
+void ShaderQueue::Poll(int maxBlocking) {
+    int blocked = 0;
+    pending.erase(std::remove_if(pending.begin(), pending.end(), [&](const std::shared_ptr<Shader>& shader) {
+        if (shader->Poll(false)) {
+            return true;
+        }
+
+        if (!Shader::ParallelCompileSupported() && blocked < maxBlocking) {
+            blocked++;
+            return shader->Poll(true);
+        }
+
+        return false;
+    }), pending.end());
+}
+
+void ShaderQueue::Finish() {
+    for (auto& shader : pending) {
+        shader->Poll(true);
+    }
+    pending.clear();
+}
@@ -0,0 +1,64 @@
+#include <rendersystem/ShaderVariants.h>
+
+#include <algorithm>
+#include <memory>
+
+uint64_t ShaderFeatures::Key() const {
+    uint64_t key = 0;
+    key |= (uint64_t)std::clamp(pointLights + 1, 0, 0xffff);
+    key |= (uint64_t)std::clamp(directionalLights + 1, 0, 0xffff) << 16;
+    key |= (uint64_t)alphaTest << 32;
+    key |= (uint64_t)specularMap << 33;
+    key |= (uint64_t)visualiseDepth << 34;
+    key |= (uint64_t)clustered << 35;
+    key |= (uint64_t)perObjectLights << 36;
+    key |= (uint64_t)shadows << 37;
+    key |= (uint64_t)pointShadows << 38;
+    key |= (uint64_t)lightmap << 39;
+    key |= (uint64_t)probes << 40;
+    key |= (uint64_t)instanced << 41;
+    key |= (uint64_t)quantized << 42;
+    return key;
+}
+
+std::string ShaderFeatures::Defines() const {
+    std::string defines = "#define SHADER_VARIANT\n";
+    if (pointLights >= 0) defines += "#define NR_POINT_LIGHTS " + std::to_string(pointLights) + "\n";
+    if (directionalLights >= 0) defines += "#define NR_DIRECTIONAL_LIGHTS " + std::to_string(directionalLights) + "\n";
+    if (alphaTest) defines += "#define ALPHA_TEST\n";
+    if (specularMap) defines += "#define SPECULAR_MAP\n";
+    if (visualiseDepth) defines += "#define VISUALISE_DEPTH\n";
+    if (clustered) defines += "#define CLUSTERED_LIGHTING\n";
+    if (perObjectLights) defines += "#define PER_OBJECT_LIGHTS\n";
+    if (shadows) defines += "#define SHADOWS\n";
+    if (pointShadows) defines += "#define POINT_SHADOWS\n";
+    if (lightmap) defines += "#define LIGHTMAP\n";
+    if (probes) defines += "#define PROBE_LIGHTING\n";
+    if (instanced) defines += "#define INSTANCED\n";
+    if (quantized) defines += "#define QUANTIZED\n";
+    return defines;
+}
+
+ShaderVariants::ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, ShaderQueue* queue) :
+    vertexPath(vertexPath),
+    fragmentPath(fragmentPath),
+    queue(queue) {}
+
+ShaderFuture ShaderVariants::Get(const ShaderFeatures& features) {
+    auto key = features.Key();
+    auto it = variants.find(key);
+    if (it != variants.end()) {
+        return it->second;
+    }
+
+    ShaderFuture variant;
+    if (queue != nullptr) {
+        variant = queue->Submit(vertexPath.c_str(), fragmentPath.c_str(), features.Defines());
+    }
+    else {
+        variant = ShaderFuture(std::make_shared<Shader>(vertexPath.c_str(), fragmentPath.c_str(), features.Defines()));
+    }
+
+    variants[key] = variant;
+    return variant;
+}
@@ -0,0 +1,105 @@
+#include <rendersystem/ShadowAtlas.h>
+
+#include <algorithm>
+
+ShadowAtlas::ShadowAtlas(int size, int minTile) :
+    size(size),
+    minTile(std::max(1, std::min(minTile, size)))
+{
+    freeTiles.resize(levelOf(this->minTile) + 1);
+    freeTiles[0].push_back(Tile{ 0, 0, size });
+}
+
+int ShadowAtlas::levelOf(int tileSize) const {
+    int level = 0;
+    while ((size >> (level + 1)) >= tileSize && (size >> (level + 1)) >= minTile) {
+        level++;
+    }
+    return level;
+}
+
+ShadowAtlas::Tile ShadowAtlas::Allocate(int tileSize) {
+    int level = levelOf(std::max(tileSize, minTile));
+
+    // the smallest free tile that's large enough
+    int from = level;
+    while (from >= 0 && freeTiles[from].empty()) {
+        from--;
+    }
+    if (from < 0) return Tile();
+
+    Tile tile = freeTiles[from].back();
+    freeTiles[from].pop_back();
+
+    // split it down, keeping three quarters free at every level
+    while (from < level) {
+        int half = tile.size / 2;
+        from++;
+        freeTiles[from].push_back(Tile{ tile.x + half, tile.y, half });
+        freeTiles[from].push_back(Tile{ tile.x, tile.y + half, half });
+        freeTiles[from].push_back(Tile{ tile.x + half, tile.y + half, half });
+        tile.size = half;
+    }
+    return tile;
+}
+
+bool ShadowAtlas::takeFree(int level, int x, int y) {
+    auto& tiles = freeTiles[level];
+    for (size_t i = 0; i < tiles.size(); i++) {
+        if (tiles[i].x == x && tiles[i].y == y) {
+            tiles[i] = tiles.back();
+            tiles.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShadowAtlas::Free(const Tile& tile) {
+    if (!tile.Valid()) return;
+
+    Tile current = tile;
+    int level = levelOf(current.size);
+
+    // merge with the three siblings while they're all free
+    while (level > 0) {
+        int parentSize = current.size * 2;
+        int px = current.x - current.x % parentSize;
+        int py = current.y - current.y % parentSize;
+
+        Tile siblings[3];
+        int found = 0;
+        for (int i = 0; i < 4; i++) {
+            int sx = px + (i & 1) * current.size;
+            int sy = py + (i >> 1) * current.size;
+            if (sx == current.x && sy == current.y) continue;
+            siblings[found++] = Tile{ sx, sy, current.size };
+        }
+
+        auto& tiles = freeTiles[level];
+        bool allFree = std::all_of(siblings, siblings + 3, [&](const Tile& s) {
+            return std::any_of(tiles.begin(), tiles.end(), [&](const Tile& t) {
+                return t.x == s.x && t.y == s.y;
+            });
+        });
+        if (!allFree) break;
+
+        for (auto& s : siblings) {
+            takeFree(level, s.x, s.y);
+        }
+        current = Tile{ px, py, parentSize };
+        level--;
+    }
+
+    freeTiles[level].push_back(current);
+}
+
+long long ShadowAtlas::FreeArea() const {
+    long long area = 0;
+    for (auto& tiles : freeTiles) {
+        for (auto& tile : tiles) {
+            area += (long long)tile.size * tile.size;
+        }
+    }
+    return area;
+}
@@ -0,0 +1,240 @@
+#include <rendersystem/TriangleBVH.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    const int SAH_BINS = 16;
+    const uint32_t MAX_LEAF_TRIANGLES = 4;
+    const int MAX_DEPTH = 64;
+
+    struct Bounds {
+        glm::vec3 lo = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 hi = glm::vec3(-std::numeric_limits<float>::max());
+
+        void Grow(const glm::vec3& p) {
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p);
+        }
+
+        void Grow(const Bounds& b) {
+            lo = glm::min(lo, b.lo);
+            hi = glm::max(hi, b.hi);
+        }
+
+        float Area() const {
+            auto e = hi - lo;
+            if (e.x < 0.0f) return 0.0f;
+            return e.x * e.y + e.y * e.z + e.z * e.x;
+        }
+    };
+
+    // slab test, returns the entry distance or infinity on a miss
+    float intersectBox(const glm::vec3& lo, const glm::vec3& hi,
+        const glm::vec3& origin, const glm::vec3& invDir, float tMax)
+    {
+        auto t0 = (lo - origin) * invDir;
+        auto t1 = (hi - origin) * invDir;
+        auto tNear = glm::min(t0, t1);
+        auto tFar = glm::max(t0, t1);
+        float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+        return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+    }
+}
+
+void TriangleBVH::Build(const std::vector<glm::vec3>& positions)
+{
+    size_t count = positions.size() / 3;
+    triangles.clear();
+    nodes.clear();
+    if (count == 0) return;
+
+    std::vector<Bounds> triBounds(count);
+    std::vector<glm::vec3> centroids(count);
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; i++) {
+        for (int k = 0; k < 3; k++) {
+            triBounds[i].Grow(positions[i * 3 + k]);
+        }
+        centroids[i] = (triBounds[i].lo + triBounds[i].hi) * 0.5f;
+        order[i] = (uint32_t)i;
+    }
+
+    nodes.reserve(count * 2);
+    nodes.push_back(Node{ glm::vec3(0.0f), 0, glm::vec3(0.0f), (uint32_t)count });
+
+    // depth first, splitting each node until the SAH prefers a leaf
+    struct Task {
+        uint32_t node;
+        int depth;
+    };
+    std::vector<Task> tasks{ { 0, 0 } };
+    while (!tasks.empty()) {
+        auto task = tasks.back();
+        tasks.pop_back();
+
+        Node& node = nodes[task.node];
+        uint32_t first = node.leftOrFirst;
+        uint32_t n = node.count;
+
+        Bounds bounds, centroidBounds;
+        for (uint32_t i = first; i < first + n; i++) {
+            bounds.Grow(triBounds[order[i]]);
+            centroidBounds.Grow(centroids[order[i]]);
+        }
+        node.lo = bounds.lo;
+        node.hi = bounds.hi;
+
+        if (n <= MAX_LEAF_TRIANGLES || task.depth >= MAX_DEPTH) continue;
+
+        // best binned split over the three axes
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        int bestBin = 0;
+        auto extent = centroidBounds.hi - centroidBounds.lo;
+        for (int axis = 0; axis < 3; axis++) {
+            if (extent[axis] <= 0.0f) continue;
+
+            Bounds bins[SAH_BINS];
+            uint32_t binCounts[SAH_BINS] = {};
+            float scale = SAH_BINS / extent[axis];
+            for (uint32_t i = first; i < first + n; i++) {
+                int b = std::min(SAH_BINS - 1, (int)((centroids[order[i]][axis] - centroidBounds.lo[axis]) * scale));
+                bins[b].Grow(triBounds[order[i]]);
+                binCounts[b]++;
+            }
+
+            // sweep from the right to get the cost of every split plane in one pass
+            float rightArea[SAH_BINS];
+            uint32_t rightCount[SAH_BINS];
+            Bounds right;
+            uint32_t sum = 0;
+            for (int b = SAH_BINS - 1; b > 0; b--) {
+                right.Grow(bins[b]);
+                sum += binCounts[b];
+                rightArea[b] = right.Area();
+                rightCount[b] = sum;
+            }
+
+            Bounds left;
+            sum = 0;
+            for (int b = 0; b < SAH_BINS - 1; b++) {
+                left.Grow(bins[b]);
+                sum += binCounts[b];
+                if (sum == 0 || rightCount[b + 1] == 0) continue;
+                float cost = left.Area() * sum + rightArea[b + 1] * rightCount[b + 1];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b;
+                }
+            }
+        }
+
+        // splitting has to beat intersecting every triangle of the node
+        if (bestAxis < 0 || bestCost >= bounds.Area() * n) continue;
+
+        float scale = SAH_BINS / extent[bestAxis];
+        float lo = centroidBounds.lo[bestAxis];
+        auto mid = std::partition(order.begin() + first, order.begin() + first + n, [&](uint32_t t) {
+            return std::min(SAH_BINS - 1, (int)((centroids[t][bestAxis] - lo) * scale)) <= bestBin;
+        });
+        uint32_t leftCount = (uint32_t)(mid - (order.begin() + first));
+        if (leftCount == 0 || leftCount == n) continue;
+
+        uint32_t leftIndex = (uint32_t)nodes.size();
+        nodes.push_back(Node{ glm::vec3(0.0f), first, glm::vec3(0.0f), leftCount });
+        nodes.push_back(Node{ glm::vec3(0.0f), first + leftCount, glm::vec3(0.0f), n - leftCount });
+
+        // push_back may have moved the node
+        nodes[task.node].leftOrFirst = leftIndex;
+        nodes[task.node].count = 0;
+
+        tasks.push_back({ leftIndex, task.depth + 1 });
+        tasks.push_back({ leftIndex + 1, task.depth + 1 });
+    }
+
+    triangles.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        auto t = order[i];
+        auto& v0 = positions[t * 3];
+        triangles[i] = Triangle{ v0, positions[t * 3 + 1] - v0, positions[t * 3 + 2] - v0, t };
+    }
+}
+
+template <bool AnyHit>
+bool TriangleBVH::traverse(const glm::vec3& origin, const glm::vec3& dir, float tMax, Hit& hit) const
+{
+    if (nodes.empty()) return false;
+
+    glm::vec3 invDir = 1.0f / dir;
+    bool found = false;
+    float closest = tMax;
+
+    uint32_t stack[MAX_DEPTH * 2];
+    int top = 0;
+    if (intersectBox(nodes[0].lo, nodes[0].hi, origin, invDir, closest) == std::numeric_limits<float>::infinity()) {
+        return false;
+    }
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+
+        if (node.count > 0) {
+            for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                const Triangle& tri = triangles[i];
+                auto p = glm::cross(dir, tri.e2);
+                float det = glm::dot(tri.e1, p);
+                if (std::abs(det) < 1e-12f) continue;
+
+                float invDet = 1.0f / det;
+                auto s = origin - tri.v0;
+                float u = glm::dot(s, p) * invDet;
+                if (u < 0.0f || u > 1.0f) continue;
+
+                auto q = glm::cross(s, tri.e1);
+                float v = glm::dot(dir, q) * invDet;
+                if (v < 0.0f || u + v > 1.0f) continue;
+
+                float t = glm::dot(tri.e2, q) * invDet;
+                if (t <= 0.0f || t >= closest) continue;
+
+                if (AnyHit) return true;
+                closest = t;
+                hit.t = t;
+                hit.triangle = tri.id;
+                hit.u = u;
+                hit.v = v;
+                found = true;
+            }
+            continue;
+        }
+
+        // visit the nearer child first so the closest hit shrinks the search early
+        uint32_t a = node.leftOrFirst;
+        uint32_t b = a + 1;
+        float ta = intersectBox(nodes[a].lo, nodes[a].hi, origin, invDir, closest);
+        float tb = intersectBox(nodes[b].lo, nodes[b].hi, origin, invDir, closest);
+        if (ta > tb) {
+            std::swap(a, b);
+            std::swap(ta, tb);
+        }
+        if (tb != std::numeric_limits<float>::infinity()) stack[top++] = b;
+        if (ta != std::numeric_limits<float>::infinity()) stack[top++] = a;
+    }
+
+    return found;
+}
+
+bool TriangleBVH::Intersect(const glm::vec3& origin, const glm::vec3& dir, float tMax, Hit& hit) const
+{
+    return traverse<false>(origin, dir, tMax, hit);
+}
+
+bool TriangleBVH::Occluded(const glm::vec3& origin, const glm::vec3& dir, float tMax) const
+{
+    Hit hit;
+    return traverse<true>(origin, dir, tMax, hit);
+}
@@ -0,0 +1,10 @@
+#include <rendersystem/UniformBlocks.h>
+
+namespace UniformBlocks {
+    GLuint Binding(const std::string& blockName) {
+        if (blockName == "FrameConstants") return FRAME_CONSTANTS;
+        if (blockName == "Lights") return LIGHTS;
+
+        return GL_INVALID_INDEX;
+    }
+}
@@ -4,11 +4,15 @@
 #include "stb_image.h"
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <vector>
+
 
 
 namespace Utils {
     unsigned int TextureFromFile(const std::string& path,
-            std::function<void(void)> textureSettingsCallback) {
+            std::function<void(void)> textureSettingsCallback,
+            int* channels) {
         unsigned int texId;
 
         glGenTextures(1, &texId);
@@ -22,6 +26,10 @@ namespace Utils {
             &c,
             0);
 
+        if (channels != nullptr) {
+            *channels = data == nullptr ? 0 : c;
+        }
+
         if (data == nullptr) {
             std::cout << "failed to load texture from " << path << std::endl;
             return -1;
@@ -49,4 +57,54 @@ namespace Utils {
 
         return texId;
     }
-}
\ No newline at end of file
+
+    unsigned int TextureArrayFromFiles(const std::vector<std::string>& paths) {
+        if (paths.empty()) return 0;
+
+        stbi_set_flip_vertically_on_load(true);
+        int width, height, c;
+        unsigned char* first = stbi_load(paths[0].c_str(), &width, &height, &c, 4);
+        if (first == nullptr) {
+            std::cout << "failed to load texture from " << paths[0] << std::endl;
+            return 0;
+        }
+
+        std::vector<unsigned char> texels((size_t)width * height * 4 * paths.size(), 255);
+        std::copy(first, first + (size_t)width * height * 4, texels.begin());
+        stbi_image_free(first);
+
+        for (size_t layer = 1; layer < paths.size(); layer++) {
+            int w, h;
+            unsigned char* data = stbi_load(paths[layer].c_str(), &w, &h, &c, 4);
+            if (data == nullptr) {
+                // the layer stays white
+                std::cout << "failed to load texture from " << paths[layer] << std::endl;
+                continue;
+            }
+
+            unsigned char* out = texels.data() + (size_t)width * height * 4 * layer;
+            for (int y = 0; y < height; y++) {
+                int sy = y * h / height;
+                for (int x = 0; x < width; x++) {
+                    int sx = x * w / width;
+                    std::copy_n(data + ((size_t)sy * w + sx) * 4, 4, out + ((size_t)y * width + x) * 4);
+                }
+            }
+            stbi_image_free(data);
+        }
+
+        unsigned int texId;
+        glGenTextures(1, &texId);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texId);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, width, height, (GLsizei)paths.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        return texId;
+    }
+}
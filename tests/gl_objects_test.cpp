@@ -0,0 +1,126 @@
+#include <resources.h>
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <rendersystem/Camera.h>
+#include <rendersystem/CascadedShadows.h>
+#include <rendersystem/DeferredRenderer.h>
+#include <rendersystem/FrameConstants.h>
+#include <rendersystem/GLHandle.h>
+#include <rendersystem/GeometryPool.h>
+#include <rendersystem/GpuTimer.h>
+#include <rendersystem/InstancedMesh.h>
+#include <rendersystem/LightClusters.h>
+#include <rendersystem/LightTree.h>
+#include <rendersystem/LightingSystem.h>
+#include <rendersystem/Mesh.h>
+#include <rendersystem/PointShadows.h>
+#include <rendersystem/Shader.h>
+
+#include <glm/glm.hpp>
+
+// builds a scene out of every class that owns GL objects, tears it down, shuts the
+// geometry pools down and checks that GLObjects::Live() is back to zero. needs a GL 3.3 context; without a
+// display the test is skipped (exit code 77)
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char* what, long live) {
+        if (condition) return;
+        std::cout << "ERROR::GL_OBJECTS_TEST::" << what << " live handles: " << live << std::endl;
+        failures++;
+    }
+}
+
+int main()
+{
+    if (!glfwInit()) {
+        std::cout << "no window system, skipped" << std::endl;
+        return 77;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, "gl_objects_test", NULL, NULL);
+    if (window == NULL || (glfwMakeContextCurrent(window), !gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))) {
+        std::cout << "no GL 3.3 context, skipped" << std::endl;
+        glfwTerminate();
+        return 77;
+    }
+
+    check(GLObjects::Live() == 0, "HANDLES_BEFORE_THE_SCENE", GLObjects::Live());
+
+    {
+        Camera camera(glm::vec3(0.0f, 2.0f, 8.0f));
+        FrameConstants frameConstants;
+        frameConstants.Update(camera, 1.0f, 0.1f, 100.0f);
+
+        LightingSystem lighting;
+        lighting.AddDirectionalLight(DirectionalLight::DefaultDirectionalLight());
+        for (int i = 0; i < 300; i++) {
+            lighting.AddPointLight(PointLight::DefaultPointLight());
+        }
+        lighting.Upload();
+
+        LightTree tree;
+        tree.Update(lighting.PointLights());
+        LightClusters clusters;
+        clusters.Build(lighting.PointLights(), camera.GetViewMatrix(), glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+        clusters.Build(tree, camera.GetViewMatrix(), glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+
+        GpuTimer timer;
+        DeferredRenderer deferred(64, 64, SHADERS_DIR);
+        deferred.Resize(32, 32);
+        CascadedShadows cascades(SHADERS_DIR, 2, 256);
+        PointShadows pointShadows(SHADERS_DIR, 512);
+
+        // meshes from the pools, one with its own texture, a copy sharing both
+        std::vector<std::shared_ptr<ControlledMesh>> scene;
+        scene.push_back(std::make_shared<ControlledMesh>(ControlledMesh::CreateCuboid(10.0f, 1.0f, 10.0f)));
+        scene.push_back(std::make_shared<ControlledMesh>(ControlledMesh::CreateSphere(0.5f)));
+        scene.back()->AddTexture(ASSETS_DIR "awesome.png", "texture_diffuse");
+        scene.push_back(std::make_shared<ControlledMesh>(*scene.back()));
+        scene.back()->GenerateLods();
+        for (auto& mesh : scene) {
+            cascades.AddCaster(mesh, true);
+            pointShadows.AddCaster(mesh);
+        }
+
+        InstancedMesh cubes(Geometry::Cuboid(1.0f, 1.0f, 1.0f));
+        cubes.Resize(100);
+
+        // a bound program and a copy sharing it
+        Shader shader(SHADERS_DIR "colors.vert", SHADERS_DIR "colors.frag");
+        Shader copy = shader;
+        copy.use();
+
+        check(GLObjects::Live() > 0, "NOTHING_CREATED", GLObjects::Live());
+        check(GLObjects::Live(GLObject::Program) > 0, "NO_PROGRAMS", GLObjects::Live());
+    }
+
+    // the pools are still there, holding no ranges
+    auto poolRanges = GeometryPool::Shared(GL_UNSIGNED_INT).GetStats().allocations +
+        GeometryPool::Shared(GL_UNSIGNED_SHORT).GetStats().allocations;
+    check(poolRanges == 0, "LEAKED_POOL_RANGES", GLObjects::Live());
+
+    GeometryPool::Shutdown();
+    check(GLObjects::Live() == 0, "LEAKED_OBJECTS", GLObjects::Live());
+    check(GLObjects::Live(GLObject::Program) == 0, "LEAKED_PROGRAMS", GLObjects::Live(GLObject::Program));
+
+    glfwTerminate();
+
+    if (failures == 0) {
+        std::cout << "no GL objects leaked" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}